@@ -11,11 +11,12 @@
 #include <fstream>
 #include <functional>
 #include <inttypes.h>
-#include <map>
 #include <memory>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #ifdef _WIN32
@@ -63,6 +64,183 @@ struct Position {
     }
 };
 
+/**
+ * This template holds an unbounded two-dimensional grid of cells, where
+ * the type of cell is a template argument.  The grid is stored sparsely,
+ * in square chunks of cells found through a hash table, so that any cell
+ * can be reached in constant time, and cells near the last one reached
+ * are reached without even looking up their chunk.  The grid keeps track
+ * of the bounds of the cells which have been set.
+ */
+template< typename T > struct Grid {
+    /**
+     * This is the base-2 logarithm of the width and height of a chunk.
+     */
+    static constexpr int CHUNK_BITS = 6;
+
+    /**
+     * This is the width and height of a chunk.
+     */
+    static constexpr int CHUNK_SIZE = 1 << CHUNK_BITS;
+
+    /**
+     * This holds the cells in one square area of the grid.
+     */
+    struct Chunk {
+        std::vector< T > cells = std::vector< T >(CHUNK_SIZE * CHUNK_SIZE);
+        std::vector< bool > set = std::vector< bool >(CHUNK_SIZE * CHUNK_SIZE);
+    };
+
+    /**
+     * These are the chunks of the grid which have any cells set,
+     * keyed by the coordinates of the chunks.
+     */
+    std::unordered_map< uint64_t, Chunk > chunks;
+
+    /**
+     * This is the chunk reached last, and its key.
+     */
+    mutable const Chunk* lastChunk = nullptr;
+    mutable uint64_t lastKey = 0;
+
+    /**
+     * This is the value of a cell which has never been set.
+     */
+    T unset = T();
+
+    /**
+     * This is the number of cells which have been set.
+     */
+    size_t count = 0;
+
+    /**
+     * These are the bounds of the cells which have been set.
+     */
+    int minX = 0;
+    int maxX = 0;
+    int minY = 0;
+    int maxY = 0;
+
+    static uint64_t Key(int x, int y) {
+        return (
+            ((uint64_t)(uint32_t)(x >> CHUNK_BITS) << 32)
+            | (uint64_t)(uint32_t)(y >> CHUNK_BITS)
+        );
+    }
+
+    static size_t Index(int x, int y) {
+        return (
+            (size_t)(y & (CHUNK_SIZE - 1)) * CHUNK_SIZE
+            + (size_t)(x & (CHUNK_SIZE - 1))
+        );
+    }
+
+    const Chunk* FindChunk(int x, int y) const {
+        const auto key = Key(x, y);
+        if (
+            (lastChunk != nullptr)
+            && (key == lastKey)
+        ) {
+            return lastChunk;
+        }
+        const auto chunksEntry = chunks.find(key);
+        if (chunksEntry == chunks.end()) {
+            return nullptr;
+        }
+        lastChunk = &chunksEntry->second;
+        lastKey = key;
+        return lastChunk;
+    }
+
+    /**
+     * This returns the number of cells which have been set.
+     */
+    size_t Size() const {
+        return count;
+    }
+
+    /**
+     * This indicates whether or not the given cell has been set.
+     */
+    bool Has(const Position& position) const {
+        const auto chunk = FindChunk(position.x, position.y);
+        return (
+            (chunk != nullptr)
+            && chunk->set[Index(position.x, position.y)]
+        );
+    }
+
+    /**
+     * This returns the value of the given cell, which is the value of
+     * a default-constructed cell if it has never been set.
+     */
+    const T& Get(const Position& position) const {
+        const auto chunk = FindChunk(position.x, position.y);
+        if (chunk == nullptr) {
+            return unset;
+        }
+        return chunk->cells[Index(position.x, position.y)];
+    }
+
+    /**
+     * This returns a reference to the given cell, marking it as set.
+     */
+    T& operator[](const Position& position) {
+        auto chunk = const_cast< Chunk* >(FindChunk(position.x, position.y));
+        if (chunk == nullptr) {
+            const auto key = Key(position.x, position.y);
+            chunk = &chunks[key];
+            lastChunk = chunk;
+            lastKey = key;
+        }
+        const auto index = Index(position.x, position.y);
+        if (!chunk->set[index]) {
+            chunk->set[index] = true;
+            if (count == 0) {
+                minX = maxX = position.x;
+                minY = maxY = position.y;
+            } else {
+                minX = std::min(minX, position.x);
+                maxX = std::max(maxX, position.x);
+                minY = std::min(minY, position.y);
+                maxY = std::max(maxY, position.y);
+            }
+            ++count;
+        }
+        return chunk->cells[index];
+    }
+
+    /**
+     * This calls the given visitor with the position and value of every
+     * cell within the bounds of the grid, in row-major order, including
+     * cells which have never been set.
+     */
+    template< typename Visitor > void ForEach(Visitor visitor) const {
+        if (count == 0) {
+            return;
+        }
+        for (int y = minY; y <= maxY; ++y) {
+            for (int x = minX; x <= maxX;) {
+                const auto chunk = FindChunk(x, y);
+                const auto chunkEnd = std::min(
+                    maxX + 1,
+                    ((x >> CHUNK_BITS) + 1) << CHUNK_BITS
+                );
+                for (; x < chunkEnd; ++x) {
+                    visitor(
+                        Position(x, y),
+                        (
+                            (chunk == nullptr)
+                            ? unset
+                            : chunk->cells[Index(x, y)]
+                        )
+                    );
+                }
+            }
+        }
+    }
+};
+
 intmax_t GetNextNumber(
     const std::string& input,
     size_t& pos
@@ -304,7 +482,7 @@ int main(int argc, char* argv[]) {
     machine.numbers = std::move(numbers);
 
     // Construct the panels to be painted, along with the robot's state.
-    std::map< Position, int > panels;
+    Grid< int > panels;
     static struct Orientation {
         Position delta;
         size_t turnLeft;
@@ -321,16 +499,8 @@ int main(int argc, char* argv[]) {
 
     // Run the machine, providing as input the current state
     // of the panels, and taking the output as directives to the robot.
-    int minX = 0;
-    int maxX = 0;
-    int minY = 0;
-    int maxY = 0;
     while (!machine.halted) {
-        const auto panelsEntry = panels.find(robotPosition);
-        int color = 0;
-        if (panelsEntry != panels.end()) {
-            color = panelsEntry->second;
-        }
+        const auto color = panels.Get(robotPosition);
         machine.input.push_back(color);
         std::vector< intmax_t > output;
         machine.Run(output);
@@ -339,10 +509,6 @@ int main(int argc, char* argv[]) {
             return EXIT_FAILURE;
         }
         panels[robotPosition] = (int)output[0];
-        minX = std::min(minX, robotPosition.x);
-        maxX = std::max(maxX, robotPosition.x);
-        minY = std::min(minY, robotPosition.y);
-        maxY = std::max(maxY, robotPosition.y);
         robotOrientation = (
             (output[1] == 0)
             ? orientations[robotOrientation].turnLeft
@@ -351,26 +517,18 @@ int main(int argc, char* argv[]) {
         robotPosition += orientations[robotOrientation].delta;
         printf("Robot is now at %dx%d\n", robotPosition.x, robotPosition.y);
     }
-    printf("%zu panels were painted.\n", panels.size());
+    printf("%zu panels were painted.\n", panels.Size());
 
     // Display the panels in space.
-    const auto height = maxY - minY + 1;
-    const auto width = maxX - minX + 1;
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            const auto panelsEntry = panels.find({
-                minX + x,
-                minY + y
-            });
-            int color = 0;
-            if (panelsEntry != panels.end()) {
-                color = panelsEntry->second;
-            }
+    panels.ForEach(
+        [&panels](const Position& position, int color){
             static const char paints[] = { '.', '#' };
             const auto output = paints[(size_t)color];
             printf("%c", output);
+            if (position.x == panels.maxX) {
+                printf("\n");
+            }
         }
-        printf("\n");
-    }
+    );
     return EXIT_SUCCESS;
 }
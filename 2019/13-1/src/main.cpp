@@ -11,11 +11,12 @@
 #include <fstream>
 #include <functional>
 #include <inttypes.h>
-#include <map>
 #include <memory>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #ifdef _WIN32
@@ -63,6 +64,183 @@ struct Position {
     }
 };
 
+/**
+ * This template holds an unbounded two-dimensional grid of cells, where
+ * the type of cell is a template argument.  The grid is stored sparsely,
+ * in square chunks of cells found through a hash table, so that any cell
+ * can be reached in constant time, and cells near the last one reached
+ * are reached without even looking up their chunk.  The grid keeps track
+ * of the bounds of the cells which have been set.
+ */
+template< typename T > struct Grid {
+    /**
+     * This is the base-2 logarithm of the width and height of a chunk.
+     */
+    static constexpr int CHUNK_BITS = 6;
+
+    /**
+     * This is the width and height of a chunk.
+     */
+    static constexpr int CHUNK_SIZE = 1 << CHUNK_BITS;
+
+    /**
+     * This holds the cells in one square area of the grid.
+     */
+    struct Chunk {
+        std::vector< T > cells = std::vector< T >(CHUNK_SIZE * CHUNK_SIZE);
+        std::vector< bool > set = std::vector< bool >(CHUNK_SIZE * CHUNK_SIZE);
+    };
+
+    /**
+     * These are the chunks of the grid which have any cells set,
+     * keyed by the coordinates of the chunks.
+     */
+    std::unordered_map< uint64_t, Chunk > chunks;
+
+    /**
+     * This is the chunk reached last, and its key.
+     */
+    mutable const Chunk* lastChunk = nullptr;
+    mutable uint64_t lastKey = 0;
+
+    /**
+     * This is the value of a cell which has never been set.
+     */
+    T unset = T();
+
+    /**
+     * This is the number of cells which have been set.
+     */
+    size_t count = 0;
+
+    /**
+     * These are the bounds of the cells which have been set.
+     */
+    int minX = 0;
+    int maxX = 0;
+    int minY = 0;
+    int maxY = 0;
+
+    static uint64_t Key(int x, int y) {
+        return (
+            ((uint64_t)(uint32_t)(x >> CHUNK_BITS) << 32)
+            | (uint64_t)(uint32_t)(y >> CHUNK_BITS)
+        );
+    }
+
+    static size_t Index(int x, int y) {
+        return (
+            (size_t)(y & (CHUNK_SIZE - 1)) * CHUNK_SIZE
+            + (size_t)(x & (CHUNK_SIZE - 1))
+        );
+    }
+
+    const Chunk* FindChunk(int x, int y) const {
+        const auto key = Key(x, y);
+        if (
+            (lastChunk != nullptr)
+            && (key == lastKey)
+        ) {
+            return lastChunk;
+        }
+        const auto chunksEntry = chunks.find(key);
+        if (chunksEntry == chunks.end()) {
+            return nullptr;
+        }
+        lastChunk = &chunksEntry->second;
+        lastKey = key;
+        return lastChunk;
+    }
+
+    /**
+     * This returns the number of cells which have been set.
+     */
+    size_t Size() const {
+        return count;
+    }
+
+    /**
+     * This indicates whether or not the given cell has been set.
+     */
+    bool Has(const Position& position) const {
+        const auto chunk = FindChunk(position.x, position.y);
+        return (
+            (chunk != nullptr)
+            && chunk->set[Index(position.x, position.y)]
+        );
+    }
+
+    /**
+     * This returns the value of the given cell, which is the value of
+     * a default-constructed cell if it has never been set.
+     */
+    const T& Get(const Position& position) const {
+        const auto chunk = FindChunk(position.x, position.y);
+        if (chunk == nullptr) {
+            return unset;
+        }
+        return chunk->cells[Index(position.x, position.y)];
+    }
+
+    /**
+     * This returns a reference to the given cell, marking it as set.
+     */
+    T& operator[](const Position& position) {
+        auto chunk = const_cast< Chunk* >(FindChunk(position.x, position.y));
+        if (chunk == nullptr) {
+            const auto key = Key(position.x, position.y);
+            chunk = &chunks[key];
+            lastChunk = chunk;
+            lastKey = key;
+        }
+        const auto index = Index(position.x, position.y);
+        if (!chunk->set[index]) {
+            chunk->set[index] = true;
+            if (count == 0) {
+                minX = maxX = position.x;
+                minY = maxY = position.y;
+            } else {
+                minX = std::min(minX, position.x);
+                maxX = std::max(maxX, position.x);
+                minY = std::min(minY, position.y);
+                maxY = std::max(maxY, position.y);
+            }
+            ++count;
+        }
+        return chunk->cells[index];
+    }
+
+    /**
+     * This calls the given visitor with the position and value of every
+     * cell within the bounds of the grid, in row-major order, including
+     * cells which have never been set.
+     */
+    template< typename Visitor > void ForEach(Visitor visitor) const {
+        if (count == 0) {
+            return;
+        }
+        for (int y = minY; y <= maxY; ++y) {
+            for (int x = minX; x <= maxX;) {
+                const auto chunk = FindChunk(x, y);
+                const auto chunkEnd = std::min(
+                    maxX + 1,
+                    ((x >> CHUNK_BITS) + 1) << CHUNK_BITS
+                );
+                for (; x < chunkEnd; ++x) {
+                    visitor(
+                        Position(x, y),
+                        (
+                            (chunk == nullptr)
+                            ? unset
+                            : chunk->cells[Index(x, y)]
+                        )
+                    );
+                }
+            }
+        }
+    }
+};
+
 intmax_t GetNextNumber(
     const std::string& input,
     size_t& pos
@@ -304,7 +482,7 @@ int main(int argc, char* argv[]) {
     machine.numbers = std::move(numbers);
 
     // Construct the tiles to be drawn by the game.
-    std::map< Position, int > tiles;
+    Grid< int > tiles;
 
     // Run the machine, taking the output as directives to draw
     // into the tiles.
@@ -324,11 +502,13 @@ int main(int argc, char* argv[]) {
         tiles[{x, y}] = (int)output[i+2];
     }
     size_t numBricks = 0;
-    for (const auto& tile: tiles) {
-        if (tile.second == 2) {
-            ++numBricks;
+    tiles.ForEach(
+        [&numBricks](const Position&, int tile){
+            if (tile == 2) {
+                ++numBricks;
+            }
         }
-    }
+    );
     printf("There were %zu bricks remaining at the end of the game.\n", numBricks);
     return EXIT_SUCCESS;
 }
@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string>
+#include <string.h>
 #include <vector>
 
 #ifdef _WIN32
@@ -87,6 +88,7 @@ struct Machine {
     std::vector< intmax_t > input;
     bool halted = false;
     intmax_t relativeBase = 0;
+    bool quiet = false;
 
     void ExpandToFit(size_t index) {
         if (index >= numbers.size()) {
@@ -160,7 +162,9 @@ struct Machine {
     }
 
     void Run(std::vector< intmax_t >& output) {
-        printf("*** Machine %zu Run ***\n", id);
+        if (!quiet) {
+            printf("*** Machine %zu Run ***\n", id);
+        }
         while (!halted) {
             const auto opcode = numbers[pos] % 100;
             switch (opcode) {
@@ -183,7 +187,9 @@ struct Machine {
                 case 3: { // input
                     const auto index = LoadIndex(pos + 1, (numbers[pos] / 100) % 10);
                     if (input.empty()) {
-                        printf("*** Machine %zu Needs Input ***\n", id);
+                        if (!quiet) {
+                            printf("*** Machine %zu Needs Input ***\n", id);
+                        }
                         return;
                     }
                     const auto inputValue = input[0];
@@ -264,10 +270,261 @@ struct Machine {
                 } break;
             }
         }
-        printf("*** Machine %zu Halted ***\n", id);
+        if (!quiet) {
+            printf("*** Machine %zu Halted ***\n", id);
+        }
+    }
+};
+
+/**
+ * This holds the tiles drawn by the game, in a dense grid which grows
+ * to fit whatever is drawn, and keeps track of which tiles have changed
+ * since the screen was last drawn.
+ */
+struct Framebuffer {
+    int left = 0;
+    int top = 0;
+    int width = 0;
+    int height = 0;
+    std::vector< int > tiles;
+
+    // These are the indexes of the tiles changed since the screen was
+    // last drawn, and a mark for each tile telling if it's one of them.
+    std::vector< size_t > changed;
+    std::vector< bool > isChanged;
+
+    // This indicates whether or not the grid has grown since the screen
+    // was last drawn, in which case all of it needs to be drawn again.
+    bool reshaped = false;
+
+    void Grow(int x, int y) {
+        int newLeft = x;
+        int newTop = y;
+        int newRight = x + 1;
+        int newBottom = y + 1;
+        if (!tiles.empty()) {
+            newLeft = std::min(newLeft, left);
+            newTop = std::min(newTop, top);
+            newRight = std::max(newRight, left + width);
+            newBottom = std::max(newBottom, top + height);
+        }
+        const auto newWidth = newRight - newLeft;
+        const auto newHeight = newBottom - newTop;
+        std::vector< int > newTiles((size_t)(newWidth * newHeight));
+        for (int row = 0; row < height; ++row) {
+            (void)std::copy(
+                tiles.begin() + row * width,
+                tiles.begin() + (row + 1) * width,
+                newTiles.begin() + (top - newTop + row) * newWidth + (left - newLeft)
+            );
+        }
+        left = newLeft;
+        top = newTop;
+        width = newWidth;
+        height = newHeight;
+        tiles.swap(newTiles);
+        changed.clear();
+        isChanged.assign(tiles.size(), false);
+        reshaped = true;
+    }
+
+    int Get(int x, int y) const {
+        if (
+            (x < left)
+            || (y < top)
+            || (x >= left + width)
+            || (y >= top + height)
+        ) {
+            return -1;
+        }
+        return tiles[(size_t)((y - top) * width + (x - left))];
+    }
+
+    void Set(int x, int y, int tile) {
+        if (
+            (x < left)
+            || (y < top)
+            || (x >= left + width)
+            || (y >= top + height)
+        ) {
+            Grow(x, y);
+        }
+        const auto index = (size_t)((y - top) * width + (x - left));
+        if (tiles[index] == tile) {
+            return;
+        }
+        tiles[index] = tile;
+        if (
+            !reshaped
+            && !isChanged[index]
+        ) {
+            isChanged[index] = true;
+            changed.push_back(index);
+        }
     }
 };
 
+/**
+ * This function draws the tiles of the game, along with the current
+ * score.  The first time, or whenever the grid has grown, the whole
+ * screen is drawn; otherwise the cursor is moved to each tile which has
+ * changed and only that tile is drawn.  Everything is written to the
+ * terminal at once.
+ *
+ * @param[in,out] framebuffer
+ *     This holds the tiles to draw.  The tracking of which tiles have
+ *     changed is reset.
+ *
+ * @param[in] score
+ *     This is the current score.
+ *
+ * @param[in,out] frame
+ *     This is used to build up what to write to the terminal.
+ */
+void Render(
+    Framebuffer& framebuffer,
+    int score,
+    std::string& frame
+) {
+    static const char paints[] = { ' ', '#', '*', '_', 'o' };
+    const auto paint = [](int tile){
+        return (
+            ((tile >= 0) && ((size_t)tile < sizeof(paints)))
+            ? paints[(size_t)tile]
+            : '?'
+        );
+    };
+    char buffer[64];
+    frame.clear();
+    if (framebuffer.reshaped) {
+        frame += "\x1b[H\x1b[2J";
+        for (int y = 0; y < framebuffer.height; ++y) {
+            for (int x = 0; x < framebuffer.width; ++x) {
+                frame += paint(framebuffer.tiles[(size_t)(y * framebuffer.width + x)]);
+            }
+            frame += '\n';
+        }
+        framebuffer.reshaped = false;
+    } else {
+        for (const auto index: framebuffer.changed) {
+            (void)snprintf(
+                buffer,
+                sizeof(buffer),
+                "\x1b[%d;%dH%c",
+                (int)(index / (size_t)framebuffer.width) + 1,
+                (int)(index % (size_t)framebuffer.width) + 1,
+                paint(framebuffer.tiles[index])
+            );
+            frame += buffer;
+            framebuffer.isChanged[index] = false;
+        }
+    }
+    framebuffer.changed.clear();
+    (void)snprintf(
+        buffer,
+        sizeof(buffer),
+        "\x1b[%d;1HCurrent score: %d\x1b[K\n",
+        framebuffer.height + 1,
+        score
+    );
+    frame += buffer;
+    (void)fwrite(frame.data(), 1, frame.length(), stdout);
+}
+
+/**
+ * This function predicts where the ball will be when it next comes down
+ * to the row just above the paddle.  The ball moves one step diagonally
+ * each turn and bounces off walls, but hitting a block changes its
+ * course in ways not worth modeling, so the prediction is abandoned if
+ * the ball would come near any blocks before then.
+ *
+ * @param[in] tiles
+ *     These are the tiles of the game.
+ *
+ * @param[in] x
+ *     This is the current X position of the ball.
+ *
+ * @param[in] y
+ *     This is the current Y position of the ball.
+ *
+ * @param[in] dx
+ *     This is how far the ball moved along X in the last turn.
+ *
+ * @param[in] dy
+ *     This is how far the ball moved along Y in the last turn.
+ *
+ * @param[in] paddleY
+ *     This is the Y position of the paddle.
+ *
+ * @param[out] landingX
+ *     This is where to store the X position where the ball
+ *     is predicted to come down.
+ *
+ * @param[out] landingTurns
+ *     This is where to store the number of turns until the ball
+ *     comes down.
+ *
+ * @return
+ *     An indication of whether or not a prediction could be made
+ *     is returned.
+ */
+bool PredictLanding(
+    const Framebuffer& tiles,
+    int x,
+    int y,
+    int dx,
+    int dy,
+    int paddleY,
+    int& landingX,
+    size_t& landingTurns
+) {
+    if (
+        (abs(dx) != 1)
+        || (abs(dy) != 1)
+    ) {
+        return false;
+    }
+    const auto limit = (size_t)(tiles.width * tiles.height);
+    for (size_t turn = 0; turn < limit; ++turn) {
+        if (
+            (dy > 0)
+            && (y == paddleY - 1)
+        ) {
+            landingX = x;
+            landingTurns = turn;
+            return true;
+        }
+        for (int bounce = 0; bounce < 2; ++bounce) {
+            const auto side = tiles.Get(x + dx, y);
+            const auto end = tiles.Get(x, y + dy);
+            const auto corner = tiles.Get(x + dx, y + dy);
+            if (
+                (side > 1)
+                || (end > 1)
+                || (corner > 1)
+                || (side < 0)
+                || (end < 0)
+                || (corner < 0)
+            ) {
+                return false;
+            }
+            if (side == 1) {
+                dx = -dx;
+            } else if (end == 1) {
+                dy = -dy;
+            } else if (corner == 1) {
+                dx = -dx;
+                dy = -dy;
+            } else {
+                break;
+            }
+        }
+        x += dx;
+        y += dy;
+    }
+    return false;
+}
+
 /**
  * This function is the entrypoint of the program.
  *
@@ -284,6 +541,23 @@ int main(int argc, char* argv[]) {
 #endif /* _WIN32 */
     (void)setbuf(stdout, NULL);
 
+    // In headless mode, the game isn't drawn at all, and the machine
+    // doesn't announce each time it runs, waits, or halts.  In autoplay
+    // mode, which is also headless, the paddle is moved to where the
+    // ball is predicted to come down, with all the input needed to get
+    // there given at once, so that many turns are played each time the
+    // machine is run.
+    bool headless = false;
+    bool autoplay = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--autoplay") == 0) {
+            headless = true;
+            autoplay = true;
+        }
+    }
+
     // Open the input file and read in the input string.
     std::ifstream input("input.txt");
     std::string line;
@@ -302,9 +576,11 @@ int main(int argc, char* argv[]) {
     Machine machine;
     machine.id = 1;
     machine.numbers = std::move(numbers);
+    machine.quiet = headless;
 
     // Construct the tiles to be drawn by the game.
-    std::map< Position, int > tiles;
+    Framebuffer tiles;
+    std::string frame;
 
     // Insert quarters into the machine.
     machine.numbers[0] = 2;
@@ -315,12 +591,16 @@ int main(int argc, char* argv[]) {
     // a joystick control direction.
     int score = 0;
     size_t turns = 0;
+    size_t runs = 0;
+    std::vector< intmax_t > output;
+    Position ball;
+    Position lastBall;
+    Position paddle;
     while (!machine.halted) {
         // Run the machine until it needs input.
-        std::vector< intmax_t > output;
-        int ball = 0;
-        int paddle = 0;
+        output.clear();
         machine.Run(output);
+        ++runs;
         if ((output.size() % 3) != 0) {
             fprintf(stderr, "Improper number of output values\n");
             return EXIT_FAILURE;
@@ -335,63 +615,62 @@ int main(int argc, char* argv[]) {
                 score = (int)output[i+2];
             } else {
                 const auto tile = (int)output[i+2];
-                tiles[{x, y}] = tile;
+                tiles.Set(x, y, tile);
                 if (tile == 4) {
-                    ball = x;
+                    lastBall = ball;
+                    ball = {x, y};
                 } else if (tile == 3) {
-                    paddle = x;
+                    paddle = {x, y};
                 }
             }
         }
 
-        // Draw the current state of the tiles.
-        int minX = 0;
-        int maxX = 0;
-        int minY = 0;
-        int maxY = 0;
-        for (const auto& tile: tiles) {
-            minX = std::min(minX, tile.first.x);
-            maxX = std::max(maxX, tile.first.x);
-            minY = std::min(minY, tile.first.y);
-            maxY = std::max(maxY, tile.first.y);
-        }
-        const auto height = maxY - minY + 1;
-        const auto width = maxX - minX + 1;
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                const auto tilesEntry = tiles.find({
-                    minX + x,
-                    minY + y
-                });
-                int tile = 0;
-                if (tilesEntry != tiles.end()) {
-                    tile = tilesEntry->second;
-                }
-                static const char paints[] = { ' ', '#', '*', '_', 'o' };
-                const auto output = paints[(size_t)tile];
-                printf("%c", output);
-            }
-            printf("\n");
+        // Draw the current state of the tiles, and the current score.
+        if (!headless) {
+            Render(tiles, score, frame);
         }
 
-        // Draw the current score.
-        printf("Current score: %d\n", score);
-
         // If the machine hasn't yet halted, provide joystick input
         // by finding the ball and paddle, and attempting to keep the
-        // paddle directly under the ball.
+        // paddle directly under the ball, or where the ball will be
+        // when it comes down, if that can be predicted.
         if (!machine.halted) {
-            int input = (
-                (paddle == ball)
-                ? 0
-                : (
-                    (paddle < ball)
-                    ? 1
-                    : -1
+            int target = ball.x;
+            size_t plannedTurns = 1;
+            int landingX;
+            size_t landingTurns;
+            if (
+                autoplay
+                && PredictLanding(
+                    tiles,
+                    ball.x,
+                    ball.y,
+                    ball.x - lastBall.x,
+                    ball.y - lastBall.y,
+                    paddle.y,
+                    landingX,
+                    landingTurns
                 )
-            );
-            machine.input.push_back(input);
-            ++turns;
+                && (landingTurns > 0)
+            ) {
+                target = landingX;
+                plannedTurns = landingTurns;
+            }
+            auto paddleX = paddle.x;
+            for (size_t i = 0; i < plannedTurns; ++i) {
+                int input = (
+                    (paddleX == target)
+                    ? 0
+                    : (
+                        (paddleX < target)
+                        ? 1
+                        : -1
+                    )
+                );
+                paddleX += input;
+                machine.input.push_back(input);
+                ++turns;
+            }
         }
 
         // // If the machine hasn't yet halted, ask for joystick input
@@ -402,7 +681,9 @@ int main(int argc, char* argv[]) {
         //     machine.input.push_back((int)(input[0] - '2'));
         // }
     }
+    printf("Final score: %d\n", score);
     printf("Game over man, GAME OVER!\n");
     printf("It took us %zu 'turns' to beat the game!\n", turns);
+    printf("The machine was run %zu times.\n", runs);
     return EXIT_SUCCESS;
 }
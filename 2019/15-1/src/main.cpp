@@ -8,24 +8,158 @@
  */
 
 #include <algorithm>
+#include <chrono>
+#include <atomic>
 #include <fstream>
 #include <functional>
 #include <inttypes.h>
 #include <limits>
 #include <map>
 #include <memory>
-#include <queue>
 #include <set>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <stack>
 #include <string>
+#include <string.h>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #ifdef _WIN32
 #include <crtdbg.h>
 #endif /* _WIN32 */
 
+/**
+ * This template maps positions to dense indexes, so that searches can
+ * keep their steps in flat arrays.  It's specialized for each type of
+ * position which can be mapped, with a Size() method returning the
+ * number of indexes, and a function call operator returning the index
+ * of a position.
+ */
+template< typename T > struct DenseIndex;
+
+/**
+ * This is the default kind of statistics for a search to keep: none at
+ * all.  Every method does nothing, so a search which keeps no statistics
+ * compiles to the same code as if it had no way to keep them.
+ */
+struct NoStats {
+    void Begin() {
+    }
+
+    void Push() {
+    }
+
+    void Pop() {
+    }
+
+    void Stale() {
+    }
+
+    template< typename T > void Expand(const T&) {
+    }
+
+    void Relax() {
+    }
+
+    void Heuristic() {
+    }
+
+    void End() {
+    }
+};
+
+/**
+ * This keeps statistics about the searches which use it.  The counts
+ * and the elapsed time add up over every search, while the peak size
+ * of the frontier is the largest of any search.
+ */
+struct SearchStats {
+    /**
+     * This is the number of steps pushed onto the frontier.
+     */
+    size_t pushed = 0;
+
+    /**
+     * This is the number of steps popped off the frontier.
+     */
+    size_t popped = 0;
+
+    /**
+     * This is the number of steps popped off the frontier which were
+     * skipped, because a cheaper way to the same position was found
+     * after they were pushed.
+     */
+    size_t stale = 0;
+
+    /**
+     * This is the largest number of steps on the frontier at once.
+     */
+    size_t peakFrontier = 0;
+
+    /**
+     * This is the number of times a position was reached for the first
+     * time, or more cheaply than before.
+     */
+    size_t relaxations = 0;
+
+    /**
+     * This is the number of times the heuristic was called.
+     */
+    size_t heuristicCalls = 0;
+
+    /**
+     * This is the time spent searching, in seconds.
+     */
+    double elapsed = 0.0;
+
+    /**
+     * This is the number of steps on the frontier of the current search.
+     */
+    size_t frontier = 0;
+
+    /**
+     * This is when the current search began.
+     */
+    std::chrono::steady_clock::time_point start;
+
+    void Begin() {
+        frontier = 0;
+        start = std::chrono::steady_clock::now();
+    }
+
+    void Push() {
+        ++pushed;
+        ++frontier;
+        peakFrontier = std::max(peakFrontier, frontier);
+    }
+
+    void Pop() {
+        ++popped;
+        --frontier;
+    }
+
+    void Stale() {
+        ++stale;
+    }
+
+    template< typename T > void Expand(const T&) {
+    }
+
+    void Relax() {
+        ++relaxations;
+    }
+
+    void Heuristic() {
+        ++heuristicCalls;
+    }
+
+    void End() {
+        elapsed += std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
 /**
  * This template is used to find a path from one position
  * to another, where the type of position is a template argument.
@@ -99,41 +233,6 @@ template< typename T > struct PathFinding {
         }
     };
 
-    /**
-     * This is the type of function which determines the immediate
-     * neighbors of a given position.
-     *
-     * @param[in] position
-     *     This is the position for which to find neighbors.
-     *
-     * @return
-     *     The immediate neighbors of the given position are returned.
-     */
-    typedef std::function<
-        std::vector< T >(const T& position)
-    > NeighborFunction;
-
-    /**
-     * This is the type of function which computes the cost
-     * of moving from one position to another.
-     *
-     * @param[in] start
-     *     This is the starting position.
-     *
-     * @param[in] end
-     *     This is the end position.
-     *
-     * @return
-     *     The cost of moving from the start position to the end
-     *     position is returned.
-     */
-    typedef std::function<
-        int(
-            const T& start,
-            const T& end
-        )
-    > CostFunction;
-
     /**
      * This structure holds information returned by the FindPath function.
      */
@@ -156,6 +255,195 @@ template< typename T > struct PathFinding {
         std::vector< T > steps;
     };
 
+    /**
+     * This is a queue of steps yet to be taken, which always gives the
+     * cheapest step next, for any costs.  It's a binary heap, in which
+     * a position is queued again whenever a cheaper way to it is found,
+     * leaving the stale entries to be taken later.
+     */
+    struct HeapQueue {
+        std::vector< SearchStep > steps;
+
+        void Clear() {
+            steps.clear();
+        }
+
+        bool Empty() const {
+            return steps.empty();
+        }
+
+        void Push(const SearchStep& step) {
+            steps.push_back(step);
+            std::push_heap(steps.begin(), steps.end());
+        }
+
+        const SearchStep& Top() {
+            return steps.front();
+        }
+
+        void Pop() {
+            std::pop_heap(steps.begin(), steps.end());
+            steps.pop_back();
+        }
+    };
+
+    /**
+     * This holds what a search needs as it goes, keeping its steps
+     * in a map, for types of position which have no dense index.
+     * The type of queue of steps yet to be taken is a template argument.
+     */
+    template< typename Queue = HeapQueue > struct MapWorkspace {
+        /**
+         * These are the steps taken so far, keyed by position.
+         */
+        std::map< T, SearchStep > steps;
+
+        /**
+         * This is the queue of steps yet to be taken.
+         */
+        Queue frontier;
+
+        /**
+         * This is where the neighbors of a position are put.
+         */
+        std::vector< T > neighbors;
+
+        /**
+         * These are the positions reached, in the order first reached.
+         */
+        std::vector< T > reached;
+
+        /**
+         * This sets up the workspace for a new search.
+         */
+        void Begin() {
+            steps.clear();
+            frontier.Clear();
+            reached.clear();
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * or nullptr if the position hasn't been reached yet.
+         */
+        SearchStep* Find(const T& position) {
+            const auto stepsEntry = steps.find(position);
+            if (stepsEntry == steps.end()) {
+                return nullptr;
+            }
+            return &stepsEntry->second;
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * adding it first if the position hasn't been reached yet.
+         */
+        SearchStep& Add(const T& position) {
+            const auto stepsEntry = steps.find(position);
+            if (stepsEntry != steps.end()) {
+                return stepsEntry->second;
+            }
+            reached.push_back(position);
+            auto& step = steps[position];
+            step = SearchStep(position, position, 0);
+            return step;
+        }
+    };
+
+    /**
+     * This holds what a search needs as it goes, keeping its steps in
+     * flat arrays indexed through the DenseIndex of the type of
+     * position.  It's meant to be reused for any number of searches of
+     * the same space: each step is stamped with the generation of the
+     * search which last reached it, so starting a new search only
+     * needs to bump the generation, and none of the arrays need to be
+     * cleared or allocated again.  The index shouldn't be changed once
+     * the workspace has been used, unless the number of positions it
+     * covers changes too.  The type of queue of steps yet to be taken
+     * is a template argument.
+     */
+    template< typename Queue = HeapQueue > struct DenseWorkspace {
+        /**
+         * This maps positions to indexes in the arrays of steps.
+         */
+        DenseIndex< T > index;
+
+        /**
+         * These are the steps taken, by index of position.
+         */
+        std::vector< SearchStep > steps;
+
+        /**
+         * These are the generations of the searches which last reached
+         * each position, by index of position.
+         */
+        std::vector< uint32_t > stamps;
+
+        /**
+         * This is the generation of the current search.
+         */
+        uint32_t generation = 0;
+
+        /**
+         * This is the queue of steps yet to be taken.
+         */
+        Queue frontier;
+
+        /**
+         * This is where the neighbors of a position are put.
+         */
+        std::vector< T > neighbors;
+
+        /**
+         * These are the positions reached, in the order first reached.
+         */
+        std::vector< T > reached;
+
+        /**
+         * This sets up the workspace for a new search.
+         */
+        void Begin() {
+            const auto size = index.Size();
+            if (stamps.size() != size) {
+                steps.resize(size);
+                stamps.assign(size, 0);
+                generation = 0;
+            }
+            if (++generation == 0) {
+                std::fill(stamps.begin(), stamps.end(), 0);
+                generation = 1;
+            }
+            frontier.Clear();
+            reached.clear();
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * or nullptr if the position hasn't been reached yet.
+         */
+        SearchStep* Find(const T& position) {
+            const auto i = index(position);
+            if (stamps[i] != generation) {
+                return nullptr;
+            }
+            return &steps[i];
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * adding it first if the position hasn't been reached yet.
+         */
+        SearchStep& Add(const T& position) {
+            const auto i = index(position);
+            if (stamps[i] != generation) {
+                stamps[i] = generation;
+                steps[i] = SearchStep(position, position, 0);
+                reached.push_back(position);
+            }
+            return steps[i];
+        }
+    };
+
     /**
      * This method finds a path from a given starting position
      * to a given destination.
@@ -168,7 +456,10 @@ template< typename T > struct PathFinding {
      *     This is the position to which to find a path.
      *
      * @param[in] findNeighbors
-     *     This function is used to find the neighbors of given positions.
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.  The same
+     *     vector is reused for every call, so that finding neighbors
+     *     doesn't allocate memory once the search is under way.
      *
      * @param[in] moveCost
      *     This function computes the cost of moving from one position
@@ -186,59 +477,807 @@ template< typename T > struct PathFinding {
      *     Information about the path from the given starting position
      *     to the given destination is returned.
      */
-    static Path FindPath(
+    template<
+        typename NeighborFunction,
+        typename CostFunction,
+        typename HeuristicFunction
+    > static Path FindPath(
         const T& startingPosition,
         const T& destination,
         NeighborFunction findNeighbors,
         CostFunction moveCost,
-        CostFunction heuristic,
+        HeuristicFunction heuristic,
         int maxCost = 0
     ) {
-        std::priority_queue< SearchStep > frontier;
-        std::map< T, SearchStep > steps;
-        frontier.emplace(startingPosition, startingPosition, 0);
-        steps[startingPosition] = frontier.top();
-        while (!frontier.empty()) {
-            auto lastStep = frontier.top();
+        MapWorkspace<> workspace;
+        return FindPath(
+            workspace,
+            startingPosition,
+            destination,
+            findNeighbors,
+            moveCost,
+            heuristic,
+            maxCost
+        );
+    }
+
+    /**
+     * This method finds a path from a given starting position
+     * to a given destination, using the given workspace, which can be
+     * reused for other searches afterwards.
+     *
+     * @param[in,out] workspace
+     *     This holds what the search needs as it goes.  It's either
+     *     a MapWorkspace or a DenseWorkspace.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     a path to the given destination.
+     *
+     * @param[in] destination
+     *     This is the position to which to find a path.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] heuristic
+     *     This function estimates the remaining cost of moving from
+     *     a given position to another.
+     *
+     * @param[in] maxCost
+     *     If non-zero, this sets a maximum cost for the path to
+     *     find.
+     *
+     * @return
+     *     Information about the path from the given starting position
+     *     to the given destination is returned.
+     */
+    template<
+        typename Workspace,
+        typename NeighborFunction,
+        typename CostFunction,
+        typename HeuristicFunction
+    > static Path FindPath(
+        Workspace& workspace,
+        const T& startingPosition,
+        const T& destination,
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        HeuristicFunction heuristic,
+        int maxCost = 0
+    ) {
+        workspace.Begin();
+        auto& frontier = workspace.frontier;
+        auto& neighbors = workspace.neighbors;
+        frontier.Push(SearchStep(startingPosition, startingPosition, 0));
+        (void)workspace.Add(startingPosition);
+        while (!frontier.Empty()) {
+            const auto lastStep = frontier.Top();
             if (lastStep.position == destination) {
                 Path path;
                 path.reachable = true;
-                path.cost = steps[lastStep.position].cost;
-                for (auto position = lastStep.position; position != startingPosition; position = steps[position].previous) {
+                path.cost = workspace.Find(lastStep.position)->cost;
+                for (auto position = lastStep.position; position != startingPosition; position = workspace.Find(position)->previous) {
                     path.steps.push_back(position);
                 }
                 std::reverse(path.steps.begin(), path.steps.end());
                 return path;
             }
-            frontier.pop();
-            for (const auto& nextStepPosition: findNeighbors(lastStep.position)) {
-                auto nextStepCost = moveCost(lastStep.position, nextStepPosition);
-                const auto nextStepHeuristic = heuristic(nextStepPosition, destination);
-                nextStepCost += steps[lastStep.position].cost;
-                if (
-                    (maxCost > 0)
-                    && (nextStepCost + nextStepHeuristic > maxCost)
-                ) {
-                    continue;
-                }
-                auto step = steps.find(nextStepPosition);
-                if (
-                    (step == steps.end())
-                    || (nextStepCost < step->second.cost)
-                ) {
-                    steps[nextStepPosition].cost = nextStepCost;
-                    steps[nextStepPosition].previous = lastStep.position;
-                    frontier.emplace(
-                        nextStepPosition,
-                        lastStep.position,
-                        nextStepCost + nextStepHeuristic
-                    );
-                }
+            frontier.Pop();
+            const auto lastStepCost = workspace.Find(lastStep.position)->cost;
+            if (lastStep.previous != workspace.Find(lastStep.position)->previous) {
+                continue;
+            }
+            neighbors.clear();
+            findNeighbors(lastStep.position, neighbors);
+            for (const auto& nextStepPosition: neighbors) {
+                auto nextStepCost = moveCost(lastStep.position, nextStepPosition);
+                const auto nextStepHeuristic = heuristic(nextStepPosition, destination);
+                nextStepCost += lastStepCost;
+                if (
+                    (maxCost > 0)
+                    && (nextStepCost + nextStepHeuristic > maxCost)
+                ) {
+                    continue;
+                }
+                const auto step = workspace.Find(nextStepPosition);
+                if (
+                    (step == nullptr)
+                    || (nextStepCost < step->cost)
+                ) {
+                    auto& nextStep = workspace.Add(nextStepPosition);
+                    nextStep.cost = nextStepCost;
+                    nextStep.previous = lastStep.position;
+                    frontier.Push(
+                        SearchStep(
+                            nextStepPosition,
+                            lastStep.position,
+                            nextStepCost + nextStepHeuristic
+                        )
+                    );
+                }
+            }
+        }
+        return Path();
+    }
+
+    /**
+     * This method finds a path from a given starting position to a given
+     * destination on a grid where every move is one step up, down, left,
+     * or right, and every move into an open cell costs the same.  It's
+     * an A* search, using the Manhattan distance as its heuristic, which
+     * only stops at jump points: positions where a shortest path may
+     * have to turn.  Of all the shortest paths which differ only in the
+     * order of their moves, only the one which makes each vertical move
+     * as early as possible is followed, so a horizontal move is only
+     * followed by a vertical one where a wall behind forces it, and
+     * a vertical move only stops where a horizontal jump from it would
+     * find a jump point.  The type of position must have integer x and
+     * y members.
+     *
+     * @param[in,out] workspace
+     *     This holds what the search needs as it goes.  It's either
+     *     a MapWorkspace or a DenseWorkspace.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     a path to the given destination.
+     *
+     * @param[in] destination
+     *     This is the position to which to find a path.
+     *
+     * @param[in] isOpen
+     *     This function indicates whether or not a given position can be
+     *     moved into.  It must return false for every position beyond
+     *     the edges of the grid.
+     *
+     * @return
+     *     Information about the path from the given starting position
+     *     to the given destination is returned.
+     */
+    template<
+        typename Workspace,
+        typename OpenFunction
+    > static Path FindPathJumping(
+        Workspace& workspace,
+        const T& startingPosition,
+        const T& destination,
+        OpenFunction isOpen
+    ) {
+        workspace.Begin();
+        auto& frontier = workspace.frontier;
+        auto& neighbors = workspace.neighbors;
+        frontier.Push(SearchStep(startingPosition, startingPosition, Distance(startingPosition, destination)));
+        (void)workspace.Add(startingPosition);
+        while (!frontier.Empty()) {
+            const auto lastStep = frontier.Top();
+            if (lastStep.position == destination) {
+                Path path;
+                path.reachable = true;
+                path.cost = workspace.Find(lastStep.position)->cost;
+                for (auto position = lastStep.position; position != startingPosition;) {
+                    const auto previous = workspace.Find(position)->previous;
+                    while (position != previous) {
+                        path.steps.push_back(position);
+                        position.x += Direction(previous.x - position.x);
+                        position.y += Direction(previous.y - position.y);
+                    }
+                }
+                std::reverse(path.steps.begin(), path.steps.end());
+                return path;
+            }
+            frontier.Pop();
+            const auto lastStepCost = workspace.Find(lastStep.position)->cost;
+            if (lastStep.cost > lastStepCost + Distance(lastStep.position, destination)) {
+                continue;
+            }
+
+            // Find the jump points in each direction the search may take
+            // from here, given the direction it came from.
+            const auto previous = workspace.Find(lastStep.position)->previous;
+            const auto dx = Direction(lastStep.position.x - previous.x);
+            const auto dy = Direction(lastStep.position.y - previous.y);
+            neighbors.clear();
+            T jumpPoint;
+            for (int sign = -1; sign <= 1; sign += 2) {
+                if (
+                    (dx == 0)
+                    || (dx == sign)
+                ) {
+                    if (JumpHorizontally(lastStep.position, sign, destination, isOpen, jumpPoint)) {
+                        neighbors.push_back(jumpPoint);
+                    }
+                }
+                auto side = lastStep.position;
+                side.y += sign;
+                auto sideBehind = side;
+                sideBehind.x -= dx;
+                if (
+                    (
+                        (dx == 0)
+                        && (dy != -sign)
+                    )
+                    || (
+                        (dx != 0)
+                        && isOpen(side)
+                        && !isOpen(sideBehind)
+                    )
+                ) {
+                    if (JumpVertically(lastStep.position, sign, destination, isOpen, jumpPoint)) {
+                        neighbors.push_back(jumpPoint);
+                    }
+                }
+            }
+            for (const auto& nextStepPosition: neighbors) {
+                const auto nextStepCost = lastStepCost + Distance(lastStep.position, nextStepPosition);
+                const auto step = workspace.Find(nextStepPosition);
+                if (
+                    (step == nullptr)
+                    || (nextStepCost < step->cost)
+                ) {
+                    auto& nextStep = workspace.Add(nextStepPosition);
+                    nextStep.cost = nextStepCost;
+                    nextStep.previous = lastStep.position;
+                    frontier.Push(
+                        SearchStep(
+                            nextStepPosition,
+                            lastStep.position,
+                            nextStepCost + Distance(nextStepPosition, destination)
+                        )
+                    );
+                }
+            }
+        }
+        return Path();
+    }
+
+    /**
+     * This returns the sign of the given difference in coordinates.
+     */
+    static int Direction(int difference) {
+        return (difference > 0) - (difference < 0);
+    }
+
+    /**
+     * This returns the Manhattan distance between two positions.
+     */
+    static int Distance(const T& start, const T& end) {
+        return abs(end.x - start.x) + abs(end.y - start.y);
+    }
+
+    /**
+     * This moves horizontally from the given position, in the given
+     * direction, until reaching the destination, a wall, or a position
+     * with an open cell above or below it which has a wall behind it.
+     *
+     * @return
+     *     An indication of whether or not a jump point was found,
+     *     rather than a wall, is returned.
+     */
+    template< typename OpenFunction > static bool JumpHorizontally(
+        T position,
+        int dx,
+        const T& destination,
+        OpenFunction& isOpen,
+        T& jumpPoint
+    ) {
+        for (;;) {
+            position.x += dx;
+            if (!isOpen(position)) {
+                return false;
+            }
+            if (position == destination) {
+                break;
+            }
+            auto above = position;
+            --above.y;
+            auto below = position;
+            ++below.y;
+            auto aboveBehind = above;
+            aboveBehind.x -= dx;
+            auto belowBehind = below;
+            belowBehind.x -= dx;
+            if (
+                (
+                    isOpen(above)
+                    && !isOpen(aboveBehind)
+                )
+                || (
+                    isOpen(below)
+                    && !isOpen(belowBehind)
+                )
+            ) {
+                break;
+            }
+        }
+        jumpPoint = position;
+        return true;
+    }
+
+    /**
+     * This moves vertically from the given position, in the given
+     * direction, until reaching the destination, a wall, or a position
+     * from which a horizontal jump finds a jump point.
+     *
+     * @return
+     *     An indication of whether or not a jump point was found,
+     *     rather than a wall, is returned.
+     */
+    template< typename OpenFunction > static bool JumpVertically(
+        T position,
+        int dy,
+        const T& destination,
+        OpenFunction& isOpen,
+        T& jumpPoint
+    ) {
+        T horizontalJumpPoint;
+        for (;;) {
+            position.y += dy;
+            if (!isOpen(position)) {
+                return false;
+            }
+            if (
+                (position == destination)
+                || JumpHorizontally(position, -1, destination, isOpen, horizontalJumpPoint)
+                || JumpHorizontally(position, 1, destination, isOpen, horizontalJumpPoint)
+            ) {
+                break;
+            }
+        }
+        jumpPoint = position;
+        return true;
+    }
+
+};
+
+/**
+ * This template plans paths incrementally, using the D* Lite algorithm,
+ * where the type of position is a template argument.  It searches
+ * backward from a set of goals toward a starting position, which may
+ * move along the path, and keeps what it learns between plans, so that
+ * when positions become goals, stop being goals, or gain or lose
+ * neighbors, only the part of the plan affected by the change is
+ * repaired, rather than planning again from scratch.  Every move must
+ * be reversible, costing the same both ways.  The kind of statistics
+ * to keep about the planning is also a template argument.
+ */
+template<
+    typename T,
+    typename Stats = NoStats
+> struct IncrementalPlanner {
+    /**
+     * This is the cost of a position from which no goal can be reached.
+     */
+    static constexpr int UNREACHABLE = std::numeric_limits< int >::max();
+
+    /**
+     * This is the priority of a position waiting to be planned,
+     * compared first by the estimated cost of a path from the start
+     * through the position, and then by the cost from the position
+     * to the nearest goal.
+     */
+    struct Key {
+        int estimate = UNREACHABLE;
+        int cost = UNREACHABLE;
+
+        Key() = default;
+
+        Key(int estimate, int cost)
+            : estimate(estimate)
+            , cost(cost)
+        {
+        }
+
+        bool operator==(const Key& other) const {
+            return (
+                (estimate == other.estimate)
+                && (cost == other.cost)
+            );
+        }
+
+        bool operator<(const Key& other) const {
+            if (estimate != other.estimate) {
+                return (estimate < other.estimate);
+            }
+            return (cost < other.cost);
+        }
+    };
+
+    /**
+     * This is what the planner knows about a position.
+     */
+    struct Node {
+        /**
+         * This is the cost of the cheapest path from the position
+         * to a goal, as of the last time the position was planned
+         * (the "g" value of D* Lite).
+         */
+        int cost = UNREACHABLE;
+
+        /**
+         * This is the cost of the cheapest path from the position
+         * to a goal, looking one move ahead at the costs of its
+         * neighbors (the "rhs" value of D* Lite).  The position
+         * needs planning whenever this differs from its cost.
+         */
+        int lookahead = UNREACHABLE;
+
+        /**
+         * This indicates whether or not the position is a goal.
+         */
+        bool goal = false;
+
+        /**
+         * This indicates whether or not the position is waiting
+         * to be planned.
+         */
+        bool queued = false;
+
+        /**
+         * This is the priority with which the position was last queued.
+         */
+        Key key;
+    };
+
+    /**
+     * This is a position waiting to be planned, along with the priority
+     * with which it was queued.  A position is queued again whenever its
+     * priority changes, leaving the stale entries to be skipped later.
+     */
+    struct Entry {
+        Key key;
+        T position;
+
+        Entry(
+            const Key& key,
+            const T& position
+        )
+            : key(key)
+            , position(position)
+        {
+        }
+
+        bool operator<(const Entry& other) const {
+            return (other.key < key);
+        }
+    };
+
+    /**
+     * These are the positions the planner knows about.
+     */
+    std::map< T, Node > nodes;
+
+    /**
+     * This is a binary heap of positions waiting to be planned,
+     * with the most urgent first.
+     */
+    std::vector< Entry > frontier;
+
+    /**
+     * This is the position from which paths are planned.
+     */
+    T start;
+
+    /**
+     * This is the sum of the heuristic distances the start has moved
+     * since planning began, which is added to every priority computed
+     * since, so that priorities queued before a move don't have to be
+     * recomputed after it.
+     */
+    int startMoved = 0;
+
+    /**
+     * These are where the neighbors of positions are put.  The
+     * planner needs two, because it looks ahead from each neighbor
+     * of a position it's planning.
+     */
+    std::vector< T > neighbors;
+    std::vector< T > lookaheadNeighbors;
+
+    /**
+     * These are the statistics kept about the planning.
+     */
+    Stats stats;
+
+    /**
+     * This sets up the planner to plan paths from the given starting
+     * position, forgetting anything it has planned before.
+     *
+     * @param[in] startingPosition
+     *     This is the position from which to plan paths.
+     */
+    void Begin(const T& startingPosition) {
+        nodes.clear();
+        frontier.clear();
+        start = startingPosition;
+        startMoved = 0;
+    }
+
+    /**
+     * This returns the cost of the cheapest path planned from the given
+     * position to a goal, or UNREACHABLE if there is none.
+     *
+     * @param[in] position
+     *     This is the position whose cost to return.
+     *
+     * @return
+     *     The cost of the cheapest path planned from the given position
+     *     to a goal is returned, or UNREACHABLE if there is none.
+     */
+    int Cost(const T& position) const {
+        const auto nodesEntry = nodes.find(position);
+        if (nodesEntry == nodes.end()) {
+            return UNREACHABLE;
+        }
+        return nodesEntry->second.cost;
+    }
+
+    /**
+     * This marks whether or not the given position is a goal.  The
+     * position must be updated afterwards.
+     *
+     * @param[in] position
+     *     This is the position to mark.
+     *
+     * @param[in] goal
+     *     This indicates whether or not the position is a goal.
+     */
+    void SetGoal(
+        const T& position,
+        bool goal
+    ) {
+        nodes[position].goal = goal;
+    }
+
+    /**
+     * This moves the starting position of the paths planned.
+     *
+     * @param[in] position
+     *     This is the new position from which to plan paths.
+     *
+     * @param[in] heuristic
+     *     This function estimates the cost of moving from
+     *     a given position to another, without overestimating it.
+     */
+    template< typename HeuristicFunction > void MoveStart(
+        const T& position,
+        HeuristicFunction heuristic
+    ) {
+        stats.Heuristic();
+        startMoved += heuristic(start, position);
+        start = position;
+    }
+
+    /**
+     * This looks again at the given position, whose neighbors, the costs
+     * of moving to them, or whether or not it's a goal have changed,
+     * queueing it to be planned if its cost has changed as a result.
+     * Whenever the moves between two positions change, both positions
+     * must be updated.
+     *
+     * @param[in] position
+     *     This is the position to update.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] heuristic
+     *     This function estimates the cost of moving from
+     *     a given position to another, without overestimating it.
+     */
+    template<
+        typename NeighborFunction,
+        typename CostFunction,
+        typename HeuristicFunction
+    > void Update(
+        const T& position,
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        HeuristicFunction heuristic
+    ) {
+        auto& node = nodes[position];
+        if (node.goal) {
+            node.lookahead = 0;
+        } else {
+            node.lookahead = UNREACHABLE;
+            lookaheadNeighbors.clear();
+            findNeighbors(position, lookaheadNeighbors);
+            for (const auto& neighbor: lookaheadNeighbors) {
+                const auto neighborCost = Cost(neighbor);
+                if (neighborCost == UNREACHABLE) {
+                    continue;
+                }
+                node.lookahead = std::min(
+                    node.lookahead,
+                    neighborCost + moveCost(position, neighbor)
+                );
+            }
+        }
+        if (node.cost == node.lookahead) {
+            node.queued = false;
+        } else {
+            node.key = Prioritize(position, node, heuristic);
+            node.queued = true;
+            Push(Entry(node.key, position));
+        }
+    }
+
+    /**
+     * This repairs the plan after positions have been updated, until
+     * the cost of the cheapest path from the start to a goal is known.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] heuristic
+     *     This function estimates the cost of moving from
+     *     a given position to another, without overestimating it.
+     *
+     * @return
+     *     An indication of whether or not any goal can be reached
+     *     from the start is returned.
+     */
+    template<
+        typename NeighborFunction,
+        typename CostFunction,
+        typename HeuristicFunction
+    > bool Plan(
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        HeuristicFunction heuristic
+    ) {
+        stats.Begin();
+        while (!frontier.empty()) {
+            const auto entry = frontier.front();
+            auto& node = nodes[entry.position];
+            if (
+                !node.queued
+                || !(node.key == entry.key)
+            ) {
+                Pop();
+                stats.Stale();
+                continue;
+            }
+            auto& startNode = nodes[start];
+            if (
+                !(entry.key < Prioritize(start, startNode, heuristic))
+                && (startNode.cost == startNode.lookahead)
+            ) {
+                break;
+            }
+            Pop();
+            const auto key = Prioritize(entry.position, node, heuristic);
+            if (entry.key < key) {
+                node.key = key;
+                Push(Entry(key, entry.position));
+                continue;
+            }
+            node.queued = false;
+            stats.Expand(entry.position);
+            if (node.cost > node.lookahead) {
+                stats.Relax();
+                node.cost = node.lookahead;
+            } else {
+                node.cost = UNREACHABLE;
+                Update(entry.position, findNeighbors, moveCost, heuristic);
+            }
+            neighbors.clear();
+            findNeighbors(entry.position, neighbors);
+            for (const auto& neighbor: neighbors) {
+                Update(neighbor, findNeighbors, moveCost, heuristic);
+            }
+        }
+        stats.End();
+        return (Cost(start) != UNREACHABLE);
+    }
+
+    /**
+     * This returns the next position along the cheapest path planned
+     * from the start to a goal, or the start itself if no goal
+     * can be reached.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @return
+     *     The next position along the cheapest path planned from the
+     *     start to a goal is returned, or the start itself if no goal
+     *     can be reached.
+     */
+    template<
+        typename NeighborFunction,
+        typename CostFunction
+    > T NextStep(
+        NeighborFunction findNeighbors,
+        CostFunction moveCost
+    ) {
+        auto next = start;
+        auto nextCost = UNREACHABLE;
+        neighbors.clear();
+        findNeighbors(start, neighbors);
+        for (const auto& neighbor: neighbors) {
+            const auto neighborCost = Cost(neighbor);
+            if (neighborCost == UNREACHABLE) {
+                continue;
+            }
+            const auto cost = neighborCost + moveCost(start, neighbor);
+            if (cost < nextCost) {
+                next = neighbor;
+                nextCost = cost;
             }
         }
-        return Path();
+        return next;
+    }
+
+    /**
+     * This computes the priority with which to plan the given position.
+     *
+     * @param[in] position
+     *     This is the position to prioritize.
+     *
+     * @param[in] node
+     *     This is what the planner knows about the position.
+     *
+     * @param[in] heuristic
+     *     This function estimates the cost of moving from
+     *     a given position to another, without overestimating it.
+     *
+     * @return
+     *     The priority with which to plan the given position is returned.
+     */
+    template< typename HeuristicFunction > Key Prioritize(
+        const T& position,
+        const Node& node,
+        HeuristicFunction heuristic
+    ) {
+        const auto cost = std::min(node.cost, node.lookahead);
+        if (cost == UNREACHABLE) {
+            return Key();
+        }
+        stats.Heuristic();
+        return Key(cost + heuristic(start, position) + startMoved, cost);
+    }
+
+    /**
+     * This queues the given entry to be planned.
+     *
+     * @param[in] entry
+     *     This is the entry to queue.
+     */
+    void Push(const Entry& entry) {
+        stats.Push();
+        frontier.push_back(entry);
+        std::push_heap(frontier.begin(), frontier.end());
     }
 
+    /**
+     * This removes the most urgent entry from the queue.
+     */
+    void Pop() {
+        stats.Pop();
+        std::pop_heap(frontier.begin(), frontier.end());
+        frontier.pop_back();
+    }
 };
 
 enum class Cell {
@@ -297,6 +1336,205 @@ struct Position {
     }
 };
 
+/**
+ * This maps the positions within a rectangle to dense indexes,
+ * in row-major order.
+ */
+template<> struct DenseIndex< Position > {
+    int left = 0;
+    int top = 0;
+    int width = 0;
+    int height = 0;
+
+    size_t Size() const {
+        return (size_t)width * (size_t)height;
+    }
+
+    size_t operator()(const Position& position) const {
+        return (
+            (size_t)(position.y - top) * (size_t)width
+            + (size_t)(position.x - left)
+        );
+    }
+};
+
+/**
+ * This template holds an unbounded two-dimensional grid of cells, where
+ * the type of cell is a template argument.  The grid is stored sparsely,
+ * in square chunks of cells found through a hash table, so that any cell
+ * can be reached in constant time, and cells near the last one reached
+ * are reached without even looking up their chunk.  The grid keeps track
+ * of the bounds of the cells which have been set.
+ */
+template< typename T > struct Grid {
+    /**
+     * This is the base-2 logarithm of the width and height of a chunk.
+     */
+    static constexpr int CHUNK_BITS = 6;
+
+    /**
+     * This is the width and height of a chunk.
+     */
+    static constexpr int CHUNK_SIZE = 1 << CHUNK_BITS;
+
+    /**
+     * This holds the cells in one square area of the grid.
+     */
+    struct Chunk {
+        std::vector< T > cells = std::vector< T >(CHUNK_SIZE * CHUNK_SIZE);
+        std::vector< bool > set = std::vector< bool >(CHUNK_SIZE * CHUNK_SIZE);
+    };
+
+    /**
+     * These are the chunks of the grid which have any cells set,
+     * keyed by the coordinates of the chunks.
+     */
+    std::unordered_map< uint64_t, Chunk > chunks;
+
+    /**
+     * This is the chunk reached last, and its key.
+     */
+    mutable const Chunk* lastChunk = nullptr;
+    mutable uint64_t lastKey = 0;
+
+    /**
+     * This is the value of a cell which has never been set.
+     */
+    T unset = T();
+
+    /**
+     * This is the number of cells which have been set.
+     */
+    size_t count = 0;
+
+    /**
+     * These are the bounds of the cells which have been set.
+     */
+    int minX = 0;
+    int maxX = 0;
+    int minY = 0;
+    int maxY = 0;
+
+    static uint64_t Key(int x, int y) {
+        return (
+            ((uint64_t)(uint32_t)(x >> CHUNK_BITS) << 32)
+            | (uint64_t)(uint32_t)(y >> CHUNK_BITS)
+        );
+    }
+
+    static size_t Index(int x, int y) {
+        return (
+            (size_t)(y & (CHUNK_SIZE - 1)) * CHUNK_SIZE
+            + (size_t)(x & (CHUNK_SIZE - 1))
+        );
+    }
+
+    const Chunk* FindChunk(int x, int y) const {
+        const auto key = Key(x, y);
+        if (
+            (lastChunk != nullptr)
+            && (key == lastKey)
+        ) {
+            return lastChunk;
+        }
+        const auto chunksEntry = chunks.find(key);
+        if (chunksEntry == chunks.end()) {
+            return nullptr;
+        }
+        lastChunk = &chunksEntry->second;
+        lastKey = key;
+        return lastChunk;
+    }
+
+    /**
+     * This returns the number of cells which have been set.
+     */
+    size_t Size() const {
+        return count;
+    }
+
+    /**
+     * This indicates whether or not the given cell has been set.
+     */
+    bool Has(const Position& position) const {
+        const auto chunk = FindChunk(position.x, position.y);
+        return (
+            (chunk != nullptr)
+            && chunk->set[Index(position.x, position.y)]
+        );
+    }
+
+    /**
+     * This returns the value of the given cell, which is the value of
+     * a default-constructed cell if it has never been set.
+     */
+    const T& Get(const Position& position) const {
+        const auto chunk = FindChunk(position.x, position.y);
+        if (chunk == nullptr) {
+            return unset;
+        }
+        return chunk->cells[Index(position.x, position.y)];
+    }
+
+    /**
+     * This returns a reference to the given cell, marking it as set.
+     */
+    T& operator[](const Position& position) {
+        auto chunk = const_cast< Chunk* >(FindChunk(position.x, position.y));
+        if (chunk == nullptr) {
+            const auto key = Key(position.x, position.y);
+            chunk = &chunks[key];
+            lastChunk = chunk;
+            lastKey = key;
+        }
+        const auto index = Index(position.x, position.y);
+        if (!chunk->set[index]) {
+            chunk->set[index] = true;
+            if (count == 0) {
+                minX = maxX = position.x;
+                minY = maxY = position.y;
+            } else {
+                minX = std::min(minX, position.x);
+                maxX = std::max(maxX, position.x);
+                minY = std::min(minY, position.y);
+                maxY = std::max(maxY, position.y);
+            }
+            ++count;
+        }
+        return chunk->cells[index];
+    }
+
+    /**
+     * This calls the given visitor with the position and value of every
+     * cell within the bounds of the grid, in row-major order, including
+     * cells which have never been set.
+     */
+    template< typename Visitor > void ForEach(Visitor visitor) const {
+        if (count == 0) {
+            return;
+        }
+        for (int y = minY; y <= maxY; ++y) {
+            for (int x = minX; x <= maxX;) {
+                const auto chunk = FindChunk(x, y);
+                const auto chunkEnd = std::min(
+                    maxX + 1,
+                    ((x >> CHUNK_BITS) + 1) << CHUNK_BITS
+                );
+                for (; x < chunkEnd; ++x) {
+                    visitor(
+                        Position(x, y),
+                        (
+                            (chunk == nullptr)
+                            ? unset
+                            : chunk->cells[Index(x, y)]
+                        )
+                    );
+                }
+            }
+        }
+    }
+};
+
 intmax_t GetNextNumber(
     const std::string& input,
     size_t& pos
@@ -500,34 +1738,225 @@ struct Machine {
     }
 };
 
-std::vector< Position > Neighbors(const Position& position) {
-    return {
-        {position.x - 1, position.y},
-        {position.x + 1, position.y},
-        {position.x, position.y - 1},
-        {position.x, position.y + 1},
-    };
+bool IsOpen(
+    const Grid< Cell >& cells,
+    const Position& position
+) {
+    return (
+        cells.Has(position)
+        && (cells.Get(position) != Cell::Wall)
+    );
 }
 
-int Cost(
-    const std::map< Position, Cell >& cells,
-    const Position& end
+/**
+ * This is the fewest calls ForEachInParallel gives each thread it uses.
+ * Starting and joining a thread takes about as long as eight robots take
+ * to make a move, so a thread with fewer calls costs more than it saves.
+ * Most layers of the exploration have only a few robots, so they're run
+ * on the calling thread alone.
+ */
+constexpr size_t MIN_CALLS_PER_THREAD = 16;
+
+/**
+ * This function calls the given function once for each index from zero
+ * up to the given count, spreading the calls across as many threads as
+ * the system can run at once, as long as each thread gets at least
+ * MIN_CALLS_PER_THREAD calls.
+ *
+ * @param[in] count
+ *     This is the number of times to call the function.
+ *
+ * @param[in] body
+ *     This is the function to call, with the index of the call.
+ */
+void ForEachInParallel(
+    size_t count,
+    const std::function< void(size_t) >& body
 ) {
-    const auto cellsEntry = cells.find(end);
-    if (cellsEntry == cells.end()) {
-        return 0;
-    } else if (cellsEntry->second == Cell::Wall) {
-        return 1000001;
-    } else {
-        return 1;
+    std::atomic< size_t > next(0);
+    const auto work = [&]{
+        for (;;) {
+            const auto i = next++;
+            if (i >= count) {
+                break;
+            }
+            body(i);
+        }
+    };
+    const auto threads = std::min(
+        (size_t)std::max(std::thread::hardware_concurrency(), 1U),
+        std::max(count / MIN_CALLS_PER_THREAD, (size_t)1)
+    );
+    std::vector< std::thread > workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker: workers) {
+        worker.join();
     }
 }
 
-int PositionHeuristic(const Position& start, const Position& end) {
-    return (
-        abs(end.x - start.x)
-        + abs(end.y - start.y)
+/**
+ * This function explores the ship with a single robot, which always
+ * heads for the nearest cell it hasn't explored yet.  The way there is
+ * planned incrementally, so that each wall or floor the robot finds
+ * only repairs the part of the plan around it, rather than having
+ * to plan again from scratch.
+ *
+ * @param[in,out] machine
+ *     This is the machine which runs the robot.
+ *
+ * @param[in,out] cells
+ *     This is the map of the ship, which is filled in as the robot
+ *     explores it.
+ *
+ * @param[out] oxygenSystem
+ *     This is where to store the position of the oxygen system,
+ *     once it's found.
+ *
+ * @return
+ *     An indication of whether or not the robot explored the ship
+ *     without malfunctioning is returned.
+ */
+bool ExploreWithOneRobot(
+    Machine& machine,
+    Grid< Cell >& cells,
+    Position& oxygenSystem
+) {
+    struct Direction {
+        Position delta;
+        intmax_t input;
+    };
+    static std::vector< Direction > directions{
+        {{ 0, -1}, 1}, // 1: north
+        {{ 0,  1}, 2}, // 2: south
+        {{-1,  0}, 3}, // 3: west
+        {{ 1,  0}, 4}, // 4: east
+    };
+
+    // Plan toward every cell next to an explored one, which isn't itself
+    // explored yet, never through a wall.
+    const auto findNeighbors = [&cells](
+        const Position& position,
+        std::vector< Position >& neighbors
+    ){
+        if (!IsOpen(cells, position)) {
+            return;
+        }
+        for (const auto& direction: directions) {
+            auto neighbor = position;
+            neighbor += direction.delta;
+            if (IsOpen(cells, neighbor)) {
+                neighbors.push_back(neighbor);
+            }
+        }
+    };
+    const auto moveCost = [](const Position&, const Position&){
+        return 1;
+    };
+    const auto heuristic = [](const Position& start, const Position& end){
+        return abs(end.x - start.x) + abs(end.y - start.y);
+    };
+    IncrementalPlanner< Position, SearchStats > planner;
+    Position robotPosition;
+    planner.Begin(robotPosition);
+
+    // Whenever a cell changes, the moves into and out of it change, so
+    // the planner needs to look again at the cell and its neighbors.
+    const auto update = [&](const Position& position){
+        planner.Update(position, findNeighbors, moveCost, heuristic);
+        for (const auto& direction: directions) {
+            auto neighbor = position;
+            neighbor += direction.delta;
+            planner.Update(neighbor, findNeighbors, moveCost, heuristic);
+        }
+    };
+
+    // Whenever the robot reaches a cell, each cell next to it which
+    // hasn't been seen yet becomes a goal.
+    const auto discover = [&](const Position& position){
+        for (const auto& direction: directions) {
+            auto neighbor = position;
+            neighbor += direction.delta;
+            if (!cells.Has(neighbor)) {
+                cells[neighbor] = Cell::Unexplored;
+                planner.SetGoal(neighbor, true);
+                update(neighbor);
+            }
+        }
+    };
+    discover(robotPosition);
+
+    // Keep moving the robot one step along the cheapest path planned
+    // to a goal, until there are none left.
+    size_t moves = 0;
+    size_t plans = 0;
+    while (planner.Plan(findNeighbors, moveCost, heuristic)) {
+        ++plans;
+        const auto target = planner.NextStep(findNeighbors, moveCost);
+        size_t direction = 0;
+        while (
+            (robotPosition.x + directions[direction].delta.x != target.x)
+            || (robotPosition.y + directions[direction].delta.y != target.y)
+        ) {
+            ++direction;
+        }
+
+        // Provide the robot with its instruction, and run the machine
+        // to get the next output.
+        machine.input.push_back(directions[direction].input);
+        std::vector< intmax_t > output;
+        machine.Run(output);
+        ++moves;
+        if (output.size() != 1) {
+            fprintf(stderr, "Robot did not provide correct output!\n");
+            return false;
+        }
+
+        // The machine's output indicates what happened to the robot,
+        // and if it located the oxygen system.
+        switch (output[0]) {
+            case 0: { // hit a wall
+                cells[target] = Cell::Wall;
+                planner.SetGoal(target, false);
+                update(target);
+            } break;
+
+            case 1:   // robot moved
+            case 2: { // robot moved and found oxygen system
+                planner.MoveStart(target, heuristic);
+                robotPosition = target;
+                if (cells.Get(target) != Cell::Unexplored) {
+                    break;
+                }
+                if (output[0] == 1) {
+                    cells[target] = Cell::Floor;
+                } else {
+                    cells[target] = Cell::OxygenSystem;
+                    oxygenSystem = target;
+                    printf("Found the oxygen system after %zu moves!\n", moves);
+                }
+                planner.SetGoal(target, false);
+                update(target);
+                discover(target);
+            } break;
+
+            default: {
+                fprintf(stderr, "MrDestructoid - robot is insane.  Beware, human!\n");
+                return false;
+            } break;
+        }
+    }
+    printf(
+        "The robot explored the ship in %zu moves, repairing its plan %zu times (%zu positions queued, %zu popped, %zu stale).\n",
+        moves,
+        plans,
+        planner.stats.pushed,
+        planner.stats.popped,
+        planner.stats.stale
     );
+    return true;
 }
 
 /**
@@ -546,6 +1975,15 @@ int main(int argc, char* argv[]) {
 #endif /* _WIN32 */
     (void)setbuf(stdout, NULL);
 
+    // With --robot, the ship is explored by a single robot,
+    // rather than by forking robots at every turn.
+    bool singleRobot = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--robot") == 0) {
+            singleRobot = true;
+        }
+    }
+
     // Open the input file and read in the input string.
     std::ifstream input("input.txt");
     std::string line;
@@ -565,109 +2003,133 @@ int main(int argc, char* argv[]) {
     machine.id = 1;
     machine.numbers = std::move(numbers);
 
-    // Explore the section of the ship until the oxygen system is found.
-    std::map< Position, Cell > cells;
-    Position robotPosition;
-    cells[robotPosition] = Cell::Floor;
-
-    // Run the machine, providing as input the a command to move in one of
-    // the cardinal directions, and taking the output the response from
-    // the robot about what it encountered.
-    int minX = 0;
-    int maxX = 0;
-    int minY = 0;
-    int maxY = 0;
+    // Map out the section of the ship.
+    Grid< Cell > cells;
+    cells[Position()] = Cell::Floor;
     Position oxygenSystem;
-    std::stack< size_t > trail;
-    for (;;) {
-        // Look for an unexplored cell next to the robot.
-        struct Direction {
-            Position delta;
-            intmax_t input;
-            size_t back;
-        };
-        static std::vector< Direction > directions{
-            {{ 0, -1}, 1, 1}, // 1: north
-            {{ 0,  1}, 2, 0}, // 2: south
-            {{-1,  0}, 3, 3}, // 3: west
-            {{ 1,  0}, 4, 2}, // 4: east
-        };
-        size_t direction = 0;
-        bool backTracking = true;
-        for (size_t i = 0; i < directions.size(); ++i) {
-            const auto cellsEntry = cells.find(robotPosition + directions[i].delta);
-            if (cellsEntry == cells.end()) {
-                direction = i;
-                backTracking = false;
-                break;
-            }
-        }
-
-        // If we did not find an unexplored cell next the robot,
-        // we need to back-track.
-        if (backTracking) {
-            if (trail.empty()) {
-                break;
-            }
-            printf("Robot is back-tracking (trail is length %zu)\n", trail.size());
-            direction = directions[trail.top()].back;
-            trail.pop();
-        }
+    struct Direction {
+        Position delta;
+        intmax_t input;
+    };
+    static std::vector< Direction > directions{
+        {{ 0, -1}, 1}, // 1: north
+        {{ 0,  1}, 2}, // 2: south
+        {{-1,  0}, 3}, // 3: west
+        {{ 1,  0}, 4}, // 4: east
+    };
 
-        // Provide the robot with its instruction, and run the machine
-        // to get the next output.
-        machine.input.push_back(directions[direction].input);
-        std::vector< intmax_t > output;
-        machine.Run(output);
-        if (output.size() != 1) {
-            fprintf(stderr, "Robot did not provide correct output!\n");
+    if (singleRobot) {
+        if (!ExploreWithOneRobot(machine, cells, oxygenSystem)) {
             return EXIT_FAILURE;
         }
+    } else {
+        // Explore the ship breadth-first.  Rather than having one robot
+        // back-track to each unexplored place, fork a copy of the robot
+        // for each way out of every place reached, and make all the moves
+        // out of the frontier at the same time, so that no robot ever
+        // retraces its steps.
+        struct Robot {
+            Position position;
+            Machine machine;
+        };
+        struct Move {
+            size_t robot = 0;
+            size_t direction = 0;
+            Position target;
+            Machine machine;
+            std::vector< intmax_t > output;
+        };
+        std::vector< Robot > robots(1);
+        robots[0].machine = std::move(machine);
+        size_t distance = 0;
+        while (!robots.empty()) {
+            // Claim each unexplored cell next to a robot, so that only one
+            // robot moves into it.
+            std::vector< Move > moves;
+            for (size_t i = 0; i < robots.size(); ++i) {
+                for (size_t j = 0; j < directions.size(); ++j) {
+                    const auto target = robots[i].position + directions[j].delta;
+                    if (!cells.Has(target)) {
+                        cells[target] = Cell::Unexplored;
+                        Move move;
+                        move.robot = i;
+                        move.direction = j;
+                        move.target = target;
+                        moves.push_back(std::move(move));
+                    }
+                }
+            }
 
-        // The machine's output indicates what happened to the robot,
-        // and if it located the oxygen system.
-        const auto targetPosition = robotPosition + directions[direction].delta;
-        switch (output[0]) {
-            case 0: { // hit a wall
-                printf("Robot found a wall at %dx%d\n", targetPosition.x, targetPosition.y);
-                cells[targetPosition] = Cell::Wall;
-            } break;
+            // Fork a robot for each move, provide it with its instruction,
+            // and run its machine to get the next output.
+            ForEachInParallel(
+                moves.size(),
+                [&](size_t i){
+                    auto& move = moves[i];
+                    move.machine = robots[move.robot].machine;
+                    move.machine.input.push_back(directions[move.direction].input);
+                    move.machine.Run(move.output);
+                }
+            );
 
-            case 1:   // robot moved
-            case 2: { // robot moved and found oxygen system
-                printf("Robot moved to %dx%d\n", targetPosition.x, targetPosition.y);
-                if (!backTracking) {
-                    trail.push(direction);
+            // The output of each machine indicates what happened to its
+            // robot, and if it located the oxygen system.  The robots which
+            // moved make up the next frontier.
+            ++distance;
+            std::vector< Robot > nextRobots;
+            for (auto& move: moves) {
+                if (move.output.size() != 1) {
+                    fprintf(stderr, "Robot did not provide correct output!\n");
+                    return EXIT_FAILURE;
                 }
-                robotPosition = targetPosition;
-                if (output[0] == 1) {
-                    cells[targetPosition] = Cell::Floor;
-                } else {
-                    cells[targetPosition] = Cell::OxygenSystem;
-                    oxygenSystem = targetPosition;
-                    printf("Found the oxygen system!\n");
+                switch (move.output[0]) {
+                    case 0: { // hit a wall
+                        cells[move.target] = Cell::Wall;
+                    } break;
+
+                    case 1:   // robot moved
+                    case 2: { // robot moved and found oxygen system
+                        if (move.output[0] == 1) {
+                            cells[move.target] = Cell::Floor;
+                        } else {
+                            cells[move.target] = Cell::OxygenSystem;
+                            oxygenSystem = move.target;
+                            printf("Found the oxygen system %zu moves away!\n", distance);
+                        }
+                        Robot robot;
+                        robot.position = move.target;
+                        robot.machine = std::move(move.machine);
+                        nextRobots.push_back(std::move(robot));
+                    } break;
+
+                    default: {
+                        fprintf(stderr, "MrDestructoid - robot is insane.  Beware, human!\n");
+                        return EXIT_FAILURE;
+                    } break;
                 }
-            } break;
-
-            default: {
-                fprintf(stderr, "MrDestructoid - robot is insane.  Beware, human!\n");
-                return EXIT_FAILURE;
-            } break;
+            }
+            robots.swap(nextRobots);
+            printf(
+                "Explored %zu moves away; %zu robots still exploring\n",
+                distance,
+                robots.size()
+            );
         }
-        minX = std::min(minX, targetPosition.x);
-        maxX = std::max(maxX, targetPosition.x);
-        minY = std::min(minY, targetPosition.y);
-        maxY = std::max(maxY, targetPosition.y);
     }
 
-    // Use the A* algorithm to find the shortest path to the oxygen system.
-    const auto path = PathFinding< Position >::FindPath(
+    // Use jump point search to find the shortest path to the oxygen
+    // system, since every move through the ship costs the same, keeping
+    // the steps in flat arrays covering the map.
+    PathFinding< Position >::DenseWorkspace<> workspace;
+    workspace.index.left = cells.minX;
+    workspace.index.top = cells.minY;
+    workspace.index.width = cells.maxX - cells.minX + 1;
+    workspace.index.height = cells.maxY - cells.minY + 1;
+    const auto path = PathFinding< Position >::FindPathJumping(
+        workspace,
         {0, 0},
         oxygenSystem,
-        Neighbors,
-        [&cells](const Position& start, const Position& end){ return Cost(cells, end); },
-        PositionHeuristic,
-        1000000
+        [&cells](const Position& position){ return IsOpen(cells, position); }
     );
     printf("Shortest distance: %d\n", path.cost);
 
@@ -680,22 +2142,9 @@ int main(int argc, char* argv[]) {
 
     // Display the cells in the ship.
     printf("-----------------------------------------\n");
-    const auto height = maxY - minY + 1;
-    const auto width = maxX - minX + 1;
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            const Position pos(
-                minX + x,
-                minY + y
-            );
-            const auto cellsEntry = cells.find(pos);
-            int color = 0;
-            if (cellsEntry != cells.end()) {
-                color = (int)cellsEntry->second;
-            }
-            if (robotPosition == pos) {
-                color = 5;
-            }
+    cells.ForEach(
+        [&cells](const Position& pos, Cell cell){
+            auto color = (int)cell;
             if (
                 (pos.x == 0)
                 && (pos.y == 0)
@@ -705,9 +2154,11 @@ int main(int argc, char* argv[]) {
             static const char paints[] = { '?', '.', '#', '@', '+', '%', '*' };
             const auto output = paints[(size_t)color];
             printf("%c", output);
+            if (pos.x == cells.maxX) {
+                printf("\n");
+            }
         }
-        printf("\n");
-    }
+    );
     printf("-----------------------------------------\n");
     return EXIT_SUCCESS;
 }
@@ -8,19 +8,22 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <functional>
 #include <inttypes.h>
 #include <limits>
 #include <map>
 #include <memory>
-#include <queue>
 #include <set>
 #include <sstream>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stack>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _WIN32
@@ -100,41 +103,6 @@ template< typename T > struct PathFinding {
         }
     };
 
-    /**
-     * This is the type of function which determines the immediate
-     * neighbors of a given position.
-     *
-     * @param[in] position
-     *     This is the position for which to find neighbors.
-     *
-     * @return
-     *     The immediate neighbors of the given position are returned.
-     */
-    typedef std::function<
-        std::vector< T >(const T& position)
-    > NeighborFunction;
-
-    /**
-     * This is the type of function which computes the cost
-     * of moving from one position to another.
-     *
-     * @param[in] start
-     *     This is the starting position.
-     *
-     * @param[in] end
-     *     This is the end position.
-     *
-     * @return
-     *     The cost of moving from the start position to the end
-     *     position is returned.
-     */
-    typedef std::function<
-        int(
-            const T& start,
-            const T& end
-        )
-    > CostFunction;
-
     /**
      * This structure holds information returned by the FindPath function.
      */
@@ -157,6 +125,101 @@ template< typename T > struct PathFinding {
         std::vector< T > steps;
     };
 
+    /**
+     * This is a queue of steps yet to be taken, which always gives the
+     * cheapest step next, for any costs.  It's a binary heap, in which
+     * a position is queued again whenever a cheaper way to it is found,
+     * leaving the stale entries to be taken later.
+     */
+    struct HeapQueue {
+        std::vector< SearchStep > steps;
+
+        void Clear() {
+            steps.clear();
+        }
+
+        bool Empty() const {
+            return steps.empty();
+        }
+
+        void Push(const SearchStep& step) {
+            steps.push_back(step);
+            std::push_heap(steps.begin(), steps.end());
+        }
+
+        const SearchStep& Top() {
+            return steps.front();
+        }
+
+        void Pop() {
+            std::pop_heap(steps.begin(), steps.end());
+            steps.pop_back();
+        }
+    };
+
+    /**
+     * This holds what a search needs as it goes, keeping its steps
+     * in a map.
+     * The type of queue of steps yet to be taken is a template argument.
+     */
+    template< typename Queue = HeapQueue > struct MapWorkspace {
+        /**
+         * These are the steps taken so far, keyed by position.
+         */
+        std::map< T, SearchStep > steps;
+
+        /**
+         * This is the queue of steps yet to be taken.
+         */
+        Queue frontier;
+
+        /**
+         * This is where the neighbors of a position are put.
+         */
+        std::vector< T > neighbors;
+
+        /**
+         * These are the positions reached, in the order first reached.
+         */
+        std::vector< T > reached;
+
+        /**
+         * This sets up the workspace for a new search.
+         */
+        void Begin() {
+            steps.clear();
+            frontier.Clear();
+            reached.clear();
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * or nullptr if the position hasn't been reached yet.
+         */
+        SearchStep* Find(const T& position) {
+            const auto stepsEntry = steps.find(position);
+            if (stepsEntry == steps.end()) {
+                return nullptr;
+            }
+            return &stepsEntry->second;
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * adding it first if the position hasn't been reached yet.
+         */
+        SearchStep& Add(const T& position) {
+            const auto stepsEntry = steps.find(position);
+            if (stepsEntry != steps.end()) {
+                return stepsEntry->second;
+            }
+            reached.push_back(position);
+            auto& step = steps[position];
+            step = SearchStep(position, position, 0);
+            return step;
+        }
+    };
+
     /**
      * This method finds a path from a given starting position
      * to a given destination.
@@ -169,7 +232,10 @@ template< typename T > struct PathFinding {
      *     This is the position to which to find a path.
      *
      * @param[in] findNeighbors
-     *     This function is used to find the neighbors of given positions.
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.  The same
+     *     vector is reused for every call, so that finding neighbors
+     *     doesn't allocate memory once the search is under way.
      *
      * @param[in] moveCost
      *     This function computes the cost of moving from one position
@@ -187,52 +253,128 @@ template< typename T > struct PathFinding {
      *     Information about the path from the given starting position
      *     to the given destination is returned.
      */
-    static Path FindPath(
+    template<
+        typename NeighborFunction,
+        typename CostFunction,
+        typename HeuristicFunction
+    > static Path FindPath(
         const T& startingPosition,
         const T& destination,
         NeighborFunction findNeighbors,
         CostFunction moveCost,
-        CostFunction heuristic,
+        HeuristicFunction heuristic,
         int maxCost = 0
     ) {
-        std::priority_queue< SearchStep > frontier;
-        std::map< T, SearchStep > steps;
-        frontier.emplace(startingPosition, startingPosition, 0);
-        steps[startingPosition] = frontier.top();
-        while (!frontier.empty()) {
-            auto lastStep = frontier.top();
+        MapWorkspace<> workspace;
+        return FindPath(
+            workspace,
+            startingPosition,
+            destination,
+            findNeighbors,
+            moveCost,
+            heuristic,
+            maxCost
+        );
+    }
+
+    /**
+     * This method finds a path from a given starting position
+     * to a given destination, using the given workspace, which can be
+     * reused for other searches afterwards.
+     *
+     * @param[in,out] workspace
+     *     This holds what the search needs as it goes.  It's
+     *     a MapWorkspace.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     a path to the given destination.
+     *
+     * @param[in] destination
+     *     This is the position to which to find a path.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] heuristic
+     *     This function estimates the remaining cost of moving from
+     *     a given position to another.
+     *
+     * @param[in] maxCost
+     *     If non-zero, this sets a maximum cost for the path to
+     *     find.
+     *
+     * @return
+     *     Information about the path from the given starting position
+     *     to the given destination is returned.
+     */
+    template<
+        typename Workspace,
+        typename NeighborFunction,
+        typename CostFunction,
+        typename HeuristicFunction
+    > static Path FindPath(
+        Workspace& workspace,
+        const T& startingPosition,
+        const T& destination,
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        HeuristicFunction heuristic,
+        int maxCost = 0
+    ) {
+        workspace.Begin();
+        auto& frontier = workspace.frontier;
+        auto& neighbors = workspace.neighbors;
+        frontier.Push(SearchStep(startingPosition, startingPosition, 0));
+        (void)workspace.Add(startingPosition);
+        while (!frontier.Empty()) {
+            const auto lastStep = frontier.Top();
             if (lastStep.position == destination) {
                 Path path;
                 path.reachable = true;
-                path.cost = steps[lastStep.position].cost;
-                for (auto position = lastStep.position; position != startingPosition; position = steps[position].previous) {
+                path.cost = workspace.Find(lastStep.position)->cost;
+                for (auto position = lastStep.position; position != startingPosition; position = workspace.Find(position)->previous) {
                     path.steps.push_back(position);
                 }
                 std::reverse(path.steps.begin(), path.steps.end());
                 return path;
             }
-            frontier.pop();
-            for (const auto& nextStepPosition: findNeighbors(lastStep.position)) {
+            frontier.Pop();
+            const auto lastStepCost = workspace.Find(lastStep.position)->cost;
+            if (lastStep.previous != workspace.Find(lastStep.position)->previous) {
+                continue;
+            }
+            neighbors.clear();
+            findNeighbors(lastStep.position, neighbors);
+            for (const auto& nextStepPosition: neighbors) {
                 auto nextStepCost = moveCost(lastStep.position, nextStepPosition);
                 const auto nextStepHeuristic = heuristic(nextStepPosition, destination);
-                nextStepCost += steps[lastStep.position].cost;
+                nextStepCost += lastStepCost;
                 if (
                     (maxCost > 0)
                     && (nextStepCost + nextStepHeuristic > maxCost)
                 ) {
                     continue;
                 }
-                auto step = steps.find(nextStepPosition);
+                const auto step = workspace.Find(nextStepPosition);
                 if (
-                    (step == steps.end())
-                    || (nextStepCost < step->second.cost)
+                    (step == nullptr)
+                    || (nextStepCost < step->cost)
                 ) {
-                    steps[nextStepPosition].cost = nextStepCost;
-                    steps[nextStepPosition].previous = lastStep.position;
-                    frontier.emplace(
-                        nextStepPosition,
-                        lastStep.position,
-                        nextStepCost + nextStepHeuristic
+                    auto& nextStep = workspace.Add(nextStepPosition);
+                    nextStep.cost = nextStepCost;
+                    nextStep.previous = lastStep.position;
+                    frontier.Push(
+                        SearchStep(
+                            nextStepPosition,
+                            lastStep.position,
+                            nextStepCost + nextStepHeuristic
+                        )
                     );
                 }
             }
@@ -249,7 +391,10 @@ template< typename T > struct PathFinding {
      *     all reachable places.
      *
      * @param[in] findNeighbors
-     *     This function is used to find the neighbors of given positions.
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.  The same
+     *     vector is reused for every call, so that finding neighbors
+     *     doesn't allocate memory once the search is under way.
      *
      * @param[in] moveCost
      *     This function computes the cost of moving from one position
@@ -263,49 +408,111 @@ template< typename T > struct PathFinding {
      *     A list of places and the total cost to reach them is returned.
      *     This list is sorted by increasing total cost.
      */
-    static std::vector< SearchStep > FindReachablePlaces(
+    template<
+        typename NeighborFunction,
+        typename CostFunction
+    > static std::vector< SearchStep > FindReachablePlaces(
         const T& startingPosition,
         NeighborFunction findNeighbors,
         CostFunction moveCost,
         int maxCost = 0
     ) {
-        std::vector< SearchStep > places;
-        std::priority_queue< SearchStep > frontier;
-        std::map< T, SearchStep > steps;
-        frontier.emplace(startingPosition, startingPosition, 0);
-        steps[startingPosition] = frontier.top();
-        while (!frontier.empty()) {
-            auto lastStep = frontier.top();
-            frontier.pop();
-            for (const auto& nextStepPosition: findNeighbors(lastStep.position)) {
+        MapWorkspace<> workspace;
+        return FindReachablePlaces(
+            workspace,
+            startingPosition,
+            findNeighbors,
+            moveCost,
+            maxCost
+        );
+    }
+
+    /**
+     * This method finds all the places that are reachable from the
+     * given starting position, and the total cost to reach them, using
+     * the given workspace, which can be reused for other searches
+     * afterwards.
+     *
+     * @param[in,out] workspace
+     *     This holds what the search needs as it goes.  It's
+     *     a MapWorkspace.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     all reachable places.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] maxCost
+     *     If non-zero, this sets a maximum cost after which no more
+     *     reachable places are sought after.
+     *
+     * @return
+     *     A list of places and the total cost to reach them is returned.
+     *     This list is sorted by increasing total cost.
+     */
+    template<
+        typename Workspace,
+        typename NeighborFunction,
+        typename CostFunction
+    > static std::vector< SearchStep > FindReachablePlaces(
+        Workspace& workspace,
+        const T& startingPosition,
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        int maxCost = 0
+    ) {
+        workspace.Begin();
+        auto& frontier = workspace.frontier;
+        auto& neighbors = workspace.neighbors;
+        frontier.Push(SearchStep(startingPosition, startingPosition, 0));
+        (void)workspace.Add(startingPosition);
+        while (!frontier.Empty()) {
+            const auto lastStep = frontier.Top();
+            frontier.Pop();
+            const auto lastStepCost = workspace.Find(lastStep.position)->cost;
+            if (lastStep.cost > lastStepCost) {
+                continue;
+            }
+            neighbors.clear();
+            findNeighbors(lastStep.position, neighbors);
+            for (const auto& nextStepPosition: neighbors) {
                 auto nextStepCost = moveCost(lastStep.position, nextStepPosition);
-                nextStepCost += steps[lastStep.position].cost;
+                nextStepCost += lastStepCost;
                 if (
                     (maxCost > 0)
                     && (nextStepCost > maxCost)
                 ) {
                     continue;
                 }
-                auto step = steps.find(nextStepPosition);
+                const auto step = workspace.Find(nextStepPosition);
                 if (
-                    (step == steps.end())
-                    || (nextStepCost < step->second.cost)
+                    (step == nullptr)
+                    || (nextStepCost < step->cost)
                 ) {
-                    auto& nextStep = steps[nextStepPosition];
-                    nextStep.position = nextStepPosition;
+                    auto& nextStep = workspace.Add(nextStepPosition);
                     nextStep.previous = lastStep.position;
                     nextStep.cost = nextStepCost;
-                    frontier.emplace(
-                        nextStepPosition,
-                        lastStep.position,
-                        nextStepCost
+                    frontier.Push(
+                        SearchStep(
+                            nextStepPosition,
+                            lastStep.position,
+                            nextStepCost
+                        )
                     );
                 }
             }
         }
-        for (const auto& step: steps) {
-            if (step.first != startingPosition) {
-                places.push_back(step.second);
+        std::vector< SearchStep > places;
+        for (const auto& position: workspace.reached) {
+            if (position != startingPosition) {
+                places.push_back(*workspace.Find(position));
             }
         }
         std::sort(
@@ -378,6 +585,609 @@ struct Position {
     }
 };
 
+/**
+ * This is a maze with each of its corridors collapsed into a single
+ * weighted edge, so that only the junctions, dead ends, and points of
+ * interest of the maze are left as nodes.
+ */
+struct CorridorGraph {
+    /**
+     * This is one way out of a node, along a corridor.
+     */
+    struct Edge {
+        /**
+         * This is the index of the node at the other end of the corridor.
+         */
+        size_t to;
+
+        /**
+         * This is the number of steps it takes to follow the corridor.
+         */
+        int length;
+
+        /**
+         * These are the doors along the corridor, one bit per door,
+         * including any door at the node at the other end.
+         */
+        uint32_t doors;
+
+        Edge(
+            size_t to,
+            int length,
+            uint32_t doors
+        )
+            : to(to)
+            , length(length)
+            , doors(doors)
+        {
+        }
+    };
+
+    /**
+     * This is a cell of the maze which is kept as a node of the graph.
+     */
+    struct Node {
+        size_t x = 0;
+        size_t y = 0;
+        std::vector< Edge > edges;
+    };
+
+    /**
+     * This is the width of the maze, in cells.
+     */
+    size_t width = 0;
+
+    /**
+     * This is the height of the maze, in cells.
+     */
+    size_t height = 0;
+
+    /**
+     * These are the nodes of the graph, in row-major order.
+     */
+    std::vector< Node > nodes;
+
+    /**
+     * This holds the index of the node at each cell of the maze,
+     * in row-major order, or -1 for cells which aren't nodes.
+     */
+    std::vector< int > nodeAt;
+
+    /**
+     * This returns the index of the node at the given cell of the maze,
+     * or -1 if the cell isn't a node.
+     */
+    int NodeAt(size_t x, size_t y) const {
+        return nodeAt[y * width + x];
+    }
+
+    /**
+     * This returns the number of edges in the graph, counting each
+     * corridor once from each end.
+     */
+    size_t EdgeCount() const {
+        size_t count = 0;
+        for (const auto& node: nodes) {
+            count += node.edges.size();
+        }
+        return count;
+    }
+
+    /**
+     * This returns the length of the shortest edge from one node to
+     * another, using only edges whose doors can all be opened.
+     *
+     * @param[in] from
+     *     This is the index of the node from which to move.
+     *
+     * @param[in] to
+     *     This is the index of the node to which to move.
+     *
+     * @param[in] keys
+     *     These are the doors which can be opened, one bit per door.
+     *
+     * @return
+     *     The length of the shortest edge is returned, or -1 if there
+     *     is no such edge.
+     */
+    int Length(
+        size_t from,
+        size_t to,
+        uint32_t keys
+    ) const {
+        int length = -1;
+        for (const auto& edge: nodes[from].edges) {
+            if (
+                (edge.to == to)
+                && ((edge.doors & ~keys) == 0)
+                && (
+                    (length < 0)
+                    || (edge.length < length)
+                )
+            ) {
+                length = edge.length;
+            }
+        }
+        return length;
+    }
+};
+
+/**
+ * This function collapses every corridor of the given maze into a single
+ * weighted edge between the cells at its ends.  Every open cell which
+ * doesn't have exactly two open neighbors, along with every point of
+ * interest, is kept as a node.
+ *
+ * @param[in] width
+ *     This is the width of the maze, in cells.
+ *
+ * @param[in] height
+ *     This is the height of the maze, in cells.
+ *
+ * @param[in] isOpen
+ *     This function indicates whether or not the cell with the given
+ *     coordinates can ever be moved through.
+ *
+ * @param[in] isPointOfInterest
+ *     This function indicates whether or not the cell with the given
+ *     coordinates must be kept as a node.
+ *
+ * @param[in] doorsAt
+ *     This function returns the doors at the cell with the given
+ *     coordinates, one bit per door.
+ *
+ * @return
+ *     The graph of the maze is returned.
+ */
+template<
+    typename OpenFunction,
+    typename PointOfInterestFunction,
+    typename DoorFunction
+> CorridorGraph ContractCorridors(
+    size_t width,
+    size_t height,
+    OpenFunction isOpen,
+    PointOfInterestFunction isPointOfInterest,
+    DoorFunction doorsAt
+) {
+    CorridorGraph graph;
+    graph.width = width;
+    graph.height = height;
+    graph.nodeAt.assign(width * height, -1);
+    std::vector< bool > open(width * height);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            open[y * width + x] = isOpen(x, y);
+        }
+    }
+
+    // This finds the cell next to the given one in one of the four
+    // directions, if that cell is open.
+    static const int dx[] = {-1, 1, 0, 0};
+    static const int dy[] = {0, 0, -1, 1};
+    const auto findExit = [&](size_t cell, int direction, size_t& next){
+        const auto x = (int)(cell % width) + dx[direction];
+        const auto y = (int)(cell / width) + dy[direction];
+        if (
+            (x < 0)
+            || (x >= (int)width)
+            || (y < 0)
+            || (y >= (int)height)
+        ) {
+            return false;
+        }
+        next = (size_t)y * width + (size_t)x;
+        return (bool)open[next];
+    };
+
+    // Keep every open cell which isn't part of a corridor as a node.
+    size_t next;
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        if (!open[cell]) {
+            continue;
+        }
+        int exits = 0;
+        for (int direction = 0; direction < 4; ++direction) {
+            if (findExit(cell, direction, next)) {
+                ++exits;
+            }
+        }
+        const auto x = cell % width;
+        const auto y = cell / width;
+        if (
+            (exits != 2)
+            || isPointOfInterest(x, y)
+        ) {
+            graph.nodeAt[cell] = (int)graph.nodes.size();
+            CorridorGraph::Node node;
+            node.x = x;
+            node.y = y;
+            graph.nodes.push_back(std::move(node));
+        }
+    }
+
+    // Follow each way out of every node along its corridor
+    // to the node at the other end.
+    for (size_t i = 0; i < graph.nodes.size(); ++i) {
+        auto& node = graph.nodes[i];
+        const auto start = node.y * width + node.x;
+        for (int direction = 0; direction < 4; ++direction) {
+            if (!findExit(start, direction, next)) {
+                continue;
+            }
+            auto previous = start;
+            auto cell = next;
+            int length = 1;
+            auto doors = doorsAt(cell % width, cell / width);
+            while (graph.nodeAt[cell] < 0) {
+                for (int turn = 0; turn < 4; ++turn) {
+                    if (
+                        findExit(cell, turn, next)
+                        && (next != previous)
+                    ) {
+                        break;
+                    }
+                }
+                previous = cell;
+                cell = next;
+                ++length;
+                doors |= doorsAt(cell % width, cell / width);
+            }
+            if (graph.nodeAt[cell] != (int)i) {
+                node.edges.emplace_back((size_t)graph.nodeAt[cell], length, doors);
+            }
+        }
+    }
+    return graph;
+}
+
+/**
+ * This holds how much a maze was shrunk by pruning it.
+ */
+struct PruneReport {
+    /**
+     * This is the number of open cells in the maze before pruning.
+     */
+    size_t openCells = 0;
+
+    /**
+     * This is the number of open cells which were walled off because
+     * they couldn't be reached.
+     */
+    size_t unreachableCells = 0;
+
+    /**
+     * This is the number of open cells which were filled in because
+     * they were at the end of a dead end holding nothing of interest.
+     */
+    size_t deadEndCells = 0;
+};
+
+/**
+ * This function shrinks the given maze, by walling off every open cell
+ * which can't be reached from an entrance, and then repeatedly filling
+ * in every dead end which holds nothing of interest, until none is left.
+ * Neither changes the shortest path between any two points of interest.
+ *
+ * @param[in,out] lines
+ *     These are the lines of the maze.  Pruned cells are replaced
+ *     with the given wall.
+ *
+ * @param[in] wall
+ *     This is the cell with which to replace pruned cells.
+ *
+ * @param[in] isOpen
+ *     This function indicates whether or not the given cell can ever
+ *     be moved through.
+ *
+ * @param[in] isEntrance
+ *     This function indicates whether or not the maze can be entered
+ *     at the cell with the given coordinates.
+ *
+ * @param[in] isPointOfInterest
+ *     This function indicates whether or not the cell with the given
+ *     coordinates must be kept open.
+ *
+ * @return
+ *     A report of how much the maze was shrunk is returned.
+ */
+template<
+    typename OpenFunction,
+    typename EntranceFunction,
+    typename PointOfInterestFunction
+> PruneReport PruneMaze(
+    std::vector< std::string >& lines,
+    char wall,
+    OpenFunction isOpen,
+    EntranceFunction isEntrance,
+    PointOfInterestFunction isPointOfInterest
+) {
+    PruneReport report;
+    const auto height = lines.size();
+    const auto width = lines[0].length();
+    static const int dx[] = {-1, 1, 0, 0};
+    static const int dy[] = {0, 0, -1, 1};
+    const auto findExit = [&](size_t cell, int direction, size_t& next){
+        const auto x = (int)(cell % width) + dx[direction];
+        const auto y = (int)(cell / width) + dy[direction];
+        if (
+            (x < 0)
+            || (x >= (int)width)
+            || (y < 0)
+            || (y >= (int)height)
+        ) {
+            return false;
+        }
+        next = (size_t)y * width + (size_t)x;
+        return isOpen(lines[(size_t)y][(size_t)x]);
+    };
+
+    // Spread out from the entrances to find the cells which can be
+    // reached, and wall off the rest.
+    std::vector< bool > reached(width * height);
+    std::vector< size_t > frontier;
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        const auto x = cell % width;
+        const auto y = cell / width;
+        if (!isOpen(lines[y][x])) {
+            continue;
+        }
+        ++report.openCells;
+        if (isEntrance(x, y)) {
+            reached[cell] = true;
+            frontier.push_back(cell);
+        }
+    }
+    size_t next;
+    while (!frontier.empty()) {
+        const auto cell = frontier.back();
+        frontier.pop_back();
+        for (int direction = 0; direction < 4; ++direction) {
+            if (
+                findExit(cell, direction, next)
+                && !reached[next]
+            ) {
+                reached[next] = true;
+                frontier.push_back(next);
+            }
+        }
+    }
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        auto& contents = lines[cell / width][cell % width];
+        if (
+            isOpen(contents)
+            && !reached[cell]
+        ) {
+            contents = wall;
+            ++report.unreachableCells;
+        }
+    }
+
+    // Fill in each dead end holding nothing of interest, and then look
+    // at the cell it led to, which may have become a dead end itself.
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        if (isOpen(lines[cell / width][cell % width])) {
+            frontier.push_back(cell);
+        }
+    }
+    while (!frontier.empty()) {
+        const auto cell = frontier.back();
+        frontier.pop_back();
+        const auto x = cell % width;
+        const auto y = cell / width;
+        if (
+            !isOpen(lines[y][x])
+            || isPointOfInterest(x, y)
+        ) {
+            continue;
+        }
+        int exits = 0;
+        size_t onward = 0;
+        for (int direction = 0; direction < 4; ++direction) {
+            if (findExit(cell, direction, next)) {
+                ++exits;
+                onward = next;
+            }
+        }
+        if (exits <= 1) {
+            lines[y][x] = wall;
+            ++report.deadEndCells;
+            if (exits == 1) {
+                frontier.push_back(onward);
+            }
+        }
+    }
+    return report;
+}
+
+/**
+ * This function calls the given function once for each index from zero
+ * up to the given count, spreading the calls across as many threads as
+ * the system can run at once.
+ *
+ * @param[in] count
+ *     This is the number of times to call the function.
+ *
+ * @param[in] body
+ *     This is the function to call, with the index of the call.
+ */
+void ForEachInParallel(
+    size_t count,
+    const std::function< void(size_t) >& body
+) {
+    std::atomic< size_t > next(0);
+    const auto work = [&]{
+        for (;;) {
+            const auto i = next++;
+            if (i >= count) {
+                break;
+            }
+            body(i);
+        }
+    };
+    const auto threads = std::min(
+        (size_t)std::max(std::thread::hardware_concurrency(), 1U),
+        count
+    );
+    std::vector< std::thread > workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker: workers) {
+        worker.join();
+    }
+}
+
+/**
+ * This holds the length of the shortest path between every pair of
+ * points of interest of a corridor graph, along with the doors crossed
+ * along each path, so that searches which only move from one point of
+ * interest to another can look up how to get there, rather than
+ * searching the graph again every time.
+ */
+struct DistanceMatrix {
+    /**
+     * These are the nodes of the graph which are points of interest,
+     * in the order in which they're numbered in the matrix.
+     */
+    std::vector< size_t > points;
+
+    /**
+     * This holds the number of the point of interest at each node of
+     * the graph, or -1 if the node isn't a point of interest.
+     */
+    std::vector< int > pointAt;
+
+    /**
+     * These are the lengths of the shortest paths from each point of
+     * interest to every other, a row per point, with -1 where there's
+     * no path.
+     */
+    std::vector< int > lengths;
+
+    /**
+     * These are the doors crossed along the shortest paths from each
+     * point of interest to every other, a row per point, one bit
+     * per door.
+     */
+    std::vector< uint32_t > doors;
+
+    /**
+     * This returns the number of the point of interest at the given
+     * node of the graph, or -1 if the node isn't a point of interest.
+     */
+    int PointAt(size_t node) const {
+        return pointAt[node];
+    }
+
+    /**
+     * This returns the length of the shortest path from one point
+     * of interest to another, or -1 if there's no path.
+     */
+    int Length(
+        size_t from,
+        size_t to
+    ) const {
+        return lengths[from * points.size() + to];
+    }
+
+    /**
+     * This returns the doors crossed along the shortest path from one
+     * point of interest to another, one bit per door.
+     */
+    uint32_t Doors(
+        size_t from,
+        size_t to
+    ) const {
+        return doors[from * points.size() + to];
+    }
+};
+
+/**
+ * This function finds the shortest paths between every pair of the given
+ * points of interest of the given graph, and the doors crossed along
+ * each, searching from each point of interest on a separate thread.
+ * Every door is considered open, so where a longer path would avoid
+ * a door, only the shorter one, through the door, is kept.
+ *
+ * @param[in] graph
+ *     This is the graph to search.
+ *
+ * @param[in] points
+ *     These are the nodes of the graph which are points of interest.
+ *
+ * @return
+ *     The distances between the points of interest are returned.
+ */
+DistanceMatrix MeasureDistances(
+    const CorridorGraph& graph,
+    const std::vector< size_t >& points
+) {
+    DistanceMatrix matrix;
+    const auto count = points.size();
+    matrix.points = points;
+    matrix.pointAt.assign(graph.nodes.size(), -1);
+    for (size_t i = 0; i < count; ++i) {
+        matrix.pointAt[points[i]] = (int)i;
+    }
+    matrix.lengths.assign(count * count, -1);
+    matrix.doors.assign(count * count, 0);
+    ForEachInParallel(
+        count,
+        [&](size_t i){
+            // Search the whole graph from the point of interest,
+            // going through any door.
+            const auto start = points[i];
+            const auto places = PathFinding< size_t >::FindReachablePlaces(
+                start,
+                [&](size_t node, std::vector< size_t >& neighbors){
+                    for (const auto& edge: graph.nodes[node].edges) {
+                        neighbors.push_back(edge.to);
+                    }
+                },
+                [&](size_t from, size_t to){ return graph.Length(from, to, ~(uint32_t)0); }
+            );
+            std::vector< const PathFinding< size_t >::SearchStep* > stepAt(graph.nodes.size(), nullptr);
+            for (const auto& place: places) {
+                stepAt[place.position] = &place;
+            }
+
+            // Follow the path back from every other point of interest
+            // reached, picking up the doors of the edges along the way.
+            matrix.lengths[i * count + i] = 0;
+            for (size_t j = 0; j < count; ++j) {
+                auto node = points[j];
+                if (stepAt[node] == nullptr) {
+                    continue;
+                }
+                matrix.lengths[i * count + j] = stepAt[node]->cost;
+                uint32_t doors = 0;
+                while (node != start) {
+                    const auto& step = *stepAt[node];
+                    const auto previousCost = (
+                        (step.previous == start)
+                        ? 0
+                        : stepAt[step.previous]->cost
+                    );
+                    for (const auto& edge: graph.nodes[step.previous].edges) {
+                        if (
+                            (edge.to == node)
+                            && (edge.length == step.cost - previousCost)
+                        ) {
+                            doors |= edge.doors;
+                            break;
+                        }
+                    }
+                    node = step.previous;
+                }
+                matrix.doors[i * count + j] = doors;
+            }
+        }
+    );
+    return matrix;
+}
+
 intmax_t GetNextNumber(
     const std::string& input,
     size_t& pos
@@ -581,48 +1391,51 @@ struct Machine {
     }
 };
 
-std::vector< Position > Neighbors(const Position& position) {
-    return {
-        {position.x - 1, position.y},
-        {position.x + 1, position.y},
-        {position.x, position.y - 1},
-        {position.x, position.y + 1},
-    };
-}
-
-int Cost(
-    const std::vector< std::string >& lines,
-    const std::set< char >& keys,
-    const Position& end
-) {
-    const auto height = lines.size();
-    const auto width = lines[0].length();
-    const auto cell = lines[end.y][end.x];
-    if (cell == '#') {
-        return 1000001;
-    } else if (cell == '.') {
-        return 1;
-    } else if (cell == '@') {
-        return 1;
-    } else if (
-        (cell >= 'a')
-        && (cell <= 'z')
-    ) {
-        return 1;
-    } else if (
+/**
+ * This function returns the door in the given cell of the map, as one bit
+ * of a set of doors, or zero if the cell isn't a door.
+ */
+uint32_t DoorAt(char cell) {
+    if (
         (cell >= 'A')
         && (cell <= 'Z')
     ) {
-        if (keys.find(cell + 'a' - 'A') == keys.end()) {
-            return 1000001;
-        } else {
-            return 1;
-        }
+        return (uint32_t)1 << (cell - 'A');
     } else {
         return 0;
     }
 }
 
+/**
+ * This function returns the doors which can be opened with the given
+ * keys, one bit per door.
+ */
+uint32_t DoorsOpenedBy(const std::set< char >& keys) {
+    uint32_t doors = 0;
+    for (const auto key: keys) {
+        doors |= DoorAt(key + 'A' - 'a');
+    }
+    return doors;
+}
+
+/**
+ * This function calls the given function with each node of the given
+ * graph which can be reached from the given node in one move, without
+ * going through any door which can't be opened.
+ */
+void GraphNeighbors(
+    const CorridorGraph& graph,
+    uint32_t doorsOpened,
+    size_t node,
+    std::vector< size_t >& neighbors
+) {
+    for (const auto& edge: graph.nodes[node].edges) {
+        if ((edge.doors & ~doorsOpened) == 0) {
+            neighbors.push_back(edge.to);
+        }
+    }
+}
+
 int PositionHeuristic(const Position& start, const Position& end) {
     return (
         abs(end.x - start.x)
@@ -647,6 +1460,8 @@ std::string EncodePath(
 
 void FindShortestPath(
     const std::vector< std::string >& lines,
+    const CorridorGraph& graph,
+    const DistanceMatrix& matrix,
     const std::set< char >& keys,
     const Position& position,
     std::map< std::string, int >& pathsTried,
@@ -662,17 +1477,69 @@ void FindShortestPath(
         return;
     }
     printf("%s - %d\n", path.c_str(), bestSteps);
-    const auto height = lines.size();
-    const auto width = lines[0].length();
-    const auto places = PathFinding< Position >::FindReachablePlaces(
-        position,
-        Neighbors,
-        [&](const Position& start, const Position& end){ return Cost(lines, keys, end); },
-        1000000
+    // Look up the keys yet to be collected which can be reached from the
+    // current position, and take them nearest first, and in reading order
+    // for those the same distance away.  The shortest path to a key may
+    // go through a door which can't be opened yet, in which case the
+    // graph is searched instead for a longer way around the door.
+    const auto doorsOpened = DoorsOpenedBy(keys);
+    const auto fromNode = (size_t)graph.NodeAt((size_t)position.x, (size_t)position.y);
+    const auto fromPoint = (size_t)matrix.PointAt(fromNode);
+    PathFinding< size_t >::MapWorkspace<> workspace;
+    std::vector< PathFinding< size_t >::SearchStep > places;
+    for (size_t i = 0; i < matrix.points.size(); ++i) {
+        const auto& keyNode = graph.nodes[matrix.points[i]];
+        const auto cell = lines[keyNode.y][keyNode.x];
+        auto length = matrix.Length(fromPoint, i);
+        if (
+            (i == fromPoint)
+            || (length < 0)
+            || (cell < 'a')
+            || (cell > 'z')
+            || (keys.find(cell) != keys.end())
+        ) {
+            continue;
+        }
+        if ((matrix.Doors(fromPoint, i) & ~doorsOpened) != 0) {
+            const auto path = PathFinding< size_t >::FindPath(
+                workspace,
+                fromNode,
+                matrix.points[i],
+                [&](size_t node, std::vector< size_t >& neighbors){ GraphNeighbors(graph, doorsOpened, node, neighbors); },
+                [&](size_t from, size_t to){ return graph.Length(from, to, doorsOpened); },
+                [&](size_t from, size_t to){
+                    const auto& start = graph.nodes[from];
+                    const auto& end = graph.nodes[to];
+                    return PositionHeuristic(
+                        Position((int)start.x, (int)start.y),
+                        Position((int)end.x, (int)end.y)
+                    );
+                }
+            );
+            if (!path.reachable) {
+                continue;
+            }
+            length = path.cost;
+        }
+        places.emplace_back(matrix.points[i], fromNode, length);
+    }
+    std::sort(
+        places.begin(),
+        places.end(),
+        [](
+            const PathFinding< size_t >::SearchStep& a,
+            const PathFinding< size_t >::SearchStep& b
+        ){
+            if (a.cost != b.cost) {
+                return (a.cost < b.cost);
+            }
+            return (a.position < b.position);
+        }
     );
     bool foundKey = false;
     for (const auto& place: places) {
-        const auto cell = lines[place.position.y][place.position.x];
+        const auto& node = graph.nodes[place.position];
+        const auto cell = lines[node.y][node.x];
         if (
             (cell >= 'a')
             && (cell <= 'z')
@@ -689,8 +1556,10 @@ void FindShortestPath(
             (void)nextKeys.insert(cell);
             FindShortestPath(
                 lines,
+                graph,
+                matrix,
                 nextKeys,
-                place.position,
+                Position((int)node.x, (int)node.y),
                 pathsTried,
                 bestSteps,
                 steps + place.cost
@@ -745,11 +1614,87 @@ int main(int argc, char* argv[]) {
     }
     printf("Map is %zux%zu and entrance is at %dx%d.\n", width, height, position.x, position.y);
 
+    // Wall off the parts of the map which can't be reached, and fill in
+    // the dead ends which hold no keys.
+    const auto report = PruneMaze(
+        lines,
+        '#',
+        [](char cell){ return (cell != '#'); },
+        [&](size_t x, size_t y){ return (lines[y][x] == '@'); },
+        [&](size_t x, size_t y){
+            const auto cell = lines[y][x];
+            return (
+                (cell == '@')
+                || (
+                    (cell >= 'a')
+                    && (cell <= 'z')
+                )
+            );
+        }
+    );
+    printf(
+        "Pruned %zu unreachable and %zu dead-end cells, leaving %zu of %zu open cells.\n",
+        report.unreachableCells,
+        report.deadEndCells,
+        report.openCells - report.unreachableCells - report.deadEndCells,
+        report.openCells
+    );
+
+    // Collapse the corridors of the map, so that finding the keys which
+    // can be reached only needs to consider the junctions, dead ends,
+    // keys, and the entrance.
+    const auto graph = ContractCorridors(
+        width,
+        height,
+        [&](size_t x, size_t y){ return (lines[y][x] != '#'); },
+        [&](size_t x, size_t y){
+            const auto cell = lines[y][x];
+            return (
+                (cell == '@')
+                || (
+                    (cell >= 'a')
+                    && (cell <= 'z')
+                )
+            );
+        },
+        [&](size_t x, size_t y){ return DoorAt(lines[y][x]); }
+    );
+    printf(
+        "Contracted the map into %zu nodes and %zu edges.\n",
+        graph.nodes.size(),
+        graph.EdgeCount()
+    );
+
+    // Measure the distances between the entrance and every key once,
+    // along with the doors in the way, so that the search for the keys
+    // only needs to look them up.
+    const auto startTime = std::chrono::steady_clock::now();
+    std::vector< size_t > points;
+    for (size_t i = 0; i < graph.nodes.size(); ++i) {
+        const auto cell = lines[graph.nodes[i].y][graph.nodes[i].x];
+        if (
+            (cell == '@')
+            || (
+                (cell >= 'a')
+                && (cell <= 'z')
+            )
+        ) {
+            points.push_back(i);
+        }
+    }
+    const auto matrix = MeasureDistances(graph, points);
+    const auto endTime = std::chrono::steady_clock::now();
+    printf(
+        "Measured the distances between %zu points of interest in %lf seconds.\n",
+        points.size(),
+        std::chrono::duration< double >(endTime - startTime).count()
+    );
+
     // Find the shortest path that obtains all the keys.
     std::map< std::string, int > pathsTried;
     std::set< char > keys;
     int steps = 0;
-    FindShortestPath(lines, keys, position, pathsTried, steps, 0);
+    FindShortestPath(lines, graph, matrix, keys, position, pathsTried, steps, 0);
     printf("Shortest path is %d steps.\n", steps);
     return EXIT_SUCCESS;
 }
@@ -8,25 +8,38 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <functional>
 #include <inttypes.h>
 #include <limits>
 #include <map>
 #include <memory>
-#include <queue>
 #include <set>
 #include <sstream>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stack>
 #include <string>
+#include <string.h>
+#include <thread>
 #include <vector>
 
 #ifdef _WIN32
 #include <crtdbg.h>
 #endif /* _WIN32 */
 
+/**
+ * This template maps positions to dense indexes, so that searches can
+ * keep their steps in flat arrays.  It's specialized for each type of
+ * position which can be mapped, with a Size() method returning the
+ * number of indexes, and a function call operator returning the index
+ * of a position.
+ */
+template< typename T > struct DenseIndex;
+
 /**
  * This template is used to find a path from one position
  * to another, where the type of position is a template argument.
@@ -100,41 +113,6 @@ template< typename T > struct PathFinding {
         }
     };
 
-    /**
-     * This is the type of function which determines the immediate
-     * neighbors of a given position.
-     *
-     * @param[in] position
-     *     This is the position for which to find neighbors.
-     *
-     * @return
-     *     The immediate neighbors of the given position are returned.
-     */
-    typedef std::function<
-        std::vector< T >(const T& position)
-    > NeighborFunction;
-
-    /**
-     * This is the type of function which computes the cost
-     * of moving from one position to another.
-     *
-     * @param[in] start
-     *     This is the starting position.
-     *
-     * @param[in] end
-     *     This is the end position.
-     *
-     * @return
-     *     The cost of moving from the start position to the end
-     *     position is returned.
-     */
-    typedef std::function<
-        int(
-            const T& start,
-            const T& end
-        )
-    > CostFunction;
-
     /**
      * This structure holds information returned by the FindPath function.
      */
@@ -157,6 +135,347 @@ template< typename T > struct PathFinding {
         std::vector< T > steps;
     };
 
+    /**
+     * This is a queue of steps yet to be taken, which always gives the
+     * cheapest step next, for any costs.  It's a binary heap, in which
+     * a position is queued again whenever a cheaper way to it is found,
+     * leaving the stale entries to be taken later.
+     */
+    struct HeapQueue {
+        std::vector< SearchStep > steps;
+
+        void Clear() {
+            steps.clear();
+        }
+
+        bool Empty() const {
+            return steps.empty();
+        }
+
+        void Push(const SearchStep& step) {
+            steps.push_back(step);
+            std::push_heap(steps.begin(), steps.end());
+        }
+
+        const SearchStep& Top() {
+            return steps.front();
+        }
+
+        void Pop() {
+            std::pop_heap(steps.begin(), steps.end());
+            steps.pop_back();
+        }
+    };
+
+    /**
+     * This is a queue of steps yet to be taken, which gives steps in
+     * the order they were queued, ignoring their costs.  It's only
+     * suitable when every move costs the same, where it turns the
+     * search into a breadth-first search, which reaches every position
+     * the cheapest way first, so no position is ever queued twice.
+     */
+    struct FifoQueue {
+        std::vector< SearchStep > steps;
+        size_t next = 0;
+
+        void Clear() {
+            steps.clear();
+            next = 0;
+        }
+
+        bool Empty() const {
+            return (next == steps.size());
+        }
+
+        void Push(const SearchStep& step) {
+            steps.push_back(step);
+        }
+
+        const SearchStep& Top() {
+            return steps[next];
+        }
+
+        void Pop() {
+            if (++next == steps.size()) {
+                Clear();
+            }
+        }
+    };
+
+    /**
+     * This is a queue of steps yet to be taken, which always gives the
+     * cheapest step next, for costs which are small integers (Dial's
+     * algorithm).  There's a bucket of steps for every cost, and the
+     * buckets are emptied in order of cost.
+     */
+    struct BucketQueue {
+        std::vector< std::vector< SearchStep > > buckets;
+        size_t current = 0;
+        size_t count = 0;
+
+        void Clear() {
+            for (auto& bucket: buckets) {
+                bucket.clear();
+            }
+            current = 0;
+            count = 0;
+        }
+
+        bool Empty() const {
+            return (count == 0);
+        }
+
+        void Push(const SearchStep& step) {
+            const auto cost = (size_t)step.cost;
+            if (cost >= buckets.size()) {
+                buckets.resize(cost + 1);
+            }
+            buckets[cost].push_back(step);
+            current = std::min(current, cost);
+            ++count;
+        }
+
+        const SearchStep& Top() {
+            while (buckets[current].empty()) {
+                ++current;
+            }
+            return buckets[current].back();
+        }
+
+        void Pop() {
+            (void)Top();
+            buckets[current].pop_back();
+            --count;
+        }
+    };
+
+    /**
+     * This is a queue of steps yet to be taken, which always gives the
+     * cheapest step next, for any costs, as long as no step is queued
+     * with a lower cost than the last step taken (a radix heap).  That
+     * holds for these searches, since moves never have negative costs,
+     * as long as the heuristic never drops by more than the cost of
+     * a move.
+     * Steps are kept in buckets by the highest bit in which their cost
+     * differs from the cost of the last step taken, so a step is moved
+     * to another bucket at most once for each bit of its cost.
+     */
+    struct RadixQueue {
+        static constexpr size_t BUCKETS = 33;
+        std::vector< SearchStep > buckets[BUCKETS];
+        uint32_t last = 0;
+        size_t count = 0;
+
+        static size_t Bucket(uint32_t cost, uint32_t last) {
+            size_t bucket = 0;
+            for (auto bits = cost ^ last; bits != 0; bits >>= 1) {
+                ++bucket;
+            }
+            return bucket;
+        }
+
+        void Clear() {
+            for (auto& bucket: buckets) {
+                bucket.clear();
+            }
+            last = 0;
+            count = 0;
+        }
+
+        bool Empty() const {
+            return (count == 0);
+        }
+
+        void Push(const SearchStep& step) {
+            buckets[Bucket((uint32_t)step.cost, last)].push_back(step);
+            ++count;
+        }
+
+        const SearchStep& Top() {
+            if (buckets[0].empty()) {
+                // Take the lowest bucket with any steps in it, and spread
+                // its steps out over the buckets below it, by the highest
+                // bit in which their costs differ from its cheapest.
+                size_t i = 1;
+                while (buckets[i].empty()) {
+                    ++i;
+                }
+                last = (uint32_t)buckets[i][0].cost;
+                for (const auto& step: buckets[i]) {
+                    last = std::min(last, (uint32_t)step.cost);
+                }
+                for (const auto& step: buckets[i]) {
+                    buckets[Bucket((uint32_t)step.cost, last)].push_back(step);
+                }
+                buckets[i].clear();
+            }
+            return buckets[0].back();
+        }
+
+        void Pop() {
+            (void)Top();
+            buckets[0].pop_back();
+            --count;
+        }
+    };
+
+    /**
+     * This holds what a search needs as it goes, keeping its steps
+     * in a map, for types of position which have no dense index.
+     * The type of queue of steps yet to be taken is a template argument.
+     */
+    template< typename Queue = HeapQueue > struct MapWorkspace {
+        /**
+         * These are the steps taken so far, keyed by position.
+         */
+        std::map< T, SearchStep > steps;
+
+        /**
+         * This is the queue of steps yet to be taken.
+         */
+        Queue frontier;
+
+        /**
+         * This is where the neighbors of a position are put.
+         */
+        std::vector< T > neighbors;
+
+        /**
+         * These are the positions reached, in the order first reached.
+         */
+        std::vector< T > reached;
+
+        /**
+         * This sets up the workspace for a new search.
+         */
+        void Begin() {
+            steps.clear();
+            frontier.Clear();
+            reached.clear();
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * or nullptr if the position hasn't been reached yet.
+         */
+        SearchStep* Find(const T& position) {
+            const auto stepsEntry = steps.find(position);
+            if (stepsEntry == steps.end()) {
+                return nullptr;
+            }
+            return &stepsEntry->second;
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * adding it first if the position hasn't been reached yet.
+         */
+        SearchStep& Add(const T& position) {
+            const auto stepsEntry = steps.find(position);
+            if (stepsEntry != steps.end()) {
+                return stepsEntry->second;
+            }
+            reached.push_back(position);
+            auto& step = steps[position];
+            step = SearchStep(position, position, 0);
+            return step;
+        }
+    };
+
+    /**
+     * This holds what a search needs as it goes, keeping its steps in
+     * flat arrays indexed through the DenseIndex of the type of
+     * position.  It's meant to be reused for any number of searches of
+     * the same space: each step is stamped with the generation of the
+     * search which last reached it, so starting a new search only
+     * needs to bump the generation, and none of the arrays need to be
+     * cleared or allocated again.  The index shouldn't be changed once
+     * the workspace has been used, unless the number of positions it
+     * covers changes too.  The type of queue of steps yet to be taken
+     * is a template argument.
+     */
+    template< typename Queue = HeapQueue > struct DenseWorkspace {
+        /**
+         * This maps positions to indexes in the arrays of steps.
+         */
+        DenseIndex< T > index;
+
+        /**
+         * These are the steps taken, by index of position.
+         */
+        std::vector< SearchStep > steps;
+
+        /**
+         * These are the generations of the searches which last reached
+         * each position, by index of position.
+         */
+        std::vector< uint32_t > stamps;
+
+        /**
+         * This is the generation of the current search.
+         */
+        uint32_t generation = 0;
+
+        /**
+         * This is the queue of steps yet to be taken.
+         */
+        Queue frontier;
+
+        /**
+         * This is where the neighbors of a position are put.
+         */
+        std::vector< T > neighbors;
+
+        /**
+         * These are the positions reached, in the order first reached.
+         */
+        std::vector< T > reached;
+
+        /**
+         * This sets up the workspace for a new search.
+         */
+        void Begin() {
+            const auto size = index.Size();
+            if (stamps.size() != size) {
+                steps.resize(size);
+                stamps.assign(size, 0);
+                generation = 0;
+            }
+            if (++generation == 0) {
+                std::fill(stamps.begin(), stamps.end(), 0);
+                generation = 1;
+            }
+            frontier.Clear();
+            reached.clear();
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * or nullptr if the position hasn't been reached yet.
+         */
+        SearchStep* Find(const T& position) {
+            const auto i = index(position);
+            if (stamps[i] != generation) {
+                return nullptr;
+            }
+            return &steps[i];
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * adding it first if the position hasn't been reached yet.
+         */
+        SearchStep& Add(const T& position) {
+            const auto i = index(position);
+            if (stamps[i] != generation) {
+                stamps[i] = generation;
+                steps[i] = SearchStep(position, position, 0);
+                reached.push_back(position);
+            }
+            return steps[i];
+        }
+    };
+
     /**
      * This method finds a path from a given starting position
      * to a given destination.
@@ -169,7 +488,10 @@ template< typename T > struct PathFinding {
      *     This is the position to which to find a path.
      *
      * @param[in] findNeighbors
-     *     This function is used to find the neighbors of given positions.
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.  The same
+     *     vector is reused for every call, so that finding neighbors
+     *     doesn't allocate memory once the search is under way.
      *
      * @param[in] moveCost
      *     This function computes the cost of moving from one position
@@ -187,196 +509,1198 @@ template< typename T > struct PathFinding {
      *     Information about the path from the given starting position
      *     to the given destination is returned.
      */
-    static Path FindPath(
+    template<
+        typename NeighborFunction,
+        typename CostFunction,
+        typename HeuristicFunction
+    > static Path FindPath(
         const T& startingPosition,
         const T& destination,
         NeighborFunction findNeighbors,
         CostFunction moveCost,
-        CostFunction heuristic,
+        HeuristicFunction heuristic,
         int maxCost = 0
     ) {
-        std::priority_queue< SearchStep > frontier;
-        std::map< T, SearchStep > steps;
-        frontier.emplace(startingPosition, startingPosition, 0);
-        steps[startingPosition] = frontier.top();
-        while (!frontier.empty()) {
-            auto lastStep = frontier.top();
+        MapWorkspace<> workspace;
+        return FindPath(
+            workspace,
+            startingPosition,
+            destination,
+            findNeighbors,
+            moveCost,
+            heuristic,
+            maxCost
+        );
+    }
+
+    /**
+     * This method finds a path from a given starting position
+     * to a given destination, using the given workspace, which can be
+     * reused for other searches afterwards.
+     *
+     * @param[in,out] workspace
+     *     This holds what the search needs as it goes.  It's either
+     *     a MapWorkspace or a DenseWorkspace, with the kind of queue
+     *     which best suits the costs of moves: a HeapQueue for any
+     *     costs, a FifoQueue if every move costs the same, a BucketQueue
+     *     for small integer costs, or a RadixQueue for large ones.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     a path to the given destination.
+     *
+     * @param[in] destination
+     *     This is the position to which to find a path.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] heuristic
+     *     This function estimates the remaining cost of moving from
+     *     a given position to another.
+     *
+     * @param[in] maxCost
+     *     If non-zero, this sets a maximum cost for the path to
+     *     find.
+     *
+     * @return
+     *     Information about the path from the given starting position
+     *     to the given destination is returned.
+     */
+    template<
+        typename Workspace,
+        typename NeighborFunction,
+        typename CostFunction,
+        typename HeuristicFunction
+    > static Path FindPath(
+        Workspace& workspace,
+        const T& startingPosition,
+        const T& destination,
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        HeuristicFunction heuristic,
+        int maxCost = 0
+    ) {
+        workspace.Begin();
+        auto& frontier = workspace.frontier;
+        auto& neighbors = workspace.neighbors;
+        frontier.Push(SearchStep(startingPosition, startingPosition, 0));
+        (void)workspace.Add(startingPosition);
+        while (!frontier.Empty()) {
+            const auto lastStep = frontier.Top();
             if (lastStep.position == destination) {
                 Path path;
                 path.reachable = true;
-                path.cost = steps[lastStep.position].cost;
-                for (auto position = lastStep.position; position != startingPosition; position = steps[position].previous) {
+                path.cost = workspace.Find(lastStep.position)->cost;
+                for (auto position = lastStep.position; position != startingPosition; position = workspace.Find(position)->previous) {
                     path.steps.push_back(position);
                 }
                 std::reverse(path.steps.begin(), path.steps.end());
                 return path;
             }
-            frontier.pop();
-            for (const auto& nextStepPosition: findNeighbors(lastStep.position)) {
+            frontier.Pop();
+            const auto lastStepCost = workspace.Find(lastStep.position)->cost;
+            if (lastStep.previous != workspace.Find(lastStep.position)->previous) {
+                continue;
+            }
+            neighbors.clear();
+            findNeighbors(lastStep.position, neighbors);
+            for (const auto& nextStepPosition: neighbors) {
                 auto nextStepCost = moveCost(lastStep.position, nextStepPosition);
                 const auto nextStepHeuristic = heuristic(nextStepPosition, destination);
-                nextStepCost += steps[lastStep.position].cost;
+                nextStepCost += lastStepCost;
                 if (
                     (maxCost > 0)
                     && (nextStepCost + nextStepHeuristic > maxCost)
                 ) {
                     continue;
                 }
-                auto step = steps.find(nextStepPosition);
+                const auto step = workspace.Find(nextStepPosition);
                 if (
-                    (step == steps.end())
-                    || (nextStepCost < step->second.cost)
+                    (step == nullptr)
+                    || (nextStepCost < step->cost)
                 ) {
-                    steps[nextStepPosition].cost = nextStepCost;
-                    steps[nextStepPosition].previous = lastStep.position;
-                    frontier.emplace(
-                        nextStepPosition,
-                        lastStep.position,
-                        nextStepCost + nextStepHeuristic
+                    auto& nextStep = workspace.Add(nextStepPosition);
+                    nextStep.cost = nextStepCost;
+                    nextStep.previous = lastStep.position;
+                    frontier.Push(
+                        SearchStep(
+                            nextStepPosition,
+                            lastStep.position,
+                            nextStepCost + nextStepHeuristic
+                        )
                     );
                 }
             }
         }
-        return Path();
+        return Path();
+    }
+
+    /**
+     * This method finds all the places that are reachable from the
+     * given starting position, and the total cost to reach them.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     all reachable places.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.  The same
+     *     vector is reused for every call, so that finding neighbors
+     *     doesn't allocate memory once the search is under way.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] maxCost
+     *     If non-zero, this sets a maximum cost after which no more
+     *     reachable places are sought after.
+     *
+     * @return
+     *     A list of places and the total cost to reach them is returned.
+     *     This list is sorted by increasing total cost.
+     */
+    template<
+        typename NeighborFunction,
+        typename CostFunction
+    > static std::vector< SearchStep > FindReachablePlaces(
+        const T& startingPosition,
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        int maxCost = 0
+    ) {
+        MapWorkspace<> workspace;
+        return FindReachablePlaces(
+            workspace,
+            startingPosition,
+            findNeighbors,
+            moveCost,
+            maxCost
+        );
+    }
+
+    /**
+     * This method finds all the places that are reachable from the
+     * given starting position, and the total cost to reach them, using
+     * the given workspace, which can be reused for other searches
+     * afterwards.
+     *
+     * @param[in,out] workspace
+     *     This holds what the search needs as it goes.  It's either
+     *     a MapWorkspace or a DenseWorkspace, with the kind of queue
+     *     which best suits the costs of moves: a HeapQueue for any
+     *     costs, a FifoQueue if every move costs the same, a BucketQueue
+     *     for small integer costs, or a RadixQueue for large ones.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     all reachable places.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] maxCost
+     *     If non-zero, this sets a maximum cost after which no more
+     *     reachable places are sought after.
+     *
+     * @return
+     *     A list of places and the total cost to reach them is returned.
+     *     This list is sorted by increasing total cost.
+     */
+    template<
+        typename Workspace,
+        typename NeighborFunction,
+        typename CostFunction
+    > static std::vector< SearchStep > FindReachablePlaces(
+        Workspace& workspace,
+        const T& startingPosition,
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        int maxCost = 0
+    ) {
+        workspace.Begin();
+        auto& frontier = workspace.frontier;
+        auto& neighbors = workspace.neighbors;
+        frontier.Push(SearchStep(startingPosition, startingPosition, 0));
+        (void)workspace.Add(startingPosition);
+        while (!frontier.Empty()) {
+            const auto lastStep = frontier.Top();
+            frontier.Pop();
+            const auto lastStepCost = workspace.Find(lastStep.position)->cost;
+            if (lastStep.cost > lastStepCost) {
+                continue;
+            }
+            neighbors.clear();
+            findNeighbors(lastStep.position, neighbors);
+            for (const auto& nextStepPosition: neighbors) {
+                auto nextStepCost = moveCost(lastStep.position, nextStepPosition);
+                nextStepCost += lastStepCost;
+                if (
+                    (maxCost > 0)
+                    && (nextStepCost > maxCost)
+                ) {
+                    continue;
+                }
+                const auto step = workspace.Find(nextStepPosition);
+                if (
+                    (step == nullptr)
+                    || (nextStepCost < step->cost)
+                ) {
+                    auto& nextStep = workspace.Add(nextStepPosition);
+                    nextStep.previous = lastStep.position;
+                    nextStep.cost = nextStepCost;
+                    frontier.Push(
+                        SearchStep(
+                            nextStepPosition,
+                            lastStep.position,
+                            nextStepCost
+                        )
+                    );
+                }
+            }
+        }
+        std::vector< SearchStep > places;
+        for (const auto& position: workspace.reached) {
+            if (position != startingPosition) {
+                places.push_back(*workspace.Find(position));
+            }
+        }
+        std::sort(
+            places.begin(),
+            places.end(),
+            [](
+                const SearchStep& a,
+                const SearchStep& b
+            ){
+                return a.cost < b.cost;
+            }
+        );
+        return places;
+    }
+
+    /**
+     * This method finds a path from a given starting position to a given
+     * destination on a grid where every move is one step up, down, left,
+     * or right, and every move into an open cell costs the same.  It's
+     * an A* search, using the Manhattan distance as its heuristic, which
+     * only stops at jump points: positions where a shortest path may
+     * have to turn.  Of all the shortest paths which differ only in the
+     * order of their moves, only the one which makes each vertical move
+     * as early as possible is followed, so a horizontal move is only
+     * followed by a vertical one where a wall behind forces it, and
+     * a vertical move only stops where a horizontal jump from it would
+     * find a jump point.  The type of position must have integer x and
+     * y members.
+     *
+     * @param[in,out] workspace
+     *     This holds what the search needs as it goes.  It's either
+     *     a MapWorkspace or a DenseWorkspace, with any kind of queue but
+     *     a FifoQueue: jumps differ in length, so the steps yet to be
+     *     taken must be given cheapest first, or the path found may not
+     *     be the shortest.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     a path to the given destination.
+     *
+     * @param[in] destination
+     *     This is the position to which to find a path.
+     *
+     * @param[in] isOpen
+     *     This function indicates whether or not a given position can be
+     *     moved into.  It must return false for every position beyond
+     *     the edges of the grid.
+     *
+     * @return
+     *     Information about the path from the given starting position
+     *     to the given destination is returned.
+     */
+    template<
+        typename Workspace,
+        typename OpenFunction
+    > static Path FindPathJumping(
+        Workspace& workspace,
+        const T& startingPosition,
+        const T& destination,
+        OpenFunction isOpen
+    ) {
+        workspace.Begin();
+        auto& frontier = workspace.frontier;
+        auto& neighbors = workspace.neighbors;
+        frontier.Push(SearchStep(startingPosition, startingPosition, Distance(startingPosition, destination)));
+        (void)workspace.Add(startingPosition);
+        while (!frontier.Empty()) {
+            const auto lastStep = frontier.Top();
+            if (lastStep.position == destination) {
+                Path path;
+                path.reachable = true;
+                path.cost = workspace.Find(lastStep.position)->cost;
+                for (auto position = lastStep.position; position != startingPosition;) {
+                    const auto previous = workspace.Find(position)->previous;
+                    while (position != previous) {
+                        path.steps.push_back(position);
+                        position.x += Direction(previous.x - position.x);
+                        position.y += Direction(previous.y - position.y);
+                    }
+                }
+                std::reverse(path.steps.begin(), path.steps.end());
+                return path;
+            }
+            frontier.Pop();
+            const auto lastStepCost = workspace.Find(lastStep.position)->cost;
+            if (lastStep.cost > lastStepCost + Distance(lastStep.position, destination)) {
+                continue;
+            }
+
+            // Find the jump points in each direction the search may take
+            // from here, given the direction it came from.
+            const auto previous = workspace.Find(lastStep.position)->previous;
+            const auto dx = Direction(lastStep.position.x - previous.x);
+            const auto dy = Direction(lastStep.position.y - previous.y);
+            neighbors.clear();
+            T jumpPoint;
+            for (int sign = -1; sign <= 1; sign += 2) {
+                if (
+                    (dx == 0)
+                    || (dx == sign)
+                ) {
+                    if (JumpHorizontally(lastStep.position, sign, destination, isOpen, jumpPoint)) {
+                        neighbors.push_back(jumpPoint);
+                    }
+                }
+                auto side = lastStep.position;
+                side.y += sign;
+                auto sideBehind = side;
+                sideBehind.x -= dx;
+                if (
+                    (
+                        (dx == 0)
+                        && (dy != -sign)
+                    )
+                    || (
+                        (dx != 0)
+                        && isOpen(side)
+                        && !isOpen(sideBehind)
+                    )
+                ) {
+                    if (JumpVertically(lastStep.position, sign, destination, isOpen, jumpPoint)) {
+                        neighbors.push_back(jumpPoint);
+                    }
+                }
+            }
+            for (const auto& nextStepPosition: neighbors) {
+                const auto nextStepCost = lastStepCost + Distance(lastStep.position, nextStepPosition);
+                const auto step = workspace.Find(nextStepPosition);
+                if (
+                    (step == nullptr)
+                    || (nextStepCost < step->cost)
+                ) {
+                    auto& nextStep = workspace.Add(nextStepPosition);
+                    nextStep.cost = nextStepCost;
+                    nextStep.previous = lastStep.position;
+                    frontier.Push(
+                        SearchStep(
+                            nextStepPosition,
+                            lastStep.position,
+                            nextStepCost + Distance(nextStepPosition, destination)
+                        )
+                    );
+                }
+            }
+        }
+        return Path();
+    }
+
+    /**
+     * This returns the sign of the given difference in coordinates.
+     */
+    static int Direction(int difference) {
+        return (difference > 0) - (difference < 0);
+    }
+
+    /**
+     * This returns the Manhattan distance between two positions.
+     */
+    static int Distance(const T& start, const T& end) {
+        return abs(end.x - start.x) + abs(end.y - start.y);
+    }
+
+    /**
+     * This moves horizontally from the given position, in the given
+     * direction, until reaching the destination, a wall, or a position
+     * with an open cell above or below it which has a wall behind it.
+     *
+     * @return
+     *     An indication of whether or not a jump point was found,
+     *     rather than a wall, is returned.
+     */
+    template< typename OpenFunction > static bool JumpHorizontally(
+        T position,
+        int dx,
+        const T& destination,
+        OpenFunction& isOpen,
+        T& jumpPoint
+    ) {
+        for (;;) {
+            position.x += dx;
+            if (!isOpen(position)) {
+                return false;
+            }
+            if (position == destination) {
+                break;
+            }
+            auto above = position;
+            --above.y;
+            auto below = position;
+            ++below.y;
+            auto aboveBehind = above;
+            aboveBehind.x -= dx;
+            auto belowBehind = below;
+            belowBehind.x -= dx;
+            if (
+                (
+                    isOpen(above)
+                    && !isOpen(aboveBehind)
+                )
+                || (
+                    isOpen(below)
+                    && !isOpen(belowBehind)
+                )
+            ) {
+                break;
+            }
+        }
+        jumpPoint = position;
+        return true;
+    }
+
+    /**
+     * This moves vertically from the given position, in the given
+     * direction, until reaching the destination, a wall, or a position
+     * from which a horizontal jump finds a jump point.
+     *
+     * @return
+     *     An indication of whether or not a jump point was found,
+     *     rather than a wall, is returned.
+     */
+    template< typename OpenFunction > static bool JumpVertically(
+        T position,
+        int dy,
+        const T& destination,
+        OpenFunction& isOpen,
+        T& jumpPoint
+    ) {
+        T horizontalJumpPoint;
+        for (;;) {
+            position.y += dy;
+            if (!isOpen(position)) {
+                return false;
+            }
+            if (
+                (position == destination)
+                || JumpHorizontally(position, -1, destination, isOpen, horizontalJumpPoint)
+                || JumpHorizontally(position, 1, destination, isOpen, horizontalJumpPoint)
+            ) {
+                break;
+            }
+        }
+        jumpPoint = position;
+        return true;
+    }
+};
+
+enum class Cell {
+    Unexplored,
+    Floor,
+    Wall,
+    OxygenSystem,
+    Path,
+};
+
+struct Position {
+    int x = 0;
+    int y = 0;
+
+    Position() {
+    }
+
+    Position(int x, int y)
+        : x(x)
+        , y(y)
+    {
+    }
+
+    bool operator==(const Position& other) const {
+        return (
+            (x == other.x)
+            && (y == other.y)
+        );
+    }
+
+    bool operator!=(const Position& other) const {
+        return !(*this == other);
+    }
+
+    bool operator<(const Position& other) const {
+        if (x < other.x) {
+            return true;
+        } else if (x > other.x) {
+            return false;
+        } else {
+            return (y < other.y);
+        }
+    }
+
+    Position& operator+=(const Position& other) {
+        x += other.x;
+        y += other.y;
+        return *this;
+    }
+
+    Position operator+(const Position& other) {
+        Position sum = *this;
+        sum.x += other.x;
+        sum.y += other.y;
+        return sum;
+    }
+};
+
+/**
+ * This maps the positions within a rectangle to dense indexes,
+ * in row-major order.
+ */
+template<> struct DenseIndex< Position > {
+    int left = 0;
+    int top = 0;
+    int width = 0;
+    int height = 0;
+
+    size_t Size() const {
+        return (size_t)width * (size_t)height;
+    }
+
+    size_t operator()(const Position& position) const {
+        return (
+            (size_t)(position.y - top) * (size_t)width
+            + (size_t)(position.x - left)
+        );
+    }
+};
+
+/**
+ * This is a maze with each of its corridors collapsed into a single
+ * weighted edge, so that only the junctions, dead ends, and points of
+ * interest of the maze are left as nodes.
+ */
+struct CorridorGraph {
+    /**
+     * This is one way out of a node, along a corridor.
+     */
+    struct Edge {
+        /**
+         * This is the index of the node at the other end of the corridor.
+         */
+        size_t to;
+
+        /**
+         * This is the number of steps it takes to follow the corridor.
+         */
+        int length;
+
+        /**
+         * These are the doors along the corridor, one bit per door,
+         * including any door at the node at the other end.
+         */
+        uint32_t doors;
+
+        Edge(
+            size_t to,
+            int length,
+            uint32_t doors
+        )
+            : to(to)
+            , length(length)
+            , doors(doors)
+        {
+        }
+    };
+
+    /**
+     * This is a cell of the maze which is kept as a node of the graph.
+     */
+    struct Node {
+        size_t x = 0;
+        size_t y = 0;
+        std::vector< Edge > edges;
+    };
+
+    /**
+     * This is the width of the maze, in cells.
+     */
+    size_t width = 0;
+
+    /**
+     * This is the height of the maze, in cells.
+     */
+    size_t height = 0;
+
+    /**
+     * These are the nodes of the graph, in row-major order.
+     */
+    std::vector< Node > nodes;
+
+    /**
+     * This holds the index of the node at each cell of the maze,
+     * in row-major order, or -1 for cells which aren't nodes.
+     */
+    std::vector< int > nodeAt;
+
+    /**
+     * This returns the index of the node at the given cell of the maze,
+     * or -1 if the cell isn't a node.
+     */
+    int NodeAt(size_t x, size_t y) const {
+        return nodeAt[y * width + x];
+    }
+
+    /**
+     * This returns the number of edges in the graph, counting each
+     * corridor once from each end.
+     */
+    size_t EdgeCount() const {
+        size_t count = 0;
+        for (const auto& node: nodes) {
+            count += node.edges.size();
+        }
+        return count;
+    }
+
+    /**
+     * This returns the length of the shortest edge from one node to
+     * another, using only edges whose doors can all be opened.
+     *
+     * @param[in] from
+     *     This is the index of the node from which to move.
+     *
+     * @param[in] to
+     *     This is the index of the node to which to move.
+     *
+     * @param[in] keys
+     *     These are the doors which can be opened, one bit per door.
+     *
+     * @return
+     *     The length of the shortest edge is returned, or -1 if there
+     *     is no such edge.
+     */
+    int Length(
+        size_t from,
+        size_t to,
+        uint32_t keys
+    ) const {
+        int length = -1;
+        for (const auto& edge: nodes[from].edges) {
+            if (
+                (edge.to == to)
+                && ((edge.doors & ~keys) == 0)
+                && (
+                    (length < 0)
+                    || (edge.length < length)
+                )
+            ) {
+                length = edge.length;
+            }
+        }
+        return length;
+    }
+};
+
+/**
+ * This function collapses every corridor of the given maze into a single
+ * weighted edge between the cells at its ends.  Every open cell which
+ * doesn't have exactly two open neighbors, along with every point of
+ * interest, is kept as a node.
+ *
+ * @param[in] width
+ *     This is the width of the maze, in cells.
+ *
+ * @param[in] height
+ *     This is the height of the maze, in cells.
+ *
+ * @param[in] isOpen
+ *     This function indicates whether or not the cell with the given
+ *     coordinates can ever be moved through.
+ *
+ * @param[in] isPointOfInterest
+ *     This function indicates whether or not the cell with the given
+ *     coordinates must be kept as a node.
+ *
+ * @param[in] doorsAt
+ *     This function returns the doors at the cell with the given
+ *     coordinates, one bit per door.
+ *
+ * @return
+ *     The graph of the maze is returned.
+ */
+template<
+    typename OpenFunction,
+    typename PointOfInterestFunction,
+    typename DoorFunction
+> CorridorGraph ContractCorridors(
+    size_t width,
+    size_t height,
+    OpenFunction isOpen,
+    PointOfInterestFunction isPointOfInterest,
+    DoorFunction doorsAt
+) {
+    CorridorGraph graph;
+    graph.width = width;
+    graph.height = height;
+    graph.nodeAt.assign(width * height, -1);
+    std::vector< bool > open(width * height);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            open[y * width + x] = isOpen(x, y);
+        }
+    }
+
+    // This finds the cell next to the given one in one of the four
+    // directions, if that cell is open.
+    static const int dx[] = {-1, 1, 0, 0};
+    static const int dy[] = {0, 0, -1, 1};
+    const auto findExit = [&](size_t cell, int direction, size_t& next){
+        const auto x = (int)(cell % width) + dx[direction];
+        const auto y = (int)(cell / width) + dy[direction];
+        if (
+            (x < 0)
+            || (x >= (int)width)
+            || (y < 0)
+            || (y >= (int)height)
+        ) {
+            return false;
+        }
+        next = (size_t)y * width + (size_t)x;
+        return (bool)open[next];
+    };
+
+    // Keep every open cell which isn't part of a corridor as a node.
+    size_t next;
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        if (!open[cell]) {
+            continue;
+        }
+        int exits = 0;
+        for (int direction = 0; direction < 4; ++direction) {
+            if (findExit(cell, direction, next)) {
+                ++exits;
+            }
+        }
+        const auto x = cell % width;
+        const auto y = cell / width;
+        if (
+            (exits != 2)
+            || isPointOfInterest(x, y)
+        ) {
+            graph.nodeAt[cell] = (int)graph.nodes.size();
+            CorridorGraph::Node node;
+            node.x = x;
+            node.y = y;
+            graph.nodes.push_back(std::move(node));
+        }
+    }
+
+    // Follow each way out of every node along its corridor
+    // to the node at the other end.
+    for (size_t i = 0; i < graph.nodes.size(); ++i) {
+        auto& node = graph.nodes[i];
+        const auto start = node.y * width + node.x;
+        for (int direction = 0; direction < 4; ++direction) {
+            if (!findExit(start, direction, next)) {
+                continue;
+            }
+            auto previous = start;
+            auto cell = next;
+            int length = 1;
+            auto doors = doorsAt(cell % width, cell / width);
+            while (graph.nodeAt[cell] < 0) {
+                for (int turn = 0; turn < 4; ++turn) {
+                    if (
+                        findExit(cell, turn, next)
+                        && (next != previous)
+                    ) {
+                        break;
+                    }
+                }
+                previous = cell;
+                cell = next;
+                ++length;
+                doors |= doorsAt(cell % width, cell / width);
+            }
+            if (graph.nodeAt[cell] != (int)i) {
+                node.edges.emplace_back((size_t)graph.nodeAt[cell], length, doors);
+            }
+        }
+    }
+    return graph;
+}
+
+/**
+ * This holds how much a maze was shrunk by pruning it.
+ */
+struct PruneReport {
+    /**
+     * This is the number of open cells in the maze before pruning.
+     */
+    size_t openCells = 0;
+
+    /**
+     * This is the number of open cells which were walled off because
+     * they couldn't be reached.
+     */
+    size_t unreachableCells = 0;
+
+    /**
+     * This is the number of open cells which were filled in because
+     * they were at the end of a dead end holding nothing of interest.
+     */
+    size_t deadEndCells = 0;
+};
+
+/**
+ * This function shrinks the given maze, by walling off every open cell
+ * which can't be reached from an entrance, and then repeatedly filling
+ * in every dead end which holds nothing of interest, until none is left.
+ * Neither changes the shortest path between any two points of interest.
+ *
+ * @param[in,out] lines
+ *     These are the lines of the maze.  Pruned cells are replaced
+ *     with the given wall.
+ *
+ * @param[in] wall
+ *     This is the cell with which to replace pruned cells.
+ *
+ * @param[in] isOpen
+ *     This function indicates whether or not the given cell can ever
+ *     be moved through.
+ *
+ * @param[in] isEntrance
+ *     This function indicates whether or not the maze can be entered
+ *     at the cell with the given coordinates.
+ *
+ * @param[in] isPointOfInterest
+ *     This function indicates whether or not the cell with the given
+ *     coordinates must be kept open.
+ *
+ * @return
+ *     A report of how much the maze was shrunk is returned.
+ */
+template<
+    typename OpenFunction,
+    typename EntranceFunction,
+    typename PointOfInterestFunction
+> PruneReport PruneMaze(
+    std::vector< std::string >& lines,
+    char wall,
+    OpenFunction isOpen,
+    EntranceFunction isEntrance,
+    PointOfInterestFunction isPointOfInterest
+) {
+    PruneReport report;
+    const auto height = lines.size();
+    const auto width = lines[0].length();
+    static const int dx[] = {-1, 1, 0, 0};
+    static const int dy[] = {0, 0, -1, 1};
+    const auto findExit = [&](size_t cell, int direction, size_t& next){
+        const auto x = (int)(cell % width) + dx[direction];
+        const auto y = (int)(cell / width) + dy[direction];
+        if (
+            (x < 0)
+            || (x >= (int)width)
+            || (y < 0)
+            || (y >= (int)height)
+        ) {
+            return false;
+        }
+        next = (size_t)y * width + (size_t)x;
+        return isOpen(lines[(size_t)y][(size_t)x]);
+    };
+
+    // Spread out from the entrances to find the cells which can be
+    // reached, and wall off the rest.
+    std::vector< bool > reached(width * height);
+    std::vector< size_t > frontier;
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        const auto x = cell % width;
+        const auto y = cell / width;
+        if (!isOpen(lines[y][x])) {
+            continue;
+        }
+        ++report.openCells;
+        if (isEntrance(x, y)) {
+            reached[cell] = true;
+            frontier.push_back(cell);
+        }
+    }
+    size_t next;
+    while (!frontier.empty()) {
+        const auto cell = frontier.back();
+        frontier.pop_back();
+        for (int direction = 0; direction < 4; ++direction) {
+            if (
+                findExit(cell, direction, next)
+                && !reached[next]
+            ) {
+                reached[next] = true;
+                frontier.push_back(next);
+            }
+        }
+    }
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        auto& contents = lines[cell / width][cell % width];
+        if (
+            isOpen(contents)
+            && !reached[cell]
+        ) {
+            contents = wall;
+            ++report.unreachableCells;
+        }
     }
 
-    /**
-     * This method finds all the places that are reachable from the
-     * given starting position, and the total cost to reach them.
-     *
-     * @param[in] startingPosition
-     *     This is the starting position from which to find
-     *     all reachable places.
-     *
-     * @param[in] findNeighbors
-     *     This function is used to find the neighbors of given positions.
-     *
-     * @param[in] moveCost
-     *     This function computes the cost of moving from one position
-     *     to an adjacent position.
-     *
-     * @param[in] maxCost
-     *     If non-zero, this sets a maximum cost after which no more
-     *     reachable places are sought after.
-     *
-     * @return
-     *     A list of places and the total cost to reach them is returned.
-     *     This list is sorted by increasing total cost.
-     */
-    static std::vector< SearchStep > FindReachablePlaces(
-        const T& startingPosition,
-        NeighborFunction findNeighbors,
-        CostFunction moveCost,
-        int maxCost = 0
-    ) {
-        std::vector< SearchStep > places;
-        std::priority_queue< SearchStep > frontier;
-        std::map< T, SearchStep > steps;
-        frontier.emplace(startingPosition, startingPosition, 0);
-        steps[startingPosition] = frontier.top();
-        while (!frontier.empty()) {
-            auto lastStep = frontier.top();
-            frontier.pop();
-            for (const auto& nextStepPosition: findNeighbors(lastStep.position)) {
-                auto nextStepCost = moveCost(lastStep.position, nextStepPosition);
-                nextStepCost += steps[lastStep.position].cost;
-                if (
-                    (maxCost > 0)
-                    && (nextStepCost > maxCost)
-                ) {
-                    continue;
-                }
-                auto step = steps.find(nextStepPosition);
-                if (
-                    (step == steps.end())
-                    || (nextStepCost < step->second.cost)
-                ) {
-                    auto& nextStep = steps[nextStepPosition];
-                    nextStep.position = nextStepPosition;
-                    nextStep.previous = lastStep.position;
-                    nextStep.cost = nextStepCost;
-                    frontier.emplace(
-                        nextStepPosition,
-                        lastStep.position,
-                        nextStepCost
-                    );
-                }
+    // Fill in each dead end holding nothing of interest, and then look
+    // at the cell it led to, which may have become a dead end itself.
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        if (isOpen(lines[cell / width][cell % width])) {
+            frontier.push_back(cell);
+        }
+    }
+    while (!frontier.empty()) {
+        const auto cell = frontier.back();
+        frontier.pop_back();
+        const auto x = cell % width;
+        const auto y = cell / width;
+        if (
+            !isOpen(lines[y][x])
+            || isPointOfInterest(x, y)
+        ) {
+            continue;
+        }
+        int exits = 0;
+        size_t onward = 0;
+        for (int direction = 0; direction < 4; ++direction) {
+            if (findExit(cell, direction, next)) {
+                ++exits;
+                onward = next;
             }
         }
-        for (const auto& step: steps) {
-            if (step.first != startingPosition) {
-                places.push_back(step.second);
+        if (exits <= 1) {
+            lines[y][x] = wall;
+            ++report.deadEndCells;
+            if (exits == 1) {
+                frontier.push_back(onward);
             }
         }
-        std::sort(
-            places.begin(),
-            places.end(),
-            [](
-                const SearchStep& a,
-                const SearchStep& b
-            ){
-                return a.cost < b.cost;
+    }
+    return report;
+}
+
+/**
+ * This function calls the given function once for each index from zero
+ * up to the given count, spreading the calls across as many threads as
+ * the system can run at once.
+ *
+ * @param[in] count
+ *     This is the number of times to call the function.
+ *
+ * @param[in] body
+ *     This is the function to call, with the index of the call.
+ */
+void ForEachInParallel(
+    size_t count,
+    const std::function< void(size_t) >& body
+) {
+    std::atomic< size_t > next(0);
+    const auto work = [&]{
+        for (;;) {
+            const auto i = next++;
+            if (i >= count) {
+                break;
             }
-        );
-        return places;
+            body(i);
+        }
+    };
+    const auto threads = std::min(
+        (size_t)std::max(std::thread::hardware_concurrency(), 1U),
+        count
+    );
+    std::vector< std::thread > workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
     }
-};
+    work();
+    for (auto& worker: workers) {
+        worker.join();
+    }
+}
 
-enum class Cell {
-    Unexplored,
-    Floor,
-    Wall,
-    OxygenSystem,
-    Path,
-};
+/**
+ * This holds the length of the shortest path between every pair of
+ * points of interest of a corridor graph, along with the doors crossed
+ * along each path, so that searches which only move from one point of
+ * interest to another can look up how to get there, rather than
+ * searching the graph again every time.
+ */
+struct DistanceMatrix {
+    /**
+     * These are the nodes of the graph which are points of interest,
+     * in the order in which they're numbered in the matrix.
+     */
+    std::vector< size_t > points;
 
-struct Position {
-    int x = 0;
-    int y = 0;
+    /**
+     * This holds the number of the point of interest at each node of
+     * the graph, or -1 if the node isn't a point of interest.
+     */
+    std::vector< int > pointAt;
 
-    Position() {
-    }
+    /**
+     * These are the lengths of the shortest paths from each point of
+     * interest to every other, a row per point, with -1 where there's
+     * no path.
+     */
+    std::vector< int > lengths;
 
-    Position(int x, int y)
-        : x(x)
-        , y(y)
-    {
-    }
+    /**
+     * These are the doors crossed along the shortest paths from each
+     * point of interest to every other, a row per point, one bit
+     * per door.
+     */
+    std::vector< uint32_t > doors;
 
-    bool operator==(const Position& other) const {
-        return (
-            (x == other.x)
-            && (y == other.y)
-        );
+    /**
+     * This returns the number of the point of interest at the given
+     * node of the graph, or -1 if the node isn't a point of interest.
+     */
+    int PointAt(size_t node) const {
+        return pointAt[node];
     }
 
-    bool operator!=(const Position& other) const {
-        return !(*this == other);
+    /**
+     * This returns the length of the shortest path from one point
+     * of interest to another, or -1 if there's no path.
+     */
+    int Length(
+        size_t from,
+        size_t to
+    ) const {
+        return lengths[from * points.size() + to];
     }
 
-    bool operator<(const Position& other) const {
-        if (x < other.x) {
-            return true;
-        } else if (x > other.x) {
-            return false;
-        } else {
-            return (y < other.y);
-        }
+    /**
+     * This returns the doors crossed along the shortest path from one
+     * point of interest to another, one bit per door.
+     */
+    uint32_t Doors(
+        size_t from,
+        size_t to
+    ) const {
+        return doors[from * points.size() + to];
     }
+};
 
-    Position& operator+=(const Position& other) {
-        x += other.x;
-        y += other.y;
-        return *this;
+/**
+ * This function finds the shortest paths between every pair of the given
+ * points of interest of the given graph, and the doors crossed along
+ * each, searching from each point of interest on a separate thread.
+ * Every door is considered open, so where a longer path would avoid
+ * a door, only the shorter one, through the door, is kept.
+ *
+ * @param[in] graph
+ *     This is the graph to search.
+ *
+ * @param[in] points
+ *     These are the nodes of the graph which are points of interest.
+ *
+ * @return
+ *     The distances between the points of interest are returned.
+ */
+DistanceMatrix MeasureDistances(
+    const CorridorGraph& graph,
+    const std::vector< size_t >& points
+) {
+    DistanceMatrix matrix;
+    const auto count = points.size();
+    matrix.points = points;
+    matrix.pointAt.assign(graph.nodes.size(), -1);
+    for (size_t i = 0; i < count; ++i) {
+        matrix.pointAt[points[i]] = (int)i;
     }
+    matrix.lengths.assign(count * count, -1);
+    matrix.doors.assign(count * count, 0);
+    ForEachInParallel(
+        count,
+        [&](size_t i){
+            // Search the whole graph from the point of interest,
+            // going through any door.
+            const auto start = points[i];
+            const auto places = PathFinding< size_t >::FindReachablePlaces(
+                start,
+                [&](size_t node, std::vector< size_t >& neighbors){
+                    for (const auto& edge: graph.nodes[node].edges) {
+                        neighbors.push_back(edge.to);
+                    }
+                },
+                [&](size_t from, size_t to){ return graph.Length(from, to, ~(uint32_t)0); }
+            );
+            std::vector< const PathFinding< size_t >::SearchStep* > stepAt(graph.nodes.size(), nullptr);
+            for (const auto& place: places) {
+                stepAt[place.position] = &place;
+            }
 
-    Position operator+(const Position& other) {
-        Position sum = *this;
-        sum.x += other.x;
-        sum.y += other.y;
-        return sum;
-    }
-};
+            // Follow the path back from every other point of interest
+            // reached, picking up the doors of the edges along the way.
+            matrix.lengths[i * count + i] = 0;
+            for (size_t j = 0; j < count; ++j) {
+                auto node = points[j];
+                if (stepAt[node] == nullptr) {
+                    continue;
+                }
+                matrix.lengths[i * count + j] = stepAt[node]->cost;
+                uint32_t doors = 0;
+                while (node != start) {
+                    const auto& step = *stepAt[node];
+                    const auto previousCost = (
+                        (step.previous == start)
+                        ? 0
+                        : stepAt[step.previous]->cost
+                    );
+                    for (const auto& edge: graph.nodes[step.previous].edges) {
+                        if (
+                            (edge.to == node)
+                            && (edge.length == step.cost - previousCost)
+                        ) {
+                            doors |= edge.doors;
+                            break;
+                        }
+                    }
+                    node = step.previous;
+                }
+                matrix.doors[i * count + j] = doors;
+            }
+        }
+    );
+    return matrix;
+}
 
 intmax_t GetNextNumber(
     const std::string& input,
@@ -581,13 +1905,14 @@ struct Machine {
     }
 };
 
-std::vector< Position > Neighbors(const Position& position) {
-    return {
-        {position.x - 1, position.y},
-        {position.x + 1, position.y},
-        {position.x, position.y - 1},
-        {position.x, position.y + 1},
-    };
+void Neighbors(
+    const Position& position,
+    std::vector< Position >& neighbors
+) {
+    neighbors.emplace_back(position.x - 1, position.y);
+    neighbors.emplace_back(position.x + 1, position.y);
+    neighbors.emplace_back(position.x, position.y - 1);
+    neighbors.emplace_back(position.x, position.y + 1);
 }
 
 int Cost(
@@ -623,6 +1948,51 @@ int Cost(
     }
 }
 
+/**
+ * This function returns the door in the given cell of the map, as one bit
+ * of a set of doors, or zero if the cell isn't a door.
+ */
+uint32_t DoorAt(char cell) {
+    if (
+        (cell >= 'A')
+        && (cell <= 'Z')
+    ) {
+        return (uint32_t)1 << (cell - 'A');
+    } else {
+        return 0;
+    }
+}
+
+/**
+ * This function returns the doors which can be opened with the given
+ * keys, one bit per door.
+ */
+uint32_t DoorsOpenedBy(const std::set< char >& keys) {
+    uint32_t doors = 0;
+    for (const auto key: keys) {
+        doors |= DoorAt(key + 'A' - 'a');
+    }
+    return doors;
+}
+
+/**
+ * This function calls the given function with each node of the given
+ * graph which can be reached from the given node in one move, without
+ * going through any door which can't be opened.
+ */
+void GraphNeighbors(
+    const CorridorGraph& graph,
+    uint32_t doorsOpened,
+    size_t node,
+    std::vector< size_t >& neighbors
+) {
+    for (const auto& edge: graph.nodes[node].edges) {
+        if ((edge.doors & ~doorsOpened) == 0) {
+            neighbors.push_back(edge.to);
+        }
+    }
+}
+
 int PositionHeuristic(const Position& start, const Position& end) {
     return (
         abs(end.x - start.x)
@@ -686,7 +2056,7 @@ void FindShortestPath(
         const auto places = PathFinding< Position >::FindReachablePlaces(
             positions[i],
             Neighbors,
-            [&](const Position& start, const Position& end){ return Cost(lines, keySet, end); },
+            [&](const Position&, const Position& end){ return Cost(lines, keySet, end); },
             1000000
         );
         for (const auto& place: places) {
@@ -724,6 +2094,145 @@ void FindShortestPath(
     pathsTried[path] = steps;
 }
 
+/**
+ * This function moves the robots to each key in the given order,
+ * finding the shortest way to each key.  Searches of the map use the
+ * given type of queue for the steps yet to be taken, while searches of
+ * the graph, whose edges have different lengths, always use a heap.
+ *
+ * @param[in] lines
+ *     These are the lines of the map.
+ *
+ * @param[in] keyPositions
+ *     These are the positions of the keys.
+ *
+ * @param[in] positions
+ *     These are the starting positions of the robots.
+ *
+ * @param[in] solution
+ *     This is the order in which to collect the keys.  The robot which
+ *     collects each key is given by the position of the key in this
+ *     string, modulo the number of robots.  Spaces are skipped.
+ *
+ * @param[in] graph
+ *     This is the map with its corridors collapsed.
+ *
+ * @param[in] matrix
+ *     These are the distances between the entrances and the keys.
+ *
+ * @param[in] search
+ *     This is the kind of search with which to find each path:
+ *     "matrix" to look the path up in the distance matrix, "graph"
+ *     for A* on the graph, "jump" for jump point search on the map
+ *     (with any queue but a FifoQueue), or "astar" for A* on the map.
+ *
+ * @param[out] lookedUp
+ *     This is where to store the number of paths looked up in the
+ *     distance matrix, rather than searched for.
+ *
+ * @param[out] searched
+ *     This is where to store the number of paths searched for.
+ *
+ * @param[out] reached
+ *     This is where to store the total number of positions reached
+ *     by the searches.
+ *
+ * @return
+ *     The total number of steps taken is returned.
+ */
+template< typename Queue > int WalkSolution(
+    const std::vector< std::string >& lines,
+    const std::map< char, Position >& keyPositions,
+    std::vector< Position > positions,
+    const std::string& solution,
+    const CorridorGraph& graph,
+    const DistanceMatrix& matrix,
+    const std::string& search,
+    size_t& lookedUp,
+    size_t& searched,
+    size_t& reached
+) {
+    std::set< char > keySet;
+    int steps = 0;
+    lookedUp = 0;
+    searched = 0;
+    reached = 0;
+    PathFinding< Position >::DenseWorkspace< Queue > workspace;
+    workspace.index.width = (int)lines[0].length();
+    workspace.index.height = (int)lines.size();
+    PathFinding< size_t >::MapWorkspace<> graphWorkspace;
+    for (size_t i = 0; i < solution.length(); ++i) {
+        if (solution[i] == ' ') {
+            continue;
+        }
+        const auto& keyPosition = keyPositions.find(solution[i])->second;
+        auto& position = positions[i % positions.size()];
+        const auto doorsOpened = DoorsOpenedBy(keySet);
+        int cost = -1;
+        if (search == "matrix") {
+            // The shortest path may go through a door which can't be
+            // opened yet, in which case the graph is searched instead.
+            const auto from = (size_t)matrix.PointAt((size_t)graph.NodeAt((size_t)position.x, (size_t)position.y));
+            const auto to = (size_t)matrix.PointAt((size_t)graph.NodeAt((size_t)keyPosition.x, (size_t)keyPosition.y));
+            if ((matrix.Doors(from, to) & ~doorsOpened) == 0) {
+                cost = matrix.Length(from, to);
+                ++lookedUp;
+            }
+        }
+        if (
+            (search == "graph")
+            || (
+                (search == "matrix")
+                && (cost < 0)
+            )
+        ) {
+            cost = PathFinding< size_t >::FindPath(
+                graphWorkspace,
+                (size_t)graph.NodeAt((size_t)position.x, (size_t)position.y),
+                (size_t)graph.NodeAt((size_t)keyPosition.x, (size_t)keyPosition.y),
+                [&](size_t node, std::vector< size_t >& neighbors){ GraphNeighbors(graph, doorsOpened, node, neighbors); },
+                [&](size_t from, size_t to){ return graph.Length(from, to, doorsOpened); },
+                [&](size_t from, size_t to){
+                    const auto& start = graph.nodes[from];
+                    const auto& end = graph.nodes[to];
+                    return PositionHeuristic(
+                        Position((int)start.x, (int)start.y),
+                        Position((int)end.x, (int)end.y)
+                    );
+                }
+            ).cost;
+            ++searched;
+            reached += graphWorkspace.reached.size();
+        } else if (search == "jump") {
+            cost = PathFinding< Position >::FindPathJumping(
+                workspace,
+                position,
+                keyPosition,
+                [&](const Position& end){ return (Cost(lines, keySet, end) == 1); }
+            ).cost;
+            ++searched;
+            reached += workspace.reached.size();
+        } else if (search == "astar") {
+            cost = PathFinding< Position >::FindPath(
+                workspace,
+                position,
+                keyPosition,
+                Neighbors,
+                [&](const Position&, const Position& end){ return Cost(lines, keySet, end); },
+                PositionHeuristic,
+                1000000
+            ).cost;
+            ++searched;
+            reached += workspace.reached.size();
+        }
+        printf("Advancing to key '%c' (%d steps)\n", solution[i], cost);
+        steps += cost;
+        position = keyPosition;
+        (void)keySet.insert(solution[i]);
+    }
+    return steps;
+}
+
 /**
  * This function is the entrypoint of the program.
  *
@@ -739,6 +2248,37 @@ int main(int argc, char* argv[]) {
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif /* _WIN32 */
     (void)setbuf(stdout, NULL);
+    std::string queue = "heap";
+    std::string search = "matrix";
+    for (int i = 1; i < argc; ++i) {
+        if (
+            (strcmp(argv[i], "--queue") == 0)
+            && (i + 1 < argc)
+        ) {
+            queue = argv[++i];
+        } else if (
+            (strcmp(argv[i], "--search") == 0)
+            && (i + 1 < argc)
+        ) {
+            search = argv[++i];
+        }
+    }
+    if (
+        (search != "matrix")
+        && (search != "graph")
+        && (search != "jump")
+        && (search != "astar")
+    ) {
+        (void)fprintf(stderr, "Unknown search '%s'\n", search.c_str());
+        return EXIT_FAILURE;
+    }
+    if (
+        (search == "jump")
+        && (queue == "fifo")
+    ) {
+        (void)fprintf(stderr, "Jump point search needs a queue which gives the cheapest step first, not 'fifo'\n");
+        return EXIT_FAILURE;
+    }
 
     // Open the input file and read in the map.
     std::ifstream input("input.txt");
@@ -776,11 +2316,91 @@ int main(int argc, char* argv[]) {
         totalKeys
     );
 
-    // Split map into four quadrants
+    // Split map into four quadrants, with an entrance in each.
     lines[position.y - 1][position.x] = '#';
     lines[position.y + 1][position.x] = '#';
     lines[position.y][position.x - 1] = '#';
     lines[position.y][position.x + 1] = '#';
+    lines[position.y][position.x] = '#';
+    lines[position.y - 1][position.x - 1] = '@';
+    lines[position.y - 1][position.x + 1] = '@';
+    lines[position.y + 1][position.x + 1] = '@';
+    lines[position.y + 1][position.x - 1] = '@';
+
+    // Wall off the parts of the map which can't be reached, and fill in
+    // the dead ends which hold no keys.
+    const auto report = PruneMaze(
+        lines,
+        '#',
+        [](char cell){ return (cell != '#'); },
+        [&](size_t x, size_t y){ return (lines[y][x] == '@'); },
+        [&](size_t x, size_t y){
+            const auto cell = lines[y][x];
+            return (
+                (cell == '@')
+                || (
+                    (cell >= 'a')
+                    && (cell <= 'z')
+                )
+            );
+        }
+    );
+    printf(
+        "Pruned %zu unreachable and %zu dead-end cells, leaving %zu of %zu open cells.\n",
+        report.unreachableCells,
+        report.deadEndCells,
+        report.openCells - report.unreachableCells - report.deadEndCells,
+        report.openCells
+    );
+
+    // Collapse the corridors of the map, so that the searches only need
+    // to consider the junctions, dead ends, keys, and entrances.
+    const auto graph = ContractCorridors(
+        width,
+        height,
+        [&](size_t x, size_t y){ return (lines[y][x] != '#'); },
+        [&](size_t x, size_t y){
+            const auto cell = lines[y][x];
+            return (
+                (cell == '@')
+                || (
+                    (cell >= 'a')
+                    && (cell <= 'z')
+                )
+            );
+        },
+        [&](size_t x, size_t y){ return DoorAt(lines[y][x]); }
+    );
+    printf(
+        "Contracted the map into %zu nodes and %zu edges.\n",
+        graph.nodes.size(),
+        graph.EdgeCount()
+    );
+
+    // Measure the distances between the entrances and every key once,
+    // along with the doors in the way, so that moving from one to
+    // another only needs to look them up.
+    const auto measureStartTime = std::chrono::steady_clock::now();
+    std::vector< size_t > points;
+    for (size_t i = 0; i < graph.nodes.size(); ++i) {
+        const auto cell = lines[graph.nodes[i].y][graph.nodes[i].x];
+        if (
+            (cell == '@')
+            || (
+                (cell >= 'a')
+                && (cell <= 'z')
+            )
+        ) {
+            points.push_back(i);
+        }
+    }
+    const auto matrix = MeasureDistances(graph, points);
+    const auto measureEndTime = std::chrono::steady_clock::now();
+    printf(
+        "Measured the distances between %zu points of interest in %lf seconds.\n",
+        points.size(),
+        std::chrono::duration< double >(measureEndTime - measureStartTime).count()
+    );
 
     // This is the solution worked out on paper.
     //
@@ -791,25 +2411,34 @@ int main(int argc, char* argv[]) {
     positions.push_back({position.x + 1, position.y - 1});
     positions.push_back({position.x + 1, position.y + 1});
     positions.push_back({position.x - 1, position.y + 1});
-    std::set< char > keySet;
+    const auto startTime = std::chrono::steady_clock::now();
     int steps = 0;
-    for (size_t i = 0; i < solution.length(); ++i) {
-        if (solution[i] == ' ') {
-            continue;
-        }
-        const auto path = PathFinding< Position >::FindPath(
-            positions[i % 4],
-            keyPositions[solution[i]],
-            Neighbors,
-            [&](const Position& start, const Position& end){ return Cost(lines, keySet, end); },
-            PositionHeuristic,
-            1000000
-        );
-        printf("Advancing to key '%c' (%d steps)\n", solution[i], path.cost);
-        steps += path.cost;
-        positions[i % 4] = keyPositions[solution[i]];
-        (void)keySet.insert(solution[i]);
+    size_t lookedUp = 0;
+    size_t searched = 0;
+    size_t reached = 0;
+    if (queue == "heap") {
+        steps = WalkSolution< PathFinding< Position >::HeapQueue >(lines, keyPositions, positions, solution, graph, matrix, search, lookedUp, searched, reached);
+    } else if (queue == "fifo") {
+        steps = WalkSolution< PathFinding< Position >::FifoQueue >(lines, keyPositions, positions, solution, graph, matrix, search, lookedUp, searched, reached);
+    } else if (queue == "bucket") {
+        steps = WalkSolution< PathFinding< Position >::BucketQueue >(lines, keyPositions, positions, solution, graph, matrix, search, lookedUp, searched, reached);
+    } else if (queue == "radix") {
+        steps = WalkSolution< PathFinding< Position >::RadixQueue >(lines, keyPositions, positions, solution, graph, matrix, search, lookedUp, searched, reached);
+    } else {
+        (void)fprintf(stderr, "Unknown queue '%s'\n", queue.c_str());
+        return EXIT_FAILURE;
     }
+    const auto endTime = std::chrono::steady_clock::now();
     printf("Shortest path is %d steps.\n", steps);
+    if (lookedUp > 0) {
+        printf("Looked up %zu paths in the distance matrix.\n", lookedUp);
+    }
+    if (searched > 0) {
+        printf("The %zu searches reached %zu positions.\n", searched, reached);
+    }
+    printf(
+        "It took %lf seconds to determine this.\n",
+        std::chrono::duration< double >(endTime - startTime).count()
+    );
     return EXIT_SUCCESS;
 }
@@ -88,6 +88,11 @@ struct Machine {
     bool halted = false;
     intmax_t relativeBase = 0;
 
+    // If not empty, this marks which pages of memory have been written,
+    // so that memory can be put back the way it was cheaply.
+    static constexpr size_t CELLS_PER_PAGE = 64;
+    std::vector< bool > dirtyPages;
+
     void ExpandToFit(size_t index) {
         if (index >= numbers.size()) {
             numbers.resize(index + 1);
@@ -157,6 +162,10 @@ struct Machine {
     ) {
         ExpandToFit(index);
         numbers[index] = value;
+        const auto page = index / CELLS_PER_PAGE;
+        if (page < dirtyPages.size()) {
+            dirtyPages[page] = true;
+        }
     }
 
     void Run(std::vector< intmax_t >& output) {
@@ -266,6 +275,227 @@ struct Machine {
     }
 };
 
+/**
+ * This is a pool of machines loaded with the same program, which are
+ * reused rather than set up from scratch for each run of the program.
+ */
+struct MachinePool {
+    /**
+     * This is the program loaded into the machines.  It shouldn't be
+     * changed once any machines have been handed out.
+     */
+    std::vector< intmax_t > image;
+
+    /**
+     * These are the machines not currently handed out.
+     */
+    std::vector< std::unique_ptr< Machine > > idle;
+
+    /**
+     * This hands out a machine loaded with the program, ready to run
+     * from the beginning, with no input.
+     */
+    std::unique_ptr< Machine > Acquire() {
+        if (idle.empty()) {
+            std::unique_ptr< Machine > machine(new Machine());
+            machine->numbers = image;
+            machine->dirtyPages.resize(
+                (image.size() + Machine::CELLS_PER_PAGE - 1) / Machine::CELLS_PER_PAGE
+            );
+            return machine;
+        }
+        auto machine = std::move(idle.back());
+        idle.pop_back();
+        return machine;
+    }
+
+    /**
+     * This takes back a machine handed out by the pool, putting it back
+     * in its initial state by restoring only the pages of memory written
+     * by the program.  The machine keeps its memory and input buffers,
+     * so reusing it doesn't allocate any memory.
+     */
+    void Release(std::unique_ptr< Machine > machine) {
+        auto& dirtyPages = machine->dirtyPages;
+        machine->numbers.resize(image.size());
+        for (size_t page = 0; page < dirtyPages.size(); ++page) {
+            if (!dirtyPages[page]) {
+                continue;
+            }
+            const auto begin = page * Machine::CELLS_PER_PAGE;
+            const auto end = std::min(begin + Machine::CELLS_PER_PAGE, image.size());
+            (void)std::copy(
+                image.begin() + begin,
+                image.begin() + end,
+                machine->numbers.begin() + begin
+            );
+            dirtyPages[page] = false;
+        }
+        machine->input.clear();
+        machine->pos = 0;
+        machine->halted = false;
+        machine->relativeBase = 0;
+        idle.push_back(std::move(machine));
+    }
+};
+
+/**
+ * This keeps track of where the tractor beam is, row by row.  Rather
+ * than probing every point of a row, it follows the edges of the beam
+ * down from the row above.  The beam spreads out from the emitter in a
+ * straight-sided cone, so both of its edges only ever move right, and
+ * the number of probes needed is proportional to the number of rows,
+ * however wide they are.
+ */
+struct BeamTracer {
+    /**
+     * This is the part of a row affected by the beam.
+     */
+    struct Span {
+        /**
+         * This is the first X position affected by the beam.
+         */
+        size_t start = 0;
+
+        /**
+         * This is the first X position past those affected by the beam.
+         */
+        size_t stop = 0;
+
+        bool Empty() const {
+            return (start == stop);
+        }
+    };
+
+    /**
+     * This is how far to look for the beam in a row, as a multiple of
+     * the row's distance from the emitter, before the beam has been
+     * seen anywhere other than at the emitter.
+     */
+    static constexpr size_t MAX_SLOPE = 8;
+
+    /**
+     * These are the machines running the program of the drone
+     * used to probe the beam.
+     */
+    MachinePool drones;
+
+    /**
+     * This holds the output of each probe, to avoid allocating memory
+     * for each one.
+     */
+    std::vector< intmax_t > output;
+
+    /**
+     * These are the parts of the rows traced so far
+     * affected by the beam.
+     */
+    std::vector< Span > rows;
+
+    /**
+     * This is the last row traced, other than the row of the emitter,
+     * in which the beam was found, or zero if there isn't one yet.
+     */
+    size_t guide = 0;
+
+    /**
+     * This is the number of times the drone has been deployed.
+     */
+    size_t probes = 0;
+
+    /**
+     * This deploys the drone to find out if the given position
+     * is affected by the beam.
+     */
+    bool Probe(size_t x, size_t y) {
+        ++probes;
+        auto machine = drones.Acquire();
+        machine->id = probes;
+        machine->input.push_back((intmax_t)x);
+        machine->input.push_back((intmax_t)y);
+        output.clear();
+        machine->Run(output);
+        drones.Release(std::move(machine));
+        return (output[0] != 0);
+    }
+
+    /**
+     * This finds where the beam is in the row after the last one traced.
+     */
+    void TraceNextRow() {
+        const auto y = rows.size();
+        Span span;
+
+        // Look for the start of the beam no further left than where it
+        // started in the guide row, and stop looking once past where
+        // the guide row shows the right edge of the beam must be.
+        size_t x = 0;
+        size_t limit = MAX_SLOPE * y + 1;
+        if (guide > 0) {
+            x = rows[guide].start;
+            limit = (rows[guide].stop * y + guide - 1) / guide;
+        }
+        while (
+            (x < limit)
+            && !Probe(x, y)
+        ) {
+            ++x;
+        }
+
+        // If the beam is in this row, everything between where it starts
+        // and where it stopped in the guide row is in the beam too, so
+        // look for where it stops from there.
+        if (x < limit) {
+            span.start = x;
+            ++x;
+            if (guide > 0) {
+                x = std::max(x, rows[guide].stop);
+            }
+            while (Probe(x, y)) {
+                ++x;
+            }
+            span.stop = x;
+            if (y > 0) {
+                guide = y;
+            }
+        }
+        rows.push_back(span);
+    }
+
+    /**
+     * This returns the part of the given row affected by the beam,
+     * tracing the beam down to the row if it hasn't been already.
+     */
+    Span Row(size_t y) {
+        while (rows.size() <= y) {
+            TraceNextRow();
+        }
+        return rows[y];
+    }
+
+    /**
+     * This returns the number of points affected by the beam within
+     * the given window.
+     */
+    size_t CountAffected(
+        size_t left,
+        size_t top,
+        size_t width,
+        size_t height
+    ) {
+        size_t count = 0;
+        for (size_t y = top; y < top + height; ++y) {
+            const auto span = Row(y);
+            const auto start = std::max(span.start, left);
+            const auto stop = std::min(span.stop, left + width);
+            if (start < stop) {
+                count += stop - start;
+            }
+        }
+        return count;
+    }
+};
+
 /**
  * This function is the entrypoint of the program.
  *
@@ -298,25 +528,23 @@ int main(int argc, char* argv[]) {
 
     // Count the number of points within the influence of the tractor
     // beam within the 50x50 area nearest the emitter.
-    size_t points = 0;
+    BeamTracer beam;
+    beam.drones.image = std::move(numbers);
+    const auto points = beam.CountAffected(0, 0, 50, 50);
     for (size_t y = 0; y < 50; ++y) {
+        const auto span = beam.Row(y);
         for (size_t x = 0; x < 50; ++x) {
-            Machine machine;
-            machine.id = 1;
-            machine.numbers = numbers;
-            machine.input.push_back((intmax_t)x);
-            machine.input.push_back((intmax_t)y);
-            std::vector< intmax_t > output;
-            machine.Run(output);
-            if (output[0] == 0) {
-                printf(".");
-            } else {
+            if (
+                (x >= span.start)
+                && (x < span.stop)
+            ) {
                 printf("#");
-                ++points;
+            } else {
+                printf(".");
             }
         }
         printf("\n");
     }
-    printf("%zu points are affected.\n", points);
+    printf("%zu points are affected (%zu probes).\n", points, beam.probes);
     return EXIT_SUCCESS;
 }
@@ -88,6 +88,11 @@ struct Machine {
     bool halted = false;
     intmax_t relativeBase = 0;
 
+    // If not empty, this marks which pages of memory have been written,
+    // so that memory can be put back the way it was cheaply.
+    static constexpr size_t CELLS_PER_PAGE = 64;
+    std::vector< bool > dirtyPages;
+
     void ExpandToFit(size_t index) {
         if (index >= numbers.size()) {
             numbers.resize(index + 1);
@@ -157,6 +162,10 @@ struct Machine {
     ) {
         ExpandToFit(index);
         numbers[index] = value;
+        const auto page = index / CELLS_PER_PAGE;
+        if (page < dirtyPages.size()) {
+            dirtyPages[page] = true;
+        }
     }
 
     void Run(std::vector< intmax_t >& output) {
@@ -266,6 +275,374 @@ struct Machine {
     }
 };
 
+/**
+ * This is a pool of machines loaded with the same program, which are
+ * reused rather than set up from scratch for each run of the program.
+ */
+struct MachinePool {
+    /**
+     * This is the program loaded into the machines.  It shouldn't be
+     * changed once any machines have been handed out.
+     */
+    std::vector< intmax_t > image;
+
+    /**
+     * These are the machines not currently handed out.
+     */
+    std::vector< std::unique_ptr< Machine > > idle;
+
+    /**
+     * This hands out a machine loaded with the program, ready to run
+     * from the beginning, with no input.
+     */
+    std::unique_ptr< Machine > Acquire() {
+        if (idle.empty()) {
+            std::unique_ptr< Machine > machine(new Machine());
+            machine->numbers = image;
+            machine->dirtyPages.resize(
+                (image.size() + Machine::CELLS_PER_PAGE - 1) / Machine::CELLS_PER_PAGE
+            );
+            return machine;
+        }
+        auto machine = std::move(idle.back());
+        idle.pop_back();
+        return machine;
+    }
+
+    /**
+     * This takes back a machine handed out by the pool, putting it back
+     * in its initial state by restoring only the pages of memory written
+     * by the program.  The machine keeps its memory and input buffers,
+     * so reusing it doesn't allocate any memory.
+     */
+    void Release(std::unique_ptr< Machine > machine) {
+        auto& dirtyPages = machine->dirtyPages;
+        machine->numbers.resize(image.size());
+        for (size_t page = 0; page < dirtyPages.size(); ++page) {
+            if (!dirtyPages[page]) {
+                continue;
+            }
+            const auto begin = page * Machine::CELLS_PER_PAGE;
+            const auto end = std::min(begin + Machine::CELLS_PER_PAGE, image.size());
+            (void)std::copy(
+                image.begin() + begin,
+                image.begin() + end,
+                machine->numbers.begin() + begin
+            );
+            dirtyPages[page] = false;
+        }
+        machine->input.clear();
+        machine->pos = 0;
+        machine->halted = false;
+        machine->relativeBase = 0;
+        idle.push_back(std::move(machine));
+    }
+};
+
+/**
+ * This keeps track of where the tractor beam is, row by row.  Rather
+ * than probing every point of a row, it follows the edges of the beam
+ * down from the row above.  The beam spreads out from the emitter in a
+ * straight-sided cone, so both of its edges only ever move right, and
+ * the number of probes needed is proportional to the number of rows,
+ * however wide they are.
+ */
+struct BeamTracer {
+    /**
+     * This is the part of a row affected by the beam.
+     */
+    struct Span {
+        /**
+         * This is the first X position affected by the beam.
+         */
+        size_t start = 0;
+
+        /**
+         * This is the first X position past those affected by the beam.
+         */
+        size_t stop = 0;
+
+        bool Empty() const {
+            return (start == stop);
+        }
+    };
+
+    /**
+     * This is how far to look for the beam in a row, as a multiple of
+     * the row's distance from the emitter, before the beam has been
+     * seen anywhere other than at the emitter.
+     */
+    static constexpr size_t MAX_SLOPE = 8;
+
+    /**
+     * This is the number of rows from the emitter which are always
+     * traced, rather than having the edges of the beam in them found
+     * directly.  Near the emitter, the beam is too narrow to tell
+     * where it will be from the rows around it.
+     */
+    static constexpr size_t MIN_LANDMARK_ROW = 100;
+
+    /**
+     * These are the machines running the program of the drone
+     * used to probe the beam.
+     */
+    MachinePool drones;
+
+    /**
+     * This holds the output of each probe, to avoid allocating memory
+     * for each one.
+     */
+    std::vector< intmax_t > output;
+
+    /**
+     * These are the parts of the rows traced so far
+     * affected by the beam.
+     */
+    std::vector< Span > rows;
+
+    /**
+     * This is the last row traced, other than the row of the emitter,
+     * in which the beam was found, or zero if there isn't one yet.
+     */
+    size_t guide = 0;
+
+    /**
+     * These are the rows beyond those traced in which the edges of the
+     * beam have been found directly.
+     */
+    std::map< size_t, Span > landmarks;
+
+    /**
+     * This is the number of times the drone has been deployed.
+     */
+    size_t probes = 0;
+
+    /**
+     * This deploys the drone to find out if the given position
+     * is affected by the beam.
+     */
+    bool Probe(size_t x, size_t y) {
+        ++probes;
+        auto machine = drones.Acquire();
+        machine->id = probes;
+        machine->input.push_back((intmax_t)x);
+        machine->input.push_back((intmax_t)y);
+        output.clear();
+        machine->Run(output);
+        drones.Release(std::move(machine));
+        return (output[0] != 0);
+    }
+
+    /**
+     * This finds where the beam is in the row after the last one traced.
+     */
+    void TraceNextRow() {
+        const auto y = rows.size();
+        Span span;
+
+        // Look for the start of the beam no further left than where it
+        // started in the guide row, and stop looking once past where
+        // the guide row shows the right edge of the beam must be.
+        size_t x = 0;
+        size_t limit = MAX_SLOPE * y + 1;
+        if (guide > 0) {
+            x = rows[guide].start;
+            limit = (rows[guide].stop * y + guide - 1) / guide;
+        }
+        while (
+            (x < limit)
+            && !Probe(x, y)
+        ) {
+            ++x;
+        }
+
+        // If the beam is in this row, everything between where it starts
+        // and where it stopped in the guide row is in the beam too, so
+        // look for where it stops from there.
+        if (x < limit) {
+            span.start = x;
+            ++x;
+            if (guide > 0) {
+                x = std::max(x, rows[guide].stop);
+            }
+            while (Probe(x, y)) {
+                ++x;
+            }
+            span.stop = x;
+            if (y > 0) {
+                guide = y;
+            }
+        }
+        rows.push_back(span);
+    }
+
+    /**
+     * This returns the part of the given row affected by the beam,
+     * tracing the beam down to the row if it hasn't been already.
+     */
+    Span Row(size_t y) {
+        while (rows.size() <= y) {
+            TraceNextRow();
+        }
+        return rows[y];
+    }
+
+    /**
+     * This returns the number of points affected by the beam within
+     * the given window.
+     */
+    size_t CountAffected(
+        size_t left,
+        size_t top,
+        size_t width,
+        size_t height
+    ) {
+        size_t count = 0;
+        for (size_t y = top; y < top + height; ++y) {
+            const auto span = Row(y);
+            const auto start = std::max(span.start, left);
+            const auto stop = std::min(span.stop, left + width);
+            if (start < stop) {
+                count += stop - start;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * This finds an edge of the beam in the given row, starting from an
+     * estimate of where it is.
+     *
+     * @param[in] y
+     *     This is the row in which to find the edge.
+     *
+     * @param[in] estimate
+     *     This is where the edge is expected to be.
+     *
+     * @param[in] left
+     *     This indicates whether to find the left edge, which is the
+     *     first position inside the beam, or the right edge, which is the
+     *     first position past the beam.
+     *
+     * @param[in] floor
+     *     This is the leftmost position to consider.  For the right edge,
+     *     it must be known to be inside the beam.
+     *
+     * @return
+     *     The position of the edge is returned.
+     */
+    size_t FindEdge(
+        size_t y,
+        size_t estimate,
+        bool left,
+        size_t floor
+    ) {
+        // Gallop away from the estimate until the edge is bracketed.
+        const auto past = [&](size_t x){ return (Probe(x, y) == left); };
+        estimate = std::max(estimate, floor);
+        size_t before = estimate;
+        size_t after = estimate;
+        size_t step = 1;
+        if (past(estimate)) {
+            for (;;) {
+                if (after - floor <= step) {
+                    if (
+                        left
+                        && past(floor)
+                    ) {
+                        return floor;
+                    }
+                    before = floor;
+                    break;
+                }
+                const auto x = after - step;
+                if (!past(x)) {
+                    before = x;
+                    break;
+                }
+                after = x;
+                step *= 2;
+            }
+        } else {
+            for (;;) {
+                const auto x = before + step;
+                if (past(x)) {
+                    after = x;
+                    break;
+                }
+                before = x;
+                step *= 2;
+            }
+        }
+
+        // Narrow down the bracket to the edge.
+        while (after - before > 1) {
+            const auto middle = before + (after - before) / 2;
+            if (past(middle)) {
+                after = middle;
+            } else {
+                before = middle;
+            }
+        }
+        return after;
+    }
+
+    /**
+     * This returns the part of the given row affected by the beam,
+     * finding its edges directly if the row is far enough from the
+     * emitter, rather than tracing the beam down to the row.  Where
+     * the edges are expected is worked out from the slopes of the
+     * edges in the nearest row already known, so only a few probes
+     * are needed to find them.
+     */
+    Span FindRow(size_t y) {
+        if (
+            (y <= MIN_LANDMARK_ROW)
+            || (y < rows.size())
+        ) {
+            return Row(y);
+        }
+        (void)Row(MIN_LANDMARK_ROW);
+        if (guide == 0) {
+            return Span();
+        }
+        const auto landmark = landmarks.find(y);
+        if (landmark != landmarks.end()) {
+            return landmark->second;
+        }
+
+        // Pick the known row whose edge slopes give the best estimate,
+        // which is the one nearest the row in proportion to its
+        // distance from the emitter.
+        size_t reference = guide;
+        auto referenceSpan = rows[guide];
+        const auto consider = [&](size_t row, const Span& span){
+            const auto distance = (row > y) ? row - y : y - row;
+            const auto referenceDistance = (reference > y) ? reference - y : y - reference;
+            if (
+                !span.Empty()
+                && (distance * reference < referenceDistance * row)
+            ) {
+                reference = row;
+                referenceSpan = span;
+            }
+        };
+        auto next = landmarks.lower_bound(y);
+        if (next != landmarks.end()) {
+            consider(next->first, next->second);
+        }
+        if (next != landmarks.begin()) {
+            --next;
+            consider(next->first, next->second);
+        }
+        Span span;
+        span.start = FindEdge(y, referenceSpan.start * y / reference, true, 0);
+        span.stop = FindEdge(y, referenceSpan.stop * y / reference, false, span.start);
+        landmarks[y] = span;
+        return span;
+    }
+};
+
 /**
  * This function is the entrypoint of the program.
  *
@@ -296,41 +673,66 @@ int main(int argc, char* argv[]) {
         numbers.push_back(number);
     }
 
-    // Search for corners in the beam at every Y position,
-    // until a square of 100x100 can be found within.
-    std::vector< size_t > starts, stops;
-    size_t square = 0;
-    for (size_t y = 0; square < 100; ++y) {
-        bool beamStart = false;
-        bool beamStop = false;
-        for (size_t x = y; !beamStop; ++x) {
-            Machine machine;
-            machine.id = 1;
-            machine.numbers = numbers;
-            machine.input.push_back((intmax_t)x);
-            machine.input.push_back((intmax_t)y);
-            std::vector< intmax_t > output;
-            machine.Run(output);
-            if (output[0] == 0) {
-                if (beamStart) {
-                    beamStop = true;
-                    stops.push_back(x - 1);
-                }
-            } else {
-                if (!beamStart) {
-                    beamStart = true;
-                    starts.push_back(x);
-                }
-            }
+    // The size of the square to fit may be given on the command line.
+    size_t size = 100;
+    if (argc > 1) {
+        size = (size_t)strtoul(argv[1], NULL, 10);
+        if (size == 0) {
+            (void)fprintf(stderr, "Bad square size '%s'\n", argv[1]);
+            return EXIT_FAILURE;
         }
-        square = 0;
-        for (size_t i = 1; y >= i; ++i) {
-            if (stops[y-i] < starts[y] + i) {
-                square = i;
+    }
+
+    // The square fits with its bottom row at a given Y position if the
+    // right edge of the beam in the top row of the square is far enough
+    // right of the left edge of the beam in the bottom row.  Once the
+    // square fits, it fits in every row further down, so the first row
+    // in which it fits can be found with a galloping search to bracket
+    // it, followed by a binary search within the bracket.
+    BeamTracer beam;
+    beam.drones.image = std::move(numbers);
+    const auto fits = [&](size_t y){
+        const auto bottom = beam.FindRow(y);
+        if (bottom.Empty()) {
+            return false;
+        }
+        const auto top = beam.FindRow(y - (size - 1));
+        return (
+            !top.Empty()
+            && (top.stop >= bottom.start + size)
+        );
+    };
+    size_t before = size - 1;
+    size_t after = before;
+    if (!fits(after)) {
+        size_t step = 1;
+        for (;;) {
+            after = before + step;
+            if (fits(after)) {
                 break;
             }
+            before = after;
+            step *= 2;
+        }
+        while (after - before > 1) {
+            const auto middle = before + (after - before) / 2;
+            if (fits(middle)) {
+                after = middle;
+            } else {
+                before = middle;
+            }
         }
-        printf("At y=%zu, we can fit a square of size %zu, with closest point at x=%zu, y=%zu\n", y, square, starts[y], y - square + 1);
     }
+    const auto x = beam.FindRow(after).start;
+    const auto y = after - (size - 1);
+    printf(
+        "At y=%zu, we can fit a square of size %zu, with closest point at x=%zu, y=%zu (%zu probes)\n",
+        after,
+        size,
+        x,
+        y,
+        beam.probes
+    );
+    printf("Answer: %zu\n", x * 10000 + y);
     return EXIT_SUCCESS;
 }
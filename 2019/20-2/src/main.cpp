@@ -8,21 +8,161 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <fstream>
 #include <functional>
 #include <map>
-#include <queue>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string>
 #include <string.h>
+#include <thread>
 #include <vector>
 
 #ifdef _WIN32
 #include <crtdbg.h>
 #endif /* _WIN32 */
 
+/**
+ * This is the default kind of statistics for a search to keep: none at
+ * all.  Every method does nothing, so a search which keeps no statistics
+ * compiles to the same code as if it had no way to keep them.
+ */
+struct NoStats {
+    void Begin() {
+    }
+
+    void Push() {
+    }
+
+    void Pop() {
+    }
+
+    void Stale() {
+    }
+
+    template< typename T > void Expand(const T&) {
+    }
+
+    void Relax() {
+    }
+
+    void Heuristic() {
+    }
+
+    void End() {
+    }
+};
+
+/**
+ * This keeps statistics about the searches which use it.  The counts
+ * and the elapsed time add up over every search, while the peak size
+ * of the frontier is the largest of any search.
+ */
+struct SearchStats {
+    /**
+     * This is the number of steps pushed onto the frontier.
+     */
+    size_t pushed = 0;
+
+    /**
+     * This is the number of steps popped off the frontier.
+     */
+    size_t popped = 0;
+
+    /**
+     * This is the number of steps popped off the frontier which were
+     * skipped, because a cheaper way to the same position was found
+     * after they were pushed.
+     */
+    size_t stale = 0;
+
+    /**
+     * This is the largest number of steps on the frontier at once.
+     */
+    size_t peakFrontier = 0;
+
+    /**
+     * This is the number of times a position was reached for the first
+     * time, or more cheaply than before.
+     */
+    size_t relaxations = 0;
+
+    /**
+     * This is the number of times the heuristic was called.
+     */
+    size_t heuristicCalls = 0;
+
+    /**
+     * This is the time spent searching, in seconds.
+     */
+    double elapsed = 0.0;
+
+    /**
+     * This is the number of steps on the frontier of the current search.
+     */
+    size_t frontier = 0;
+
+    /**
+     * This is when the current search began.
+     */
+    std::chrono::steady_clock::time_point start;
+
+    void Begin() {
+        frontier = 0;
+        start = std::chrono::steady_clock::now();
+    }
+
+    void Push() {
+        ++pushed;
+        ++frontier;
+        peakFrontier = std::max(peakFrontier, frontier);
+    }
+
+    void Pop() {
+        ++popped;
+        --frontier;
+    }
+
+    void Stale() {
+        ++stale;
+    }
+
+    template< typename T > void Expand(const T&) {
+    }
+
+    void Relax() {
+        ++relaxations;
+    }
+
+    void Heuristic() {
+        ++heuristicCalls;
+    }
+
+    void End() {
+        elapsed += std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+/**
+ * This keeps the same statistics as SearchStats, along with the positions
+ * expanded by the searches which use it, in the order they were expanded,
+ * so that the searches can be visualized.  The type of position is
+ * a template argument.
+ */
+template< typename T > struct SearchTrace: SearchStats {
+    /**
+     * These are the positions expanded, in order.
+     */
+    std::vector< T > expanded;
+
+    void Expand(const T& position) {
+        expanded.push_back(position);
+    }
+};
+
 /**
  * This template is used to find a path from one position
  * to another, where the type of position is a template argument.
@@ -96,41 +236,6 @@ template< typename T > struct PathFinding {
         }
     };
 
-    /**
-     * This is the type of function which determines the immediate
-     * neighbors of a given position.
-     *
-     * @param[in] position
-     *     This is the position for which to find neighbors.
-     *
-     * @return
-     *     The immediate neighbors of the given position are returned.
-     */
-    typedef std::function<
-        std::vector< T >(const T& position)
-    > NeighborFunction;
-
-    /**
-     * This is the type of function which computes the cost
-     * of moving from one position to another.
-     *
-     * @param[in] start
-     *     This is the starting position.
-     *
-     * @param[in] end
-     *     This is the end position.
-     *
-     * @return
-     *     The cost of moving from the start position to the end
-     *     position is returned.
-     */
-    typedef std::function<
-        int(
-            const T& start,
-            const T& end
-        )
-    > CostFunction;
-
     /**
      * This structure holds information returned by the FindPath function.
      */
@@ -153,6 +258,263 @@ template< typename T > struct PathFinding {
         std::vector< T > steps;
     };
 
+    /**
+     * This is a queue of steps yet to be taken, which always gives the
+     * cheapest step next, for any costs.  It's a binary heap, in which
+     * a position is queued again whenever a cheaper way to it is found,
+     * leaving the stale entries to be taken later.
+     */
+    struct HeapQueue {
+        std::vector< SearchStep > steps;
+
+        void Clear() {
+            steps.clear();
+        }
+
+        bool Empty() const {
+            return steps.empty();
+        }
+
+        void Push(const SearchStep& step) {
+            steps.push_back(step);
+            std::push_heap(steps.begin(), steps.end());
+        }
+
+        const SearchStep& Top() {
+            return steps.front();
+        }
+
+        void Pop() {
+            std::pop_heap(steps.begin(), steps.end());
+            steps.pop_back();
+        }
+    };
+
+    /**
+     * This is a queue of steps yet to be taken, which gives steps in
+     * the order they were queued, ignoring their costs.  It's only
+     * suitable when every move costs the same, where it turns the
+     * search into a breadth-first search, which reaches every position
+     * the cheapest way first, so no position is ever queued twice.
+     */
+    struct FifoQueue {
+        std::vector< SearchStep > steps;
+        size_t next = 0;
+
+        void Clear() {
+            steps.clear();
+            next = 0;
+        }
+
+        bool Empty() const {
+            return (next == steps.size());
+        }
+
+        void Push(const SearchStep& step) {
+            steps.push_back(step);
+        }
+
+        const SearchStep& Top() {
+            return steps[next];
+        }
+
+        void Pop() {
+            if (++next == steps.size()) {
+                Clear();
+            }
+        }
+    };
+
+    /**
+     * This is a queue of steps yet to be taken, which always gives the
+     * cheapest step next, for costs which are small integers (Dial's
+     * algorithm).  There's a bucket of steps for every cost, and the
+     * buckets are emptied in order of cost.
+     */
+    struct BucketQueue {
+        std::vector< std::vector< SearchStep > > buckets;
+        size_t current = 0;
+        size_t count = 0;
+
+        void Clear() {
+            for (auto& bucket: buckets) {
+                bucket.clear();
+            }
+            current = 0;
+            count = 0;
+        }
+
+        bool Empty() const {
+            return (count == 0);
+        }
+
+        void Push(const SearchStep& step) {
+            const auto cost = (size_t)step.cost;
+            if (cost >= buckets.size()) {
+                buckets.resize(cost + 1);
+            }
+            buckets[cost].push_back(step);
+            current = std::min(current, cost);
+            ++count;
+        }
+
+        const SearchStep& Top() {
+            while (buckets[current].empty()) {
+                ++current;
+            }
+            return buckets[current].back();
+        }
+
+        void Pop() {
+            (void)Top();
+            buckets[current].pop_back();
+            --count;
+        }
+    };
+
+    /**
+     * This is a queue of steps yet to be taken, which always gives the
+     * cheapest step next, for any costs, as long as no step is queued
+     * with a lower cost than the last step taken (a radix heap).  That
+     * holds for these searches, since moves never have negative costs,
+     * as long as the heuristic never drops by more than the cost of
+     * a move.
+     * Steps are kept in buckets by the highest bit in which their cost
+     * differs from the cost of the last step taken, so a step is moved
+     * to another bucket at most once for each bit of its cost.
+     */
+    struct RadixQueue {
+        static constexpr size_t BUCKETS = 33;
+        std::vector< SearchStep > buckets[BUCKETS];
+        uint32_t last = 0;
+        size_t count = 0;
+
+        static size_t Bucket(uint32_t cost, uint32_t last) {
+            size_t bucket = 0;
+            for (auto bits = cost ^ last; bits != 0; bits >>= 1) {
+                ++bucket;
+            }
+            return bucket;
+        }
+
+        void Clear() {
+            for (auto& bucket: buckets) {
+                bucket.clear();
+            }
+            last = 0;
+            count = 0;
+        }
+
+        bool Empty() const {
+            return (count == 0);
+        }
+
+        void Push(const SearchStep& step) {
+            buckets[Bucket((uint32_t)step.cost, last)].push_back(step);
+            ++count;
+        }
+
+        const SearchStep& Top() {
+            if (buckets[0].empty()) {
+                // Take the lowest bucket with any steps in it, and spread
+                // its steps out over the buckets below it, by the highest
+                // bit in which their costs differ from its cheapest.
+                size_t i = 1;
+                while (buckets[i].empty()) {
+                    ++i;
+                }
+                last = (uint32_t)buckets[i][0].cost;
+                for (const auto& step: buckets[i]) {
+                    last = std::min(last, (uint32_t)step.cost);
+                }
+                for (const auto& step: buckets[i]) {
+                    buckets[Bucket((uint32_t)step.cost, last)].push_back(step);
+                }
+                buckets[i].clear();
+            }
+            return buckets[0].back();
+        }
+
+        void Pop() {
+            (void)Top();
+            buckets[0].pop_back();
+            --count;
+        }
+    };
+
+    /**
+     * This holds what a search needs as it goes, keeping its steps
+     * in a map.
+     * The type of queue of steps yet to be taken, and the kind of
+     * statistics to keep, are template arguments.
+     */
+    template<
+        typename Queue = HeapQueue,
+        typename Stats = NoStats
+    > struct MapWorkspace {
+        /**
+         * These are the steps taken so far, keyed by position.
+         */
+        std::map< T, SearchStep > steps;
+
+        /**
+         * This is the queue of steps yet to be taken.
+         */
+        Queue frontier;
+
+        /**
+         * This is where the neighbors of a position are put.
+         */
+        std::vector< T > neighbors;
+
+        /**
+         * These are the positions reached, in the order first reached.
+         */
+        std::vector< T > reached;
+
+        /**
+         * These are the statistics kept about the searches which use
+         * the workspace.
+         */
+        Stats stats;
+
+        /**
+         * This sets up the workspace for a new search.
+         */
+        void Begin() {
+            steps.clear();
+            frontier.Clear();
+            reached.clear();
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * or nullptr if the position hasn't been reached yet.
+         */
+        SearchStep* Find(const T& position) {
+            const auto stepsEntry = steps.find(position);
+            if (stepsEntry == steps.end()) {
+                return nullptr;
+            }
+            return &stepsEntry->second;
+        }
+
+        /**
+         * This returns the step taken to the given position,
+         * adding it first if the position hasn't been reached yet.
+         */
+        SearchStep& Add(const T& position) {
+            const auto stepsEntry = steps.find(position);
+            if (stepsEntry != steps.end()) {
+                return stepsEntry->second;
+            }
+            reached.push_back(position);
+            auto& step = steps[position];
+            step = SearchStep(position, position, 0);
+            return step;
+        }
+    };
+
     /**
      * This method finds a path from a given starting position
      * to a given destination.
@@ -165,7 +527,10 @@ template< typename T > struct PathFinding {
      *     This is the position to which to find a path.
      *
      * @param[in] findNeighbors
-     *     This function is used to find the neighbors of given positions.
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.  The same
+     *     vector is reused for every call, so that finding neighbors
+     *     doesn't allocate memory once the search is under way.
      *
      * @param[in] moveCost
      *     This function computes the cost of moving from one position
@@ -183,151 +548,1080 @@ template< typename T > struct PathFinding {
      *     Information about the path from the given starting position
      *     to the given destination is returned.
      */
-    static Path FindPath(
+    template<
+        typename NeighborFunction,
+        typename CostFunction,
+        typename HeuristicFunction
+    > static Path FindPath(
         const T& startingPosition,
         const T& destination,
         NeighborFunction findNeighbors,
         CostFunction moveCost,
-        CostFunction heuristic,
+        HeuristicFunction heuristic,
         int maxCost = 0
     ) {
-        std::priority_queue< SearchStep > frontier;
-        std::map< T, SearchStep > steps;
-        frontier.emplace(startingPosition, startingPosition, 0);
-        steps[startingPosition] = frontier.top();
-        while (!frontier.empty()) {
-            auto lastStep = frontier.top();
+        MapWorkspace<> workspace;
+        return FindPath(
+            workspace,
+            startingPosition,
+            destination,
+            findNeighbors,
+            moveCost,
+            heuristic,
+            maxCost
+        );
+    }
+
+    /**
+     * This method finds a path from a given starting position
+     * to a given destination, using the given workspace, which can be
+     * reused for other searches afterwards.
+     *
+     * @param[in,out] workspace
+     *     This holds what the search needs as it goes.  It's
+     *     a MapWorkspace, with the kind of queue which best suits the
+     *     costs of moves: a HeapQueue for any costs, a FifoQueue if
+     *     every move costs the same, a BucketQueue for small integer
+     *     costs, or a RadixQueue for large ones.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     a path to the given destination.
+     *
+     * @param[in] destination
+     *     This is the position to which to find a path.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] heuristic
+     *     This function estimates the remaining cost of moving from
+     *     a given position to another.
+     *
+     * @param[in] maxCost
+     *     If non-zero, this sets a maximum cost for the path to
+     *     find.
+     *
+     * @return
+     *     Information about the path from the given starting position
+     *     to the given destination is returned.
+     */
+    template<
+        typename Workspace,
+        typename NeighborFunction,
+        typename CostFunction,
+        typename HeuristicFunction
+    > static Path FindPath(
+        Workspace& workspace,
+        const T& startingPosition,
+        const T& destination,
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        HeuristicFunction heuristic,
+        int maxCost = 0
+    ) {
+        workspace.Begin();
+        auto& frontier = workspace.frontier;
+        auto& neighbors = workspace.neighbors;
+        auto& stats = workspace.stats;
+        stats.Begin();
+        frontier.Push(SearchStep(startingPosition, startingPosition, 0));
+        stats.Push();
+        (void)workspace.Add(startingPosition);
+        while (!frontier.Empty()) {
+            const auto lastStep = frontier.Top();
             if (lastStep.position == destination) {
                 Path path;
                 path.reachable = true;
-                path.cost = steps[lastStep.position].cost;
-                for (auto position = lastStep.position; position != startingPosition; position = steps[position].previous) {
+                path.cost = workspace.Find(lastStep.position)->cost;
+                for (auto position = lastStep.position; position != startingPosition; position = workspace.Find(position)->previous) {
                     path.steps.push_back(position);
                 }
                 std::reverse(path.steps.begin(), path.steps.end());
+                stats.End();
                 return path;
             }
-            frontier.pop();
-            for (const auto& nextStepPosition: findNeighbors(lastStep.position)) {
+            frontier.Pop();
+            stats.Pop();
+            const auto lastStepCost = workspace.Find(lastStep.position)->cost;
+            if (lastStep.previous != workspace.Find(lastStep.position)->previous) {
+                stats.Stale();
+                continue;
+            }
+            stats.Expand(lastStep.position);
+            neighbors.clear();
+            findNeighbors(lastStep.position, neighbors);
+            for (const auto& nextStepPosition: neighbors) {
                 auto nextStepCost = moveCost(lastStep.position, nextStepPosition);
                 const auto nextStepHeuristic = heuristic(nextStepPosition, destination);
-                nextStepCost += steps[lastStep.position].cost;
+                stats.Heuristic();
+                nextStepCost += lastStepCost;
                 if (
                     (maxCost > 0)
                     && (nextStepCost + nextStepHeuristic > maxCost)
                 ) {
                     continue;
                 }
-                auto step = steps.find(nextStepPosition);
+                const auto step = workspace.Find(nextStepPosition);
                 if (
-                    (step == steps.end())
-                    || (nextStepCost < step->second.cost)
+                    (step == nullptr)
+                    || (nextStepCost < step->cost)
                 ) {
-                    steps[nextStepPosition].cost = nextStepCost;
-                    steps[nextStepPosition].previous = lastStep.position;
-                    frontier.emplace(
-                        nextStepPosition,
-                        lastStep.position,
-                        nextStepCost + nextStepHeuristic
+                    auto& nextStep = workspace.Add(nextStepPosition);
+                    nextStep.cost = nextStepCost;
+                    nextStep.previous = lastStep.position;
+                    stats.Relax();
+                    frontier.Push(
+                        SearchStep(
+                            nextStepPosition,
+                            lastStep.position,
+                            nextStepCost + nextStepHeuristic
+                        )
                     );
+                    stats.Push();
                 }
             }
         }
+        stats.End();
         return Path();
     }
-};
 
-template< int N > struct Position {
-    int m[N];
+    /**
+     * This method finds all the places that are reachable from the
+     * given starting position, and the total cost to reach them.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     all reachable places.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.  The same
+     *     vector is reused for every call, so that finding neighbors
+     *     doesn't allocate memory once the search is under way.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] maxCost
+     *     If non-zero, this sets a maximum cost after which no more
+     *     reachable places are sought after.
+     *
+     * @return
+     *     A list of places and the total cost to reach them is returned.
+     *     This list is sorted by increasing total cost.
+     */
+    template<
+        typename NeighborFunction,
+        typename CostFunction
+    > static std::vector< SearchStep > FindReachablePlaces(
+        const T& startingPosition,
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        int maxCost = 0
+    ) {
+        MapWorkspace<> workspace;
+        return FindReachablePlaces(
+            workspace,
+            startingPosition,
+            findNeighbors,
+            moveCost,
+            maxCost
+        );
+    }
+
+    /**
+     * This method finds all the places that are reachable from the
+     * given starting position, and the total cost to reach them, using
+     * the given workspace, which can be reused for other searches
+     * afterwards.
+     *
+     * @param[in,out] workspace
+     *     This holds what the search needs as it goes.  It's
+     *     a MapWorkspace, with the kind of queue which best suits the
+     *     costs of moves: a HeapQueue for any costs, a FifoQueue if
+     *     every move costs the same, a BucketQueue for small integer
+     *     costs, or a RadixQueue for large ones.
+     *
+     * @param[in] startingPosition
+     *     This is the starting position from which to find
+     *     all reachable places.
+     *
+     * @param[in] findNeighbors
+     *     This function is called with a position and a vector, to which
+     *     it appends the immediate neighbors of the position.
+     *
+     * @param[in] moveCost
+     *     This function computes the cost of moving from one position
+     *     to an adjacent position.
+     *
+     * @param[in] maxCost
+     *     If non-zero, this sets a maximum cost after which no more
+     *     reachable places are sought after.
+     *
+     * @return
+     *     A list of places and the total cost to reach them is returned.
+     *     This list is sorted by increasing total cost.
+     */
+    template<
+        typename Workspace,
+        typename NeighborFunction,
+        typename CostFunction
+    > static std::vector< SearchStep > FindReachablePlaces(
+        Workspace& workspace,
+        const T& startingPosition,
+        NeighborFunction findNeighbors,
+        CostFunction moveCost,
+        int maxCost = 0
+    ) {
+        workspace.Begin();
+        auto& frontier = workspace.frontier;
+        auto& neighbors = workspace.neighbors;
+        auto& stats = workspace.stats;
+        stats.Begin();
+        frontier.Push(SearchStep(startingPosition, startingPosition, 0));
+        stats.Push();
+        (void)workspace.Add(startingPosition);
+        while (!frontier.Empty()) {
+            const auto lastStep = frontier.Top();
+            frontier.Pop();
+            stats.Pop();
+            const auto lastStepCost = workspace.Find(lastStep.position)->cost;
+            if (lastStep.cost > lastStepCost) {
+                stats.Stale();
+                continue;
+            }
+            stats.Expand(lastStep.position);
+            neighbors.clear();
+            findNeighbors(lastStep.position, neighbors);
+            for (const auto& nextStepPosition: neighbors) {
+                auto nextStepCost = moveCost(lastStep.position, nextStepPosition);
+                nextStepCost += lastStepCost;
+                if (
+                    (maxCost > 0)
+                    && (nextStepCost > maxCost)
+                ) {
+                    continue;
+                }
+                const auto step = workspace.Find(nextStepPosition);
+                if (
+                    (step == nullptr)
+                    || (nextStepCost < step->cost)
+                ) {
+                    auto& nextStep = workspace.Add(nextStepPosition);
+                    nextStep.previous = lastStep.position;
+                    nextStep.cost = nextStepCost;
+                    stats.Relax();
+                    frontier.Push(
+                        SearchStep(
+                            nextStepPosition,
+                            lastStep.position,
+                            nextStepCost
+                        )
+                    );
+                    stats.Push();
+                }
+            }
+        }
+        stats.End();
+        std::vector< SearchStep > places;
+        for (const auto& position: workspace.reached) {
+            if (position != startingPosition) {
+                places.push_back(*workspace.Find(position));
+            }
+        }
+        std::sort(
+            places.begin(),
+            places.end(),
+            [](
+                const SearchStep& a,
+                const SearchStep& b
+            ){
+                return a.cost < b.cost;
+            }
+        );
+        return places;
+    }
+};
+
+template< int N > struct Position {
+    int m[N];
+
+    Position() {
+        (void)memset(m, 0, sizeof(m));
+    }
+
+    Position(std::initializer_list< int > list) {
+        size_t i = 0;
+        for (auto element: list) {
+            m[i++] = element;
+        }
+    }
+
+    Position(const Position<N-1>& other) {
+        (void)memset(m, 0, sizeof(m));
+        for (size_t i = 0; i < N - 1; ++i) {
+            m[i] = other.m[i];
+        }
+    }
+
+    template< int M > Position<M> Reduce() const {
+        Position<M> reduction;
+        for (size_t i = 0; i < M; ++i) {
+            if (i >= N) {
+                break;
+            }
+            reduction.m[i] = m[i];
+        }
+        return reduction;
+    }
+
+    bool operator==(const Position& other) const {
+        for (size_t i = 0; i < N; ++i) {
+            if (m[i] != other.m[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const Position& other) const {
+        return !(*this == other);
+    }
+
+    bool operator<(const Position& other) const {
+        for (size_t i = 0; i < N; ++i) {
+            if (m[i] < other.m[i]) {
+                return true;
+            } else if (m[i] > other.m[i]) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    Position& operator+=(const Position& other) {
+        for (size_t i = 0; i < N; ++i) {
+            m[i] += other.m[i];
+        }
+        return *this;
+    }
+
+    Position& operator-=(const Position& other) {
+        for (size_t i = 0; i < N; ++i) {
+            m[i] -= other.m[i];
+        }
+        return *this;
+    }
+
+    Position operator+(const Position& other) const {
+        Position sum = *this;
+        return sum += other;
+    }
+
+    Position operator-(const Position& other) const {
+        Position sum = *this;
+        return sum -= other;
+    }
+};
+
+using PortalPositions = std::map<
+    Position<2>,
+    std::string
+>;
+
+using Portals = std::map<
+    std::string,
+    std::pair< Position<2>, Position<2> >
+>;
+
+/**
+ * This is a maze with each of its corridors collapsed into a single
+ * weighted edge, so that only the junctions, dead ends, and points of
+ * interest of the maze are left as nodes.
+ */
+struct CorridorGraph {
+    /**
+     * This is one way out of a node, along a corridor.
+     */
+    struct Edge {
+        /**
+         * This is the index of the node at the other end of the corridor.
+         */
+        size_t to;
+
+        /**
+         * This is the number of steps it takes to follow the corridor.
+         */
+        int length;
+
+        /**
+         * These are the doors along the corridor, one bit per door,
+         * including any door at the node at the other end.
+         */
+        uint32_t doors;
+
+        Edge(
+            size_t to,
+            int length,
+            uint32_t doors
+        )
+            : to(to)
+            , length(length)
+            , doors(doors)
+        {
+        }
+    };
+
+    /**
+     * This is a cell of the maze which is kept as a node of the graph.
+     */
+    struct Node {
+        size_t x = 0;
+        size_t y = 0;
+        std::vector< Edge > edges;
+    };
+
+    /**
+     * This is the width of the maze, in cells.
+     */
+    size_t width = 0;
+
+    /**
+     * This is the height of the maze, in cells.
+     */
+    size_t height = 0;
+
+    /**
+     * These are the nodes of the graph, in row-major order.
+     */
+    std::vector< Node > nodes;
+
+    /**
+     * This holds the index of the node at each cell of the maze,
+     * in row-major order, or -1 for cells which aren't nodes.
+     */
+    std::vector< int > nodeAt;
+
+    /**
+     * This returns the index of the node at the given cell of the maze,
+     * or -1 if the cell isn't a node.
+     */
+    int NodeAt(size_t x, size_t y) const {
+        return nodeAt[y * width + x];
+    }
+
+    /**
+     * This returns the number of edges in the graph, counting each
+     * corridor once from each end.
+     */
+    size_t EdgeCount() const {
+        size_t count = 0;
+        for (const auto& node: nodes) {
+            count += node.edges.size();
+        }
+        return count;
+    }
+
+    /**
+     * This returns the length of the shortest edge from one node to
+     * another, using only edges whose doors can all be opened.
+     *
+     * @param[in] from
+     *     This is the index of the node from which to move.
+     *
+     * @param[in] to
+     *     This is the index of the node to which to move.
+     *
+     * @param[in] keys
+     *     These are the doors which can be opened, one bit per door.
+     *
+     * @return
+     *     The length of the shortest edge is returned, or -1 if there
+     *     is no such edge.
+     */
+    int Length(
+        size_t from,
+        size_t to,
+        uint32_t keys
+    ) const {
+        int length = -1;
+        for (const auto& edge: nodes[from].edges) {
+            if (
+                (edge.to == to)
+                && ((edge.doors & ~keys) == 0)
+                && (
+                    (length < 0)
+                    || (edge.length < length)
+                )
+            ) {
+                length = edge.length;
+            }
+        }
+        return length;
+    }
+};
+
+/**
+ * This function collapses every corridor of the given maze into a single
+ * weighted edge between the cells at its ends.  Every open cell which
+ * doesn't have exactly two open neighbors, along with every point of
+ * interest, is kept as a node.
+ *
+ * @param[in] width
+ *     This is the width of the maze, in cells.
+ *
+ * @param[in] height
+ *     This is the height of the maze, in cells.
+ *
+ * @param[in] isOpen
+ *     This function indicates whether or not the cell with the given
+ *     coordinates can ever be moved through.
+ *
+ * @param[in] isPointOfInterest
+ *     This function indicates whether or not the cell with the given
+ *     coordinates must be kept as a node.
+ *
+ * @param[in] doorsAt
+ *     This function returns the doors at the cell with the given
+ *     coordinates, one bit per door.
+ *
+ * @return
+ *     The graph of the maze is returned.
+ */
+template<
+    typename OpenFunction,
+    typename PointOfInterestFunction,
+    typename DoorFunction
+> CorridorGraph ContractCorridors(
+    size_t width,
+    size_t height,
+    OpenFunction isOpen,
+    PointOfInterestFunction isPointOfInterest,
+    DoorFunction doorsAt
+) {
+    CorridorGraph graph;
+    graph.width = width;
+    graph.height = height;
+    graph.nodeAt.assign(width * height, -1);
+    std::vector< bool > open(width * height);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            open[y * width + x] = isOpen(x, y);
+        }
+    }
+
+    // This finds the cell next to the given one in one of the four
+    // directions, if that cell is open.
+    static const int dx[] = {-1, 1, 0, 0};
+    static const int dy[] = {0, 0, -1, 1};
+    const auto findExit = [&](size_t cell, int direction, size_t& next){
+        const auto x = (int)(cell % width) + dx[direction];
+        const auto y = (int)(cell / width) + dy[direction];
+        if (
+            (x < 0)
+            || (x >= (int)width)
+            || (y < 0)
+            || (y >= (int)height)
+        ) {
+            return false;
+        }
+        next = (size_t)y * width + (size_t)x;
+        return (bool)open[next];
+    };
+
+    // Keep every open cell which isn't part of a corridor as a node.
+    size_t next;
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        if (!open[cell]) {
+            continue;
+        }
+        int exits = 0;
+        for (int direction = 0; direction < 4; ++direction) {
+            if (findExit(cell, direction, next)) {
+                ++exits;
+            }
+        }
+        const auto x = cell % width;
+        const auto y = cell / width;
+        if (
+            (exits != 2)
+            || isPointOfInterest(x, y)
+        ) {
+            graph.nodeAt[cell] = (int)graph.nodes.size();
+            CorridorGraph::Node node;
+            node.x = x;
+            node.y = y;
+            graph.nodes.push_back(std::move(node));
+        }
+    }
+
+    // Follow each way out of every node along its corridor
+    // to the node at the other end.
+    for (size_t i = 0; i < graph.nodes.size(); ++i) {
+        auto& node = graph.nodes[i];
+        const auto start = node.y * width + node.x;
+        for (int direction = 0; direction < 4; ++direction) {
+            if (!findExit(start, direction, next)) {
+                continue;
+            }
+            auto previous = start;
+            auto cell = next;
+            int length = 1;
+            auto doors = doorsAt(cell % width, cell / width);
+            while (graph.nodeAt[cell] < 0) {
+                for (int turn = 0; turn < 4; ++turn) {
+                    if (
+                        findExit(cell, turn, next)
+                        && (next != previous)
+                    ) {
+                        break;
+                    }
+                }
+                previous = cell;
+                cell = next;
+                ++length;
+                doors |= doorsAt(cell % width, cell / width);
+            }
+            if (graph.nodeAt[cell] != (int)i) {
+                node.edges.emplace_back((size_t)graph.nodeAt[cell], length, doors);
+            }
+        }
+    }
+    return graph;
+}
+
+/**
+ * This holds how much a maze was shrunk by pruning it.
+ */
+struct PruneReport {
+    /**
+     * This is the number of open cells in the maze before pruning.
+     */
+    size_t openCells = 0;
+
+    /**
+     * This is the number of open cells which were walled off because
+     * they couldn't be reached.
+     */
+    size_t unreachableCells = 0;
+
+    /**
+     * This is the number of open cells which were filled in because
+     * they were at the end of a dead end holding nothing of interest.
+     */
+    size_t deadEndCells = 0;
+};
+
+/**
+ * This function shrinks the given maze, by walling off every open cell
+ * which can't be reached from an entrance, and then repeatedly filling
+ * in every dead end which holds nothing of interest, until none is left.
+ * Neither changes the shortest path between any two points of interest.
+ *
+ * @param[in,out] lines
+ *     These are the lines of the maze.  Pruned cells are replaced
+ *     with the given wall.
+ *
+ * @param[in] wall
+ *     This is the cell with which to replace pruned cells.
+ *
+ * @param[in] isOpen
+ *     This function indicates whether or not the given cell can ever
+ *     be moved through.
+ *
+ * @param[in] isEntrance
+ *     This function indicates whether or not the maze can be entered
+ *     at the cell with the given coordinates.
+ *
+ * @param[in] isPointOfInterest
+ *     This function indicates whether or not the cell with the given
+ *     coordinates must be kept open.
+ *
+ * @return
+ *     A report of how much the maze was shrunk is returned.
+ */
+template<
+    typename OpenFunction,
+    typename EntranceFunction,
+    typename PointOfInterestFunction
+> PruneReport PruneMaze(
+    std::vector< std::string >& lines,
+    char wall,
+    OpenFunction isOpen,
+    EntranceFunction isEntrance,
+    PointOfInterestFunction isPointOfInterest
+) {
+    PruneReport report;
+    const auto height = lines.size();
+    const auto width = lines[0].length();
+    static const int dx[] = {-1, 1, 0, 0};
+    static const int dy[] = {0, 0, -1, 1};
+    const auto findExit = [&](size_t cell, int direction, size_t& next){
+        const auto x = (int)(cell % width) + dx[direction];
+        const auto y = (int)(cell / width) + dy[direction];
+        if (
+            (x < 0)
+            || (x >= (int)width)
+            || (y < 0)
+            || (y >= (int)height)
+        ) {
+            return false;
+        }
+        next = (size_t)y * width + (size_t)x;
+        return isOpen(lines[(size_t)y][(size_t)x]);
+    };
+
+    // Spread out from the entrances to find the cells which can be
+    // reached, and wall off the rest.
+    std::vector< bool > reached(width * height);
+    std::vector< size_t > frontier;
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        const auto x = cell % width;
+        const auto y = cell / width;
+        if (!isOpen(lines[y][x])) {
+            continue;
+        }
+        ++report.openCells;
+        if (isEntrance(x, y)) {
+            reached[cell] = true;
+            frontier.push_back(cell);
+        }
+    }
+    size_t next;
+    while (!frontier.empty()) {
+        const auto cell = frontier.back();
+        frontier.pop_back();
+        for (int direction = 0; direction < 4; ++direction) {
+            if (
+                findExit(cell, direction, next)
+                && !reached[next]
+            ) {
+                reached[next] = true;
+                frontier.push_back(next);
+            }
+        }
+    }
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        auto& contents = lines[cell / width][cell % width];
+        if (
+            isOpen(contents)
+            && !reached[cell]
+        ) {
+            contents = wall;
+            ++report.unreachableCells;
+        }
+    }
+
+    // Fill in each dead end holding nothing of interest, and then look
+    // at the cell it led to, which may have become a dead end itself.
+    for (size_t cell = 0; cell < width * height; ++cell) {
+        if (isOpen(lines[cell / width][cell % width])) {
+            frontier.push_back(cell);
+        }
+    }
+    while (!frontier.empty()) {
+        const auto cell = frontier.back();
+        frontier.pop_back();
+        const auto x = cell % width;
+        const auto y = cell / width;
+        if (
+            !isOpen(lines[y][x])
+            || isPointOfInterest(x, y)
+        ) {
+            continue;
+        }
+        int exits = 0;
+        size_t onward = 0;
+        for (int direction = 0; direction < 4; ++direction) {
+            if (findExit(cell, direction, next)) {
+                ++exits;
+                onward = next;
+            }
+        }
+        if (exits <= 1) {
+            lines[y][x] = wall;
+            ++report.deadEndCells;
+            if (exits == 1) {
+                frontier.push_back(onward);
+            }
+        }
+    }
+    return report;
+}
+
+/**
+ * This function calls the given function once for each index from zero
+ * up to the given count, spreading the calls across as many threads as
+ * the system can run at once.
+ *
+ * @param[in] count
+ *     This is the number of times to call the function.
+ *
+ * @param[in] body
+ *     This is the function to call, with the index of the call.
+ */
+void ForEachInParallel(
+    size_t count,
+    const std::function< void(size_t) >& body
+) {
+    std::atomic< size_t > next(0);
+    const auto work = [&]{
+        for (;;) {
+            const auto i = next++;
+            if (i >= count) {
+                break;
+            }
+            body(i);
+        }
+    };
+    const auto threads = std::min(
+        (size_t)std::max(std::thread::hardware_concurrency(), 1U),
+        count
+    );
+    std::vector< std::thread > workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker: workers) {
+        worker.join();
+    }
+}
+
+/**
+ * This holds the length of the shortest path between every pair of
+ * points of interest of a corridor graph, along with the doors crossed
+ * along each path, so that searches which only move from one point of
+ * interest to another can look up how to get there, rather than
+ * searching the graph again every time.
+ */
+struct DistanceMatrix {
+    /**
+     * These are the nodes of the graph which are points of interest,
+     * in the order in which they're numbered in the matrix.
+     */
+    std::vector< size_t > points;
+
+    /**
+     * This holds the number of the point of interest at each node of
+     * the graph, or -1 if the node isn't a point of interest.
+     */
+    std::vector< int > pointAt;
+
+    /**
+     * These are the lengths of the shortest paths from each point of
+     * interest to every other, a row per point, with -1 where there's
+     * no path.
+     */
+    std::vector< int > lengths;
+
+    /**
+     * These are the doors crossed along the shortest paths from each
+     * point of interest to every other, a row per point, one bit
+     * per door.
+     */
+    std::vector< uint32_t > doors;
+
+    /**
+     * This returns the number of the point of interest at the given
+     * node of the graph, or -1 if the node isn't a point of interest.
+     */
+    int PointAt(size_t node) const {
+        return pointAt[node];
+    }
 
-    Position() {
-        (void)memset(m, 0, sizeof(m));
+    /**
+     * This returns the length of the shortest path from one point
+     * of interest to another, or -1 if there's no path.
+     */
+    int Length(
+        size_t from,
+        size_t to
+    ) const {
+        return lengths[from * points.size() + to];
     }
 
-    Position(std::initializer_list< int > list) {
-        size_t i = 0;
-        for (auto element: list) {
-            m[i++] = element;
-        }
+    /**
+     * This returns the doors crossed along the shortest path from one
+     * point of interest to another, one bit per door.
+     */
+    uint32_t Doors(
+        size_t from,
+        size_t to
+    ) const {
+        return doors[from * points.size() + to];
     }
+};
 
-    Position(const Position<N-1>& other) {
-        (void)memset(m, 0, sizeof(m));
-        for (size_t i = 0; i < N - 1; ++i) {
-            m[i] = other.m[i];
-        }
+/**
+ * This function finds the shortest paths between every pair of the given
+ * points of interest of the given graph, and the doors crossed along
+ * each, searching from each point of interest on a separate thread.
+ * Every door is considered open, so where a longer path would avoid
+ * a door, only the shorter one, through the door, is kept.
+ *
+ * @param[in] graph
+ *     This is the graph to search.
+ *
+ * @param[in] points
+ *     These are the nodes of the graph which are points of interest.
+ *
+ * @return
+ *     The distances between the points of interest are returned.
+ */
+DistanceMatrix MeasureDistances(
+    const CorridorGraph& graph,
+    const std::vector< size_t >& points
+) {
+    DistanceMatrix matrix;
+    const auto count = points.size();
+    matrix.points = points;
+    matrix.pointAt.assign(graph.nodes.size(), -1);
+    for (size_t i = 0; i < count; ++i) {
+        matrix.pointAt[points[i]] = (int)i;
     }
+    matrix.lengths.assign(count * count, -1);
+    matrix.doors.assign(count * count, 0);
+    ForEachInParallel(
+        count,
+        [&](size_t i){
+            // Search the whole graph from the point of interest,
+            // going through any door.
+            const auto start = points[i];
+            const auto places = PathFinding< size_t >::FindReachablePlaces(
+                start,
+                [&](size_t node, std::vector< size_t >& neighbors){
+                    for (const auto& edge: graph.nodes[node].edges) {
+                        neighbors.push_back(edge.to);
+                    }
+                },
+                [&](size_t from, size_t to){ return graph.Length(from, to, ~(uint32_t)0); }
+            );
+            std::vector< const PathFinding< size_t >::SearchStep* > stepAt(graph.nodes.size(), nullptr);
+            for (const auto& place: places) {
+                stepAt[place.position] = &place;
+            }
 
-    template< int M > Position<M> Reduce() const {
-        Position<M> reduction;
-        for (size_t i = 0; i < M; ++i) {
-            if (i >= N) {
-                break;
+            // Follow the path back from every other point of interest
+            // reached, picking up the doors of the edges along the way.
+            matrix.lengths[i * count + i] = 0;
+            for (size_t j = 0; j < count; ++j) {
+                auto node = points[j];
+                if (stepAt[node] == nullptr) {
+                    continue;
+                }
+                matrix.lengths[i * count + j] = stepAt[node]->cost;
+                uint32_t doors = 0;
+                while (node != start) {
+                    const auto& step = *stepAt[node];
+                    const auto previousCost = (
+                        (step.previous == start)
+                        ? 0
+                        : stepAt[step.previous]->cost
+                    );
+                    for (const auto& edge: graph.nodes[step.previous].edges) {
+                        if (
+                            (edge.to == node)
+                            && (edge.length == step.cost - previousCost)
+                        ) {
+                            doors |= edge.doors;
+                            break;
+                        }
+                    }
+                    node = step.previous;
+                }
+                matrix.doors[i * count + j] = doors;
             }
-            reduction.m[i] = m[i];
         }
-        return reduction;
-    }
+    );
+    return matrix;
+}
 
-    bool operator==(const Position& other) const {
-        for (size_t i = 0; i < N; ++i) {
-            if (m[i] != other.m[i]) {
-                return false;
+/**
+ * This function builds a graph whose nodes are just the points of
+ * interest of the given graph, with an edge from each to every other
+ * which can be reached, as long as the shortest path between them.
+ *
+ * @param[in] graph
+ *     This is the graph whose points of interest to connect.
+ *
+ * @param[in] matrix
+ *     These are the distances between the points of interest.
+ *
+ * @return
+ *     The graph of the points of interest is returned.
+ */
+CorridorGraph ConnectPoints(
+    const CorridorGraph& graph,
+    const DistanceMatrix& matrix
+) {
+    CorridorGraph points;
+    points.width = graph.width;
+    points.height = graph.height;
+    points.nodeAt.assign(graph.width * graph.height, -1);
+    for (size_t i = 0; i < matrix.points.size(); ++i) {
+        const auto& node = graph.nodes[matrix.points[i]];
+        points.nodeAt[node.y * graph.width + node.x] = (int)i;
+        CorridorGraph::Node point;
+        point.x = node.x;
+        point.y = node.y;
+        for (size_t j = 0; j < matrix.points.size(); ++j) {
+            const auto length = matrix.Length(i, j);
+            if (
+                (j != i)
+                && (length >= 0)
+            ) {
+                point.edges.emplace_back(j, length, matrix.Doors(i, j));
             }
         }
-        return true;
+        points.nodes.push_back(std::move(point));
     }
+    return points;
+}
 
-    bool operator!=(const Position& other) const {
-        return !(*this == other);
-    }
+/**
+ * This is a place in the recursive maze, given as a node of the graph
+ * of the maze, and the level of the maze the node is on.
+ */
+struct Place {
+    size_t node = 0;
+    int level = 0;
 
-    bool operator<(const Position& other) const {
-        for (size_t i = 0; i < N; ++i) {
-            if (m[i] < other.m[i]) {
-                return true;
-            } else if (m[i] > other.m[i]) {
-                return false;
-            }
-        }
-        return false;
+    Place() {
     }
 
-    Position& operator+=(const Position& other) {
-        for (size_t i = 0; i < N; ++i) {
-            m[i] += other.m[i];
-        }
-        return *this;
+    Place(size_t node, int level)
+        : node(node)
+        , level(level)
+    {
     }
 
-    Position& operator-=(const Position& other) {
-        for (size_t i = 0; i < N; ++i) {
-            m[i] -= other.m[i];
-        }
-        return *this;
+    bool operator==(const Place& other) const {
+        return (
+            (node == other.node)
+            && (level == other.level)
+        );
     }
 
-    Position operator+(const Position& other) const {
-        Position sum = *this;
-        return sum += other;
+    bool operator!=(const Place& other) const {
+        return !(*this == other);
     }
 
-    Position operator-(const Position& other) const {
-        Position sum = *this;
-        return sum -= other;
+    bool operator<(const Place& other) const {
+        if (level != other.level) {
+            return (level < other.level);
+        }
+        return (node < other.node);
     }
 };
 
-using PortalPositions = std::map<
-    Position<2>,
-    std::string
->;
-
-using Portals = std::map<
-    std::string,
-    std::pair< Position<2>, Position<2> >
->;
-
 struct Maze {
     // Properties
 
@@ -395,14 +1689,14 @@ struct Maze {
 
 };
 
-std::vector< Position<3> > Neighbors(
+void Neighbors(
     const Maze& maze,
     const Portals& portals,
     const PortalPositions& portalPositions,
     const Position<3>& position,
-    int& deepestNeighborZ
+    int& deepestNeighborZ,
+    std::vector< Position<3> >& neighbors
 ) {
-    std::vector< Position<3> > neighbors;
     static const std::vector< Position<2> > directions = {
         {-1,  0},
         { 1,  0},
@@ -441,7 +1735,284 @@ std::vector< Position<3> > Neighbors(
             deepestNeighborZ = std::max(deepestNeighborZ, otherSideOfPortal.m[2]);
         }
     }
-    return neighbors;
+}
+
+/**
+ * This function finds the places which can be reached in one move from
+ * the given place in the recursive maze, on the graph of the maze.
+ * Corridors stay on the same level, while portals lead one level in
+ * or out.
+ *
+ * @param[in] graph
+ *     This is the graph of the maze.
+ *
+ * @param[in] portals
+ *     These are the two ends of each portal, by label.
+ *
+ * @param[in] portalPositions
+ *     These are the labels of the portals, by position.
+ *
+ * @param[in] place
+ *     This is the place from which to move.
+ *
+ * @param[in,out] deepestNeighborZ
+ *     This is where to keep track of the deepest level considered.
+ *
+ * @param[in,out] neighbors
+ *     This is where to append the places which can be reached.
+ */
+void GraphNeighbors(
+    const CorridorGraph& graph,
+    const Portals& portals,
+    const PortalPositions& portalPositions,
+    const Place& place,
+    int& deepestNeighborZ,
+    std::vector< Place >& neighbors
+) {
+    const auto& node = graph.nodes[place.node];
+    for (const auto& edge: node.edges) {
+        neighbors.emplace_back(edge.to, place.level);
+    }
+    const Position<2> position{(int)node.x, (int)node.y};
+    const auto portalPositionsEntry = portalPositions.find(position);
+    if (portalPositionsEntry != portalPositions.end()) {
+        const auto& portal = portals.find(portalPositionsEntry->second)->second;
+        const auto goingOut = (position == portal.first);
+        const auto& otherSideOfPortal = (
+            goingOut
+            ? portal.second
+            : portal.first
+        );
+        const auto level = place.level + (goingOut ? -1 : 1);
+        if (level >= 0) {
+            neighbors.emplace_back(
+                (size_t)graph.NodeAt((size_t)otherSideOfPortal.m[0], (size_t)otherSideOfPortal.m[1]),
+                level
+            );
+            deepestNeighborZ = std::max(deepestNeighborZ, level);
+        }
+    }
+}
+
+/**
+ * This function finds the shortest path through the maze from the
+ * entrance to the exit, on the graph of the maze with its corridors
+ * collapsed.  The edges have different lengths, so a heap is always
+ * used for the steps yet to be taken.
+ *
+ * @param[in] graph
+ *     This is the graph of the maze.
+ *
+ * @param[in] portals
+ *     These are the two ends of each portal, by label.
+ *
+ * @param[in] portalPositions
+ *     These are the labels of the portals, by position.
+ *
+ * @param[in] startingPosition
+ *     This is the entrance of the maze.
+ *
+ * @param[in] endingPosition
+ *     This is the exit of the maze.
+ *
+ * @param[in,out] deepestNeighborZ
+ *     This is where to keep track of the deepest level considered.
+ *
+ * @param[out] reached
+ *     This is where to store the number of places reached
+ *     by the search.
+ *
+ * @param[out] stats
+ *     This is where to store the statistics kept by the search.
+ *
+ * @return
+ *     Information about the shortest path through the graph is returned.
+ */
+template< typename Stats > PathFinding< Place >::Path FindShortestPathOnGraph(
+    const CorridorGraph& graph,
+    const Portals& portals,
+    const PortalPositions& portalPositions,
+    const Position<2>& startingPosition,
+    const Position<2>& endingPosition,
+    int& deepestNeighborZ,
+    size_t& reached,
+    Stats& stats
+) {
+    PathFinding< Place >::MapWorkspace< PathFinding< Place >::HeapQueue, Stats > workspace;
+    const auto path = PathFinding< Place >::FindPath(
+        workspace,
+        Place((size_t)graph.NodeAt((size_t)startingPosition.m[0], (size_t)startingPosition.m[1]), 0),
+        Place((size_t)graph.NodeAt((size_t)endingPosition.m[0], (size_t)endingPosition.m[1]), 0),
+        [&](const Place& place, std::vector< Place >& neighbors){ GraphNeighbors(graph, portals, portalPositions, place, deepestNeighborZ, neighbors); },
+        [&](const Place& start, const Place& end){
+            if (start.level != end.level) {
+                return 1;
+            }
+            return graph.Length(start.node, end.node, 0);
+        },
+        [](const Place&, const Place&){ return 0; }
+    );
+    reached = workspace.reached.size();
+    stats = std::move(workspace.stats);
+    return path;
+}
+
+/**
+ * This function finds the shortest path through the maze from the
+ * entrance to the exit, using the given type of queue for the steps
+ * yet to be taken.
+ *
+ * @param[in] maze
+ *     This is the maze through which to find the path.
+ *
+ * @param[in] portals
+ *     These are the two ends of each portal, by label.
+ *
+ * @param[in] portalPositions
+ *     These are the labels of the portals, by position.
+ *
+ * @param[in] startingPosition
+ *     This is the entrance of the maze.
+ *
+ * @param[in] endingPosition
+ *     This is the exit of the maze.
+ *
+ * @param[in,out] deepestNeighborZ
+ *     This is where to keep track of the deepest level considered.
+ *
+ * @param[out] reached
+ *     This is where to store the number of positions reached
+ *     by the search.
+ *
+ * @param[out] stats
+ *     This is where to store the statistics kept by the search.
+ *
+ * @return
+ *     Information about the shortest path through the maze is returned.
+ */
+template<
+    typename Queue,
+    typename Stats
+> PathFinding< Position<3> >::Path FindShortestPath(
+    const Maze& maze,
+    const Portals& portals,
+    const PortalPositions& portalPositions,
+    const Position<3>& startingPosition,
+    const Position<3>& endingPosition,
+    int& deepestNeighborZ,
+    size_t& reached,
+    Stats& stats
+) {
+    PathFinding< Position<3> >::MapWorkspace< Queue, Stats > workspace;
+    const auto path = PathFinding< Position<3> >::FindPath(
+        workspace,
+
+        // Desired start and end points of the path
+        startingPosition, endingPosition,
+
+        // Function to determine the neighbors of any position
+        [&](const Position<3>& position, std::vector< Position<3> >& neighbors){ Neighbors(maze, portals, portalPositions, position, deepestNeighborZ, neighbors); },
+
+        // Cost function (easy since the neighbors function takes
+        // care of walls for us).
+        [](const Position<3>&, const Position<3>&){ return 1; },
+
+        // Heuristic function, which A* uses to optimize the search.
+        // I didn't bother making one.  I usually use manhattan distance,
+        // however in this puzzle, is inadmissible.
+        //
+        // [11:14] igroc: https://en.wikipedia.org/wiki/Admissible_heuristic
+        //
+        // So just devolve to Breadth First Search (Dijkstra's Algorithm
+        // considers different costs, but our cost is a constant).
+        [](const Position<3>&, const Position<3>&){ return 0; }
+    );
+    reached = workspace.reached.size();
+    stats = std::move(workspace.stats);
+    return path;
+}
+
+/**
+ * This function finds the shortest path through the maze from the
+ * entrance to the exit, using the type of queue with the given name
+ * for the steps yet to be taken.
+ *
+ * @param[in] queue
+ *     This is the name of the type of queue to use.
+ *
+ * @param[in] maze
+ *     This is the maze through which to find the path.
+ *
+ * @param[in] portals
+ *     These are the two ends of each portal, by label.
+ *
+ * @param[in] portalPositions
+ *     These are the labels of the portals, by position.
+ *
+ * @param[in] startingPosition
+ *     This is the entrance of the maze.
+ *
+ * @param[in] endingPosition
+ *     This is the exit of the maze.
+ *
+ * @param[in,out] deepestNeighborZ
+ *     This is where to keep track of the deepest level considered.
+ *
+ * @param[out] reached
+ *     This is where to store the number of positions reached
+ *     by the search.
+ *
+ * @param[out] stats
+ *     This is where to store the statistics kept by the search.
+ *
+ * @param[out] path
+ *     This is where to store information about the shortest path
+ *     through the maze.
+ *
+ * @return
+ *     An indication of whether or not the type of queue is known
+ *     is returned.
+ */
+template< typename Stats > bool FindShortestPathWithQueue(
+    const std::string& queue,
+    const Maze& maze,
+    const Portals& portals,
+    const PortalPositions& portalPositions,
+    const Position<3>& startingPosition,
+    const Position<3>& endingPosition,
+    int& deepestNeighborZ,
+    size_t& reached,
+    Stats& stats,
+    PathFinding< Position<3> >::Path& path
+) {
+    if (queue == "heap") {
+        path = FindShortestPath< PathFinding< Position<3> >::HeapQueue >(
+            maze, portals, portalPositions,
+            startingPosition, endingPosition,
+            deepestNeighborZ, reached, stats
+        );
+    } else if (queue == "fifo") {
+        path = FindShortestPath< PathFinding< Position<3> >::FifoQueue >(
+            maze, portals, portalPositions,
+            startingPosition, endingPosition,
+            deepestNeighborZ, reached, stats
+        );
+    } else if (queue == "bucket") {
+        path = FindShortestPath< PathFinding< Position<3> >::BucketQueue >(
+            maze, portals, portalPositions,
+            startingPosition, endingPosition,
+            deepestNeighborZ, reached, stats
+        );
+    } else if (queue == "radix") {
+        path = FindShortestPath< PathFinding< Position<3> >::RadixQueue >(
+            maze, portals, portalPositions,
+            startingPosition, endingPosition,
+            deepestNeighborZ, reached, stats
+        );
+    } else {
+        return false;
+    }
+    return true;
 }
 
 /**
@@ -459,6 +2030,30 @@ int main(int argc, char* argv[]) {
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif /* _WIN32 */
     (void)setbuf(stdout, NULL);
+    std::string queue = "fifo";
+    bool onGraph = true;
+    bool onCorridors = false;
+    bool showStats = false;
+    std::string traceFile;
+    for (int i = 1; i < argc; ++i) {
+        if (
+            (strcmp(argv[i], "--queue") == 0)
+            && (i + 1 < argc)
+        ) {
+            queue = argv[++i];
+        } else if (strcmp(argv[i], "--grid") == 0) {
+            onGraph = false;
+        } else if (strcmp(argv[i], "--corridors") == 0) {
+            onCorridors = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            showStats = true;
+        } else if (
+            (strcmp(argv[i], "--trace") == 0)
+            && (i + 1 < argc)
+        ) {
+            traceFile = argv[++i];
+        }
+    }
 
     // Open the input file and read in the map.
     std::ifstream input("input.txt");
@@ -536,42 +2131,167 @@ int main(int argc, char* argv[]) {
         );
     }
 
-    // Use the A* path-finding algorithm to find the shortest path
-    // from the entrance to the exit.
-    const auto startTime = std::chrono::steady_clock::now();
-    int deepestNeighborZ = 0;
-    const auto path = PathFinding< Position<3> >::FindPath(
-        // Desired start and end points of the path
-        startingPosition, endingPosition,
-
-        // Function to determine the neighbors of any position
-        [&](const Position<3>& position){ return Neighbors(maze, portals, portalPositions, position, deepestNeighborZ); },
+    // Fill in the dead ends of the maze which hold no portals, and wall
+    // off any part of the maze which can't be reached through either the
+    // entrance or a portal.
+    const auto isPointOfInterest = [&](size_t x, size_t y){
+        const Position<2> position{(int)x, (int)y};
+        return (
+            (position == startingPosition)
+            || (position == endingPosition)
+            || (portalPositions.find(position) != portalPositions.end())
+        );
+    };
+    const auto report = PruneMaze(
+        maze.lines,
+        '#',
+        [](char cell){ return (cell == '.'); },
+        isPointOfInterest,
+        isPointOfInterest
+    );
+    printf(
+        "Pruned %zu unreachable and %zu dead-end cells, leaving %zu of %zu open cells.\n",
+        report.unreachableCells,
+        report.deadEndCells,
+        report.openCells - report.unreachableCells - report.deadEndCells,
+        report.openCells
+    );
 
-        // Cost function (easy since the neighbors function takes
-        // care of walls for us).
-        [](const Position<3>& start, const Position<3>& end){ return 1; },
+    // Collapse the corridors of the maze, keeping the entrance, the exit,
+    // and both ends of every portal as nodes.
+    const auto corridors = ContractCorridors(
+        maze.width,
+        maze.height,
+        [&](size_t x, size_t y){ return (maze.lines[y][x] == '.'); },
+        isPointOfInterest,
+        [](size_t, size_t){ return (uint32_t)0; }
+    );
+    printf(
+        "Contracted the maze into %zu nodes and %zu edges.\n",
+        corridors.nodes.size(),
+        corridors.EdgeCount()
+    );
 
-        // Heuristic function, which A* uses to optimize the search.
-        // I didn't bother making one.  I usually use manhattan distance,
-        // however in this puzzle, is inadmissible.
-        //
-        // [11:14] igroc: https://en.wikipedia.org/wiki/Admissible_heuristic
-        //
-        // So just devolve to Breadth First Search (Dijkstra's Algorithm
-        // considers different costs, but our cost is a constant).
-        [](const Position<3>& start, const Position<3>& end){ return 0; }
+    // Measure the distances between the entrance, the exit, and the
+    // ends of the portals once, and unless asked to search the corridors
+    // instead, connect them directly, so that every level of the maze
+    // shares the same distances.
+    const auto measureStartTime = std::chrono::steady_clock::now();
+    std::vector< size_t > points;
+    for (size_t i = 0; i < corridors.nodes.size(); ++i) {
+        if (isPointOfInterest(corridors.nodes[i].x, corridors.nodes[i].y)) {
+            points.push_back(i);
+        }
+    }
+    const auto matrix = MeasureDistances(corridors, points);
+    const auto measureEndTime = std::chrono::steady_clock::now();
+    printf(
+        "Measured the distances between %zu points of interest in %lf seconds.\n",
+        points.size(),
+        std::chrono::duration< double >(measureEndTime - measureStartTime).count()
     );
-    const auto endTime = std::chrono::steady_clock::now();
-    printf("The shortest path through the maze is %d steps.\n", path.cost);
+    const auto graph = (
+        onCorridors
+        ? corridors
+        : ConnectPoints(corridors, matrix)
+    );
+
+    // Use the A* path-finding algorithm to find the shortest path
+    // from the entrance to the exit, either on the graph, or on the map
+    // itself.  Every move on the map costs the same, so by default,
+    // a simple first-in, first-out queue is used for the steps yet to be
+    // taken, but any other kind can be chosen, to compare them.  If asked
+    // for, the positions the search expands are traced, in order.
+    int deepestNeighborZ = 0;
+    int cost = 0;
     int maxZ = 0;
-    for (const auto& step: path.steps) {
-        maxZ = std::max(maxZ, step.m[2]);
+    size_t reached = 0;
+    SearchStats stats;
+    SearchTrace< Place > graphTrace;
+    SearchTrace< Position<3> > gridTrace;
+    if (onGraph) {
+        const auto path = (
+            traceFile.empty()
+            ? FindShortestPathOnGraph(
+                graph, portals, portalPositions,
+                startingPosition, endingPosition,
+                deepestNeighborZ, reached, stats
+            )
+            : FindShortestPathOnGraph(
+                graph, portals, portalPositions,
+                startingPosition, endingPosition,
+                deepestNeighborZ, reached, graphTrace
+            )
+        );
+        cost = path.cost;
+        for (const auto& step: path.steps) {
+            maxZ = std::max(maxZ, step.level);
+        }
+    } else {
+        PathFinding< Position<3> >::Path path;
+        const auto knownQueue = (
+            traceFile.empty()
+            ? FindShortestPathWithQueue(
+                queue, maze, portals, portalPositions,
+                startingPosition, endingPosition,
+                deepestNeighborZ, reached, stats, path
+            )
+            : FindShortestPathWithQueue(
+                queue, maze, portals, portalPositions,
+                startingPosition, endingPosition,
+                deepestNeighborZ, reached, gridTrace, path
+            )
+        );
+        if (!knownQueue) {
+            (void)fprintf(stderr, "Unknown queue '%s'\n", queue.c_str());
+            return EXIT_FAILURE;
+        }
+        cost = path.cost;
+        for (const auto& step: path.steps) {
+            maxZ = std::max(maxZ, step.m[2]);
+        }
+    }
+    if (!traceFile.empty()) {
+        const auto trace = fopen(traceFile.c_str(), "w");
+        if (trace == NULL) {
+            (void)fprintf(stderr, "Unable to open '%s'\n", traceFile.c_str());
+            return EXIT_FAILURE;
+        }
+        if (onGraph) {
+            stats = graphTrace;
+            for (const auto& place: graphTrace.expanded) {
+                const auto& node = graph.nodes[place.node];
+                (void)fprintf(trace, "%zu,%zu,%d\n", node.x, node.y, place.level);
+            }
+        } else {
+            stats = gridTrace;
+            for (const auto& position: gridTrace.expanded) {
+                (void)fprintf(trace, "%d,%d,%d\n", position.m[0], position.m[1], position.m[2]);
+            }
+        }
+        (void)fclose(trace);
     }
+    printf("The shortest path through the maze is %d steps.\n", cost);
+    printf("The search reached %zu positions.\n", reached);
     printf("The deepest we went was %d steps down.\n", maxZ);
     printf("The deepest neighbor we considered was %d steps down.\n", deepestNeighborZ);
-    printf(
-        "It took %lf seconds to determine this.\n",
-        std::chrono::duration< double >(endTime - startTime).count()
-    );
+    printf("It took %lf seconds to determine this.\n", stats.elapsed);
+    if (showStats) {
+        printf(
+            (
+                "Steps pushed: %zu\n"
+                "Steps popped: %zu (%zu stale)\n"
+                "Peak frontier: %zu\n"
+                "Relaxations: %zu\n"
+                "Heuristic calls: %zu\n"
+            ),
+            stats.pushed,
+            stats.popped,
+            stats.stale,
+            stats.peakFrontier,
+            stats.relaxations,
+            stats.heuristicCalls
+        );
+    }
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,676 @@
+#ifndef INTCODE_ASSEMBLER_HPP
+#define INTCODE_ASSEMBLER_HPP
+
+/**
+ * @file Assembler.hpp
+ *
+ * This module declares the functions used to decode Intcode
+ * instructions, and to translate Intcode programs to and from
+ * a textual assembly language.
+ *
+ * The assembly language has one statement per line.  Anything after
+ * a semicolon is a comment.  A statement may be preceded by a label,
+ * which is a name followed by a colon.  Statements are either
+ * instructions or ".data" directives.  Instructions consist of
+ * a mnemonic (add, mul, in, out, jnz, jz, lt, eq, arb, hlt) followed
+ * by comma-separated operands, written as follows:
+ *
+ * - 123 or name -- immediate mode
+ * - [123] or [name] -- position mode
+ * - [rb+123] or [rb-123] -- relative mode
+ *
+ * A ".data" directive is followed by comma-separated numbers or labels,
+ * which are placed into the program as-is.  Wherever a label may be
+ * used, it may be followed by +123 or -123 to refer to a cell near the
+ * label, such as an operand of the instruction at the label.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <map>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/**
+ * This holds static information about one kind of Intcode instruction.
+ */
+struct Operation {
+    /**
+     * This is the name used for the instruction in assembly language.
+     */
+    const char* mnemonic;
+
+    /**
+     * This is the opcode of the instruction.
+     */
+    intmax_t opcode;
+
+    /**
+     * This is the number of parameters the instruction takes.
+     */
+    size_t parameters;
+
+    /**
+     * This is the index of the parameter to which the instruction
+     * writes its result, or -1 if it doesn't write to memory.
+     */
+    int destination;
+
+    /**
+     * This indicates whether or not the instruction is a conditional jump.
+     */
+    bool jump;
+};
+
+/**
+ * These are all the kinds of Intcode instructions.
+ */
+static const Operation OPERATIONS[] = {
+    {"add", 1, 3, 2, false},
+    {"mul", 2, 3, 2, false},
+    {"in", 3, 1, 0, false},
+    {"out", 4, 1, -1, false},
+    {"jnz", 5, 2, -1, true},
+    {"jz", 6, 2, -1, true},
+    {"lt", 7, 3, 2, false},
+    {"eq", 8, 3, 2, false},
+    {"arb", 9, 1, -1, false},
+    {"hlt", 99, 0, -1, false},
+};
+
+/**
+ * This function looks up the kind of Intcode instruction
+ * having the given opcode.
+ *
+ * @param[in] opcode
+ *     This is the opcode of the instruction to look up.
+ *
+ * @return
+ *     The kind of instruction having the given opcode is returned.
+ *
+ * @retval nullptr
+ *     This is returned if there is no instruction having the given opcode.
+ */
+inline const Operation* FindOperation(intmax_t opcode) {
+    for (const auto& operation: OPERATIONS) {
+        if (operation.opcode == opcode) {
+            return &operation;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * This holds one instruction decoded from an Intcode program.
+ */
+struct Instruction {
+    /**
+     * This is the position of the instruction in the program.
+     */
+    size_t pos = 0;
+
+    /**
+     * This is the kind of instruction decoded.
+     */
+    const Operation* operation = nullptr;
+
+    /**
+     * These are the modes of the parameters of the instruction.
+     */
+    int modes[3] = {0, 0, 0};
+
+    /**
+     * These are the operands of the parameters of the instruction.
+     */
+    intmax_t operands[3] = {0, 0, 0};
+
+    /**
+     * This indicates whether or not the instruction word is in its
+     * canonical form, with no digits other than the opcode and
+     * the modes of the parameters of the instruction.
+     */
+    bool canonical = false;
+
+    /**
+     * This returns the number of cells taken up by the instruction.
+     *
+     * @return
+     *     The number of cells taken up by the instruction is returned.
+     */
+    size_t Length() const {
+        return 1 + operation->parameters;
+    }
+};
+
+/**
+ * This function decodes the instruction at the given position
+ * in the given Intcode program, the same way the machines would.
+ *
+ * @param[in] numbers
+ *     This is the program from which to decode the instruction.
+ *
+ * @param[in] pos
+ *     This is the position of the instruction to decode.
+ *
+ * @param[out] instruction
+ *     This is where to store the decoded instruction.
+ *
+ * @return
+ *     An indication of whether or not a machine could execute
+ *     the instruction at the given position is returned.
+ */
+inline bool DecodeInstruction(
+    const std::vector< intmax_t >& numbers,
+    size_t pos,
+    Instruction& instruction
+) {
+    if (pos >= numbers.size()) {
+        return false;
+    }
+    const auto word = numbers[pos];
+    const auto operation = FindOperation(word % 100);
+    if (operation == nullptr) {
+        return false;
+    }
+    if (pos + operation->parameters >= numbers.size()) {
+        return false;
+    }
+    instruction.pos = pos;
+    instruction.operation = operation;
+    intmax_t modeDigits = word / 100;
+    for (size_t i = 0; i < operation->parameters; ++i) {
+        const auto mode = (int)(modeDigits % 10);
+        modeDigits /= 10;
+        if (
+            (mode > 2)
+            || (
+                (mode == 1)
+                && ((int)i == operation->destination)
+            )
+        ) {
+            return false;
+        }
+        instruction.modes[i] = mode;
+        instruction.operands[i] = numbers[pos + 1 + i];
+    }
+    instruction.canonical = (
+        (word >= 0)
+        && (modeDigits == 0)
+    );
+    return true;
+}
+
+/**
+ * This function formats one operand of an instruction
+ * in assembly language.
+ *
+ * @param[in] mode
+ *     This is the mode of the parameter.
+ *
+ * @param[in] value
+ *     This is the operand of the parameter.
+ *
+ * @param[in] labels
+ *     These are the labels, by address, which may be used
+ *     in place of immediate values.
+ *
+ * @return
+ *     The formatted operand is returned.
+ */
+inline std::string FormatOperand(
+    int mode,
+    intmax_t value,
+    const std::set< size_t >& labels
+) {
+    char buffer[48];
+    switch (mode) {
+        case 0: {
+            (void)snprintf(buffer, sizeof(buffer), "[%" PRIdMAX "]", value);
+        } break;
+
+        case 2: {
+            if (value == 0) {
+                (void)snprintf(buffer, sizeof(buffer), "[rb]");
+            } else {
+                (void)snprintf(buffer, sizeof(buffer), "[rb%+" PRIdMAX "]", value);
+            }
+        } break;
+
+        default: {
+            if (
+                (value >= 0)
+                && (labels.find((size_t)value) != labels.end())
+            ) {
+                (void)snprintf(buffer, sizeof(buffer), "L%" PRIdMAX, value);
+            } else {
+                (void)snprintf(buffer, sizeof(buffer), "%" PRIdMAX, value);
+            }
+        } break;
+    }
+    return buffer;
+}
+
+/**
+ * This function finds the instructions reachable from the start
+ * of the given Intcode program, following the targets of jumps
+ * which use immediate operands.  Any immediate operand which names
+ * a position in the program is also considered a possible target of
+ * any jump which doesn't use an immediate operand.
+ *
+ * @param[in] numbers
+ *     This is the program in which to find instructions.
+ *
+ * @param[out] jumpTargets
+ *     This is where to store the positions of all instructions
+ *     which are the targets of jumps.
+ *
+ * @return
+ *     The instructions found are returned, by position.
+ */
+inline std::map< size_t, Instruction > FindInstructions(
+    const std::vector< intmax_t >& numbers,
+    std::set< size_t >& jumpTargets
+) {
+    std::map< size_t, Instruction > instructions;
+    std::vector< size_t > unvisited;
+    std::set< size_t > candidates;
+    bool indirect = false;
+    unvisited.push_back(0);
+    for (;;) {
+        while (!unvisited.empty()) {
+            const auto pos = unvisited.back();
+            unvisited.pop_back();
+            if (instructions.find(pos) != instructions.end()) {
+                continue;
+            }
+            Instruction instruction;
+            if (!DecodeInstruction(numbers, pos, instruction)) {
+                continue;
+            }
+            instructions[pos] = instruction;
+            const auto operation = instruction.operation;
+            for (size_t i = 0; i < operation->parameters; ++i) {
+                if (
+                    (instruction.modes[i] == 1)
+                    && (instruction.operands[i] >= 0)
+                    && ((size_t)instruction.operands[i] < numbers.size())
+                ) {
+                    (void)candidates.insert((size_t)instruction.operands[i]);
+                }
+            }
+            if (operation->opcode == 99) {
+                continue;
+            }
+            if (operation->jump) {
+                if (instruction.modes[1] == 1) {
+                    const auto target = (size_t)instruction.operands[1];
+                    (void)jumpTargets.insert(target);
+                    unvisited.push_back(target);
+                } else {
+                    indirect = true;
+                }
+            }
+            unvisited.push_back(pos + instruction.Length());
+        }
+        if (!indirect) {
+            break;
+        }
+        for (auto candidate: candidates) {
+            if (instructions.find(candidate) == instructions.end()) {
+                Instruction instruction;
+                if (DecodeInstruction(numbers, candidate, instruction)) {
+                    unvisited.push_back(candidate);
+                }
+            }
+        }
+        if (unvisited.empty()) {
+            break;
+        }
+    }
+    for (auto it = jumpTargets.begin(); it != jumpTargets.end(); ) {
+        if (instructions.find(*it) == instructions.end()) {
+            it = jumpTargets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return instructions;
+}
+
+/**
+ * This function translates the given Intcode program into
+ * assembly language.  Assembling the result produces exactly
+ * the same program.
+ *
+ * @param[in] numbers
+ *     This is the program to disassemble.
+ *
+ * @return
+ *     The assembly language listing of the program is returned.
+ */
+inline std::string Disassemble(const std::vector< intmax_t >& numbers) {
+    std::set< size_t > jumpTargets;
+    const auto instructions = FindInstructions(numbers, jumpTargets);
+
+    // Lay out the listing, taking instructions in order and treating
+    // any cells not covered by instructions as data.  Instructions
+    // which overlap one taken earlier are dropped, along with any
+    // label that would end up inside another instruction.
+    std::vector< const Instruction* > layout(numbers.size());
+    std::set< size_t > labels;
+    size_t next = 0;
+    for (const auto& entry: instructions) {
+        const auto& instruction = entry.second;
+        if (
+            (instruction.pos < next)
+            || !instruction.canonical
+        ) {
+            continue;
+        }
+        layout[instruction.pos] = &instruction;
+        next = instruction.pos + instruction.Length();
+    }
+    for (auto target: jumpTargets) {
+        if (layout[target] != nullptr) {
+            (void)labels.insert(target);
+        }
+    }
+
+    // Generate the listing.
+    std::string listing;
+    char buffer[64];
+    size_t pos = 0;
+    while (pos < numbers.size()) {
+        if (labels.find(pos) != labels.end()) {
+            (void)snprintf(buffer, sizeof(buffer), "L%zu:\n", pos);
+            listing += buffer;
+        }
+        std::string statement = "    ";
+        const auto start = pos;
+        const auto instruction = layout[pos];
+        if (instruction == nullptr) {
+            statement += ".data ";
+            do {
+                if (pos > start) {
+                    statement += ", ";
+                }
+                (void)snprintf(buffer, sizeof(buffer), "%" PRIdMAX, numbers[pos]);
+                statement += buffer;
+                ++pos;
+            } while (
+                (pos < numbers.size())
+                && (pos - start < 8)
+                && (layout[pos] == nullptr)
+                && (labels.find(pos) == labels.end())
+            );
+        } else {
+            const auto operation = instruction->operation;
+            statement += operation->mnemonic;
+            for (size_t i = 0; i < operation->parameters; ++i) {
+                statement += ((i == 0) ? " " : ", ");
+                statement += FormatOperand(
+                    instruction->modes[i],
+                    instruction->operands[i],
+                    (operation->jump && (i == 1)) ? labels : std::set< size_t >()
+                );
+            }
+            pos += instruction->Length();
+        }
+        while (statement.length() < 40) {
+            statement += ' ';
+        }
+        (void)snprintf(buffer, sizeof(buffer), " ; %zu\n", start);
+        listing += statement;
+        listing += buffer;
+    }
+    return listing;
+}
+
+/**
+ * This function removes whitespace from both ends of the given string.
+ *
+ * @param[in] s
+ *     This is the string to trim.
+ *
+ * @return
+ *     The trimmed string is returned.
+ */
+inline std::string Trim(const std::string& s) {
+    size_t begin = 0;
+    while (
+        (begin < s.length())
+        && isspace((unsigned char)s[begin])
+    ) {
+        ++begin;
+    }
+    size_t end = s.length();
+    while (
+        (end > begin)
+        && isspace((unsigned char)s[end - 1])
+    ) {
+        --end;
+    }
+    return s.substr(begin, end - begin);
+}
+
+/**
+ * This function splits the given string into comma-separated
+ * pieces, trimming whitespace from each piece.
+ *
+ * @param[in] s
+ *     This is the string to split.
+ *
+ * @return
+ *     The pieces of the string are returned.
+ */
+inline std::vector< std::string > SplitOperands(const std::string& s) {
+    std::vector< std::string > pieces;
+    if (Trim(s).empty()) {
+        return pieces;
+    }
+    size_t pos = 0;
+    for (;;) {
+        const auto delimiter = s.find(',', pos);
+        if (delimiter == std::string::npos) {
+            pieces.push_back(Trim(s.substr(pos)));
+            break;
+        }
+        pieces.push_back(Trim(s.substr(pos, delimiter - pos)));
+        pos = delimiter + 1;
+    }
+    return pieces;
+}
+
+/**
+ * This function translates the given assembly language listing
+ * into an Intcode program.  Any errors in the listing are reported
+ * on the standard error stream, and cause the program to exit.
+ *
+ * @param[in] listing
+ *     This is the assembly language listing to assemble.
+ *
+ * @return
+ *     The assembled Intcode program is returned.
+ */
+inline std::vector< intmax_t > Assemble(const std::string& listing) {
+    struct Statement {
+        size_t line = 0;
+        const Operation* operation = nullptr;
+        std::vector< std::string > operands;
+    };
+    std::vector< Statement > statements;
+    std::map< std::string, size_t > labels;
+    size_t address = 0;
+    size_t lineNumber = 0;
+    size_t lineStart = 0;
+    const auto fail = [&lineNumber](const std::string& message){
+        (void)fprintf(stderr, "line %zu: %s\n", lineNumber, message.c_str());
+        exit(1);
+    };
+
+    // First pass: split statements and assign addresses to labels.
+    while (lineStart < listing.length()) {
+        ++lineNumber;
+        auto lineEnd = listing.find('\n', lineStart);
+        if (lineEnd == std::string::npos) {
+            lineEnd = listing.length();
+        }
+        auto line = listing.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        const auto comment = line.find(';');
+        if (comment != std::string::npos) {
+            line = line.substr(0, comment);
+        }
+        line = Trim(line);
+        const auto colon = line.find(':');
+        if (colon != std::string::npos) {
+            const auto label = Trim(line.substr(0, colon));
+            if (
+                label.empty()
+                || !(isalpha((unsigned char)label[0]) || (label[0] == '_'))
+            ) {
+                fail("invalid label '" + label + "'");
+            }
+            if (labels.find(label) != labels.end()) {
+                fail("duplicate label '" + label + "'");
+            }
+            labels[label] = address;
+            line = Trim(line.substr(colon + 1));
+        }
+        if (line.empty()) {
+            continue;
+        }
+        Statement statement;
+        statement.line = lineNumber;
+        size_t mnemonicEnd = 0;
+        while (
+            (mnemonicEnd < line.length())
+            && !isspace((unsigned char)line[mnemonicEnd])
+        ) {
+            ++mnemonicEnd;
+        }
+        const auto mnemonic = line.substr(0, mnemonicEnd);
+        statement.operands = SplitOperands(line.substr(mnemonicEnd));
+        if (mnemonic == ".data") {
+            address += statement.operands.size();
+        } else {
+            for (const auto& operation: OPERATIONS) {
+                if (mnemonic == operation.mnemonic) {
+                    statement.operation = &operation;
+                    break;
+                }
+            }
+            if (statement.operation == nullptr) {
+                fail("unknown mnemonic '" + mnemonic + "'");
+            }
+            if (statement.operands.size() != statement.operation->parameters) {
+                fail("wrong number of operands for '" + mnemonic + "'");
+            }
+            address += 1 + statement.operation->parameters;
+        }
+        statements.push_back(statement);
+    }
+
+    // Second pass: encode statements.
+    const auto resolve = [&labels, &fail](const std::string& text) -> intmax_t {
+        if (text.empty()) {
+            fail("missing operand");
+        }
+        const auto label = labels.find(text);
+        if (label != labels.end()) {
+            return (intmax_t)label->second;
+        }
+        const auto sign = text.find_last_of("+-");
+        if (
+            (sign != std::string::npos)
+            && (sign > 0)
+        ) {
+            const auto base = labels.find(Trim(text.substr(0, sign)));
+            intmax_t offset;
+            char extra;
+            if (
+                (base != labels.end())
+                && (sscanf(text.c_str() + sign + 1, "%" SCNdMAX "%c", &offset, &extra) == 1)
+            ) {
+                return (
+                    (text[sign] == '+')
+                    ? (intmax_t)base->second + offset
+                    : (intmax_t)base->second - offset
+                );
+            }
+        }
+        intmax_t value;
+        char extra;
+        if (sscanf(text.c_str(), "%" SCNdMAX "%c", &value, &extra) != 1) {
+            fail("invalid value '" + text + "'");
+        }
+        return value;
+    };
+    std::vector< intmax_t > numbers;
+    numbers.reserve(address);
+    for (const auto& statement: statements) {
+        lineNumber = statement.line;
+        if (statement.operation == nullptr) {
+            for (const auto& operand: statement.operands) {
+                numbers.push_back(resolve(operand));
+            }
+            continue;
+        }
+        const auto operation = statement.operation;
+        intmax_t word = operation->opcode;
+        intmax_t modeScale = 100;
+        std::vector< intmax_t > operands;
+        for (size_t i = 0; i < operation->parameters; ++i) {
+            const auto& operand = statement.operands[i];
+            int mode = 1;
+            intmax_t value = 0;
+            if (
+                (operand.length() >= 2)
+                && (operand.front() == '[')
+                && (operand.back() == ']')
+            ) {
+                const auto inner = Trim(operand.substr(1, operand.length() - 2));
+                if (inner.substr(0, 2) == "rb") {
+                    mode = 2;
+                    const auto offset = Trim(inner.substr(2));
+                    if (!offset.empty()) {
+                        if (
+                            (offset[0] != '+')
+                            && (offset[0] != '-')
+                        ) {
+                            fail("invalid relative operand '" + operand + "'");
+                        }
+                        value = resolve(Trim(offset.substr(1)));
+                        if (offset[0] == '-') {
+                            value = -value;
+                        }
+                    }
+                } else {
+                    mode = 0;
+                    value = resolve(inner);
+                }
+            } else {
+                value = resolve(operand);
+            }
+            if (
+                (mode == 1)
+                && ((int)i == operation->destination)
+            ) {
+                fail("destination operand may not be immediate");
+            }
+            word += mode * modeScale;
+            modeScale *= 10;
+            operands.push_back(value);
+        }
+        numbers.push_back(word);
+        numbers.insert(numbers.end(), operands.begin(), operands.end());
+    }
+    return numbers;
+}
+
+#endif /* INTCODE_ASSEMBLER_HPP */
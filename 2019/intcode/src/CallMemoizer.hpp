@@ -0,0 +1,841 @@
+#ifndef INTCODE_CALL_MEMOIZER_HPP
+#define INTCODE_CALL_MEMOIZER_HPP
+
+/**
+ * @file CallMemoizer.hpp
+ *
+ * This module declares the CallMemoizer structure, which remembers the
+ * effects of calls to Intcode functions so that later calls with the
+ * same arguments can be replayed instead of executed.
+ *
+ * Intcode programs compiled for the puzzles use the relative base as a
+ * stack pointer.  A caller stores the return address at [rb] and the
+ * arguments at [rb+1], [rb+2], and so on, and then jumps to the
+ * function.  The function moves the relative base up past its frame,
+ * does its work, moves the relative base back down, and returns by
+ * jumping to the address at [rb].
+ *
+ * A call is recognized when a jump is taken while [rb] holds the address
+ * of the instruction after the jump, and it ends when a jump lands on
+ * that address with the relative base back where it started.  While a
+ * call is in progress, every cell it reads and writes is logged.  When it
+ * returns, the call is remembered if it did no input or output, only
+ * used relative mode for cells at or above its frame, and only used
+ * position mode for cells below its frame.  The cells it read before
+ * writing are its arguments, and the cells it wrote are its results.
+ *
+ * A later call to the same function whose arguments have the same values
+ * is then replayed by storing the results and skipping to the return
+ * address.  Since the function only depends on its arguments and its
+ * code, this is exactly what the machine would have done.  Writing to
+ * the code of any remembered function forgets everything remembered.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <algorithm>
+#include <inttypes.h>
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * This memoizes calls to pure Intcode functions.
+ */
+struct CallMemoizer {
+    /**
+     * This identifies a cell accessed by a call, either relative
+     * to the frame of the call or by absolute address.
+     */
+    struct Cell {
+        /**
+         * This indicates whether the address is relative to the
+         * frame of the call.
+         */
+        bool relative = false;
+
+        /**
+         * This is the address of the cell.
+         */
+        intmax_t address = 0;
+
+        bool operator<(const Cell& other) const {
+            if (relative != other.relative) {
+                return !relative;
+            }
+            return address < other.address;
+        }
+
+        bool operator==(const Cell& other) const {
+            return (
+                (relative == other.relative)
+                && (address == other.address)
+            );
+        }
+    };
+
+    /**
+     * This is something a call in progress did.
+     */
+    struct Event {
+        /**
+         * These are the kinds of events logged.
+         */
+        enum class Kind {
+            /**
+             * A cell was read.
+             */
+            Read,
+
+            /**
+             * A cell was written.
+             */
+            Write,
+
+            /**
+             * A cell was made to exist, without its value mattering.
+             */
+            Touch,
+
+            /**
+             * Code was executed, up to and including the cell.
+             */
+            Code,
+        };
+
+        Kind kind = Kind::Read;
+        size_t address = 0;
+        bool relative = false;
+        intmax_t value = 0;
+    };
+
+    /**
+     * This is a call in progress.
+     */
+    struct Frame {
+        /**
+         * This is the address of the function called.
+         */
+        size_t entry = 0;
+
+        /**
+         * This is the address to which the function will return.
+         */
+        size_t returnAddress = 0;
+
+        /**
+         * This is the relative base at the time of the call.
+         */
+        size_t base = 0;
+
+        /**
+         * This is the index of the first event in the log
+         * which belongs to the call.
+         */
+        size_t logStart = 0;
+
+        /**
+         * This is the instruction count of the machine at the time
+         * of the call.
+         */
+        uint64_t instructions = 0;
+    };
+
+    /**
+     * This is what a call did, given the values of its arguments.
+     */
+    struct Outcome {
+        /**
+         * These are the final values of the cells written by the call.
+         */
+        std::vector< std::pair< Cell, intmax_t > > writes;
+
+        /**
+         * This is the number of instructions executed by the call,
+         * including the one which returned from it.
+         */
+        uint64_t instructions = 0;
+
+        /**
+         * This is the highest offset from the frame of any cell
+         * accessed in relative mode, or -1 if there were none.
+         */
+        intmax_t highestRelative = -1;
+
+        /**
+         * This is the highest address of any cell accessed in position
+         * mode, or -1 if there were none.
+         */
+        intmax_t highestData = -1;
+
+        /**
+         * This is the highest address of any cell accessed in position
+         * mode or executed.  The frame must be above this for the
+         * outcome to apply.
+         */
+        intmax_t highestAbsolute = -1;
+    };
+
+    /**
+     * This holds the outcomes of calls to a function which read the
+     * same cells before writing to them.
+     */
+    struct Shape {
+        /**
+         * These are the cells read by the calls before writing to them.
+         */
+        std::vector< Cell > arguments;
+
+        /**
+         * These are the outcomes of the calls, keyed by the values
+         * of their arguments.
+         */
+        std::map< std::vector< intmax_t >, Outcome > outcomes;
+    };
+
+    /**
+     * This is what is known about a function.
+     */
+    struct Function {
+        /**
+         * These are the shapes of the calls to the function
+         * which were remembered.
+         */
+        std::vector< Shape > shapes;
+
+        /**
+         * This is the number of calls to the function seen so far.
+         */
+        unsigned int calls = 0;
+
+        /**
+         * This is the number of calls to the function to let go by
+         * without logging them, after logging one didn't pay off.
+         */
+        unsigned int cooldown = 0;
+
+        /**
+         * This is the number of times in a row logging calls to the
+         * function didn't pay off.  Each time, the function is let
+         * cool down for twice as long as the time before.
+         */
+        unsigned int failures = 0;
+
+        /**
+         * This is the number of outcomes of calls to the function
+         * remembered since it last cooled down.
+         */
+        unsigned int remembered = 0;
+
+        /**
+         * This is the number of calls to the function replayed
+         * since it last cooled down.
+         */
+        unsigned int replayed = 0;
+    };
+
+    /**
+     * This is an access to a cell made by a call which is being
+     * remembered.
+     */
+    struct Access {
+        Cell cell;
+        bool write = false;
+        intmax_t value = 0;
+
+        bool operator<(const Access& other) const {
+            return cell < other.cell;
+        }
+    };
+
+    /**
+     * This is the number of times a function must be called before
+     * calls to it are logged.
+     */
+    static const unsigned int HOT_THRESHOLD = 8;
+
+    /**
+     * This is the number of calls to a function which are let go by
+     * without logging them, the first time a call to the function turns
+     * out not to be pure, or calls to it aren't being replayed often
+     * enough to be worth logging.
+     */
+    static const unsigned int COOLDOWN = 64;
+
+    /**
+     * This is the maximum number of times the cooldown of a function
+     * is doubled, after logging calls to it keeps not paying off.
+     */
+    static const unsigned int MAX_FAILURES = 12;
+
+    /**
+     * This is the number of outcomes of calls to a function remembered
+     * before checking whether they are being replayed often enough.
+     */
+    static const unsigned int USEFULNESS_CHECK = 64;
+
+    /**
+     * This is the maximum number of shapes remembered per function,
+     * which bounds the work of looking up a call.
+     */
+    static const size_t MAX_SHAPES = 8;
+
+    /**
+     * This is the maximum number of outcomes remembered in total.
+     */
+    static const size_t MAX_OUTCOMES = 1 << 16;
+
+    /**
+     * This is the maximum number of events logged before giving up
+     * on the calls in progress.
+     */
+    static const size_t MAX_LOG = 1 << 20;
+
+    /**
+     * These are the functions called.
+     */
+    std::vector< Function > functions;
+
+    /**
+     * This maps function addresses to indexes into the functions
+     * vector, plus one.  Zero means no function starts at the address.
+     */
+    std::vector< size_t > functionIndexes;
+
+    /**
+     * This is the number of outcomes remembered.
+     */
+    size_t outcomes = 0;
+
+    /**
+     * These are the calls in progress, innermost last.
+     */
+    std::vector< Frame > frames;
+
+    /**
+     * This is everything the calls in progress did.
+     */
+    std::vector< Event > log;
+
+    /**
+     * This marks the cells executed while calls were in progress.
+     * Writing to any of them forgets everything remembered.
+     */
+    std::vector< bool > codeCells;
+
+    /**
+     * This holds the values of the arguments of the call being
+     * looked up, to avoid allocating memory for each lookup.
+     */
+    std::vector< intmax_t > values;
+
+    /**
+     * This holds the accesses made by the call being remembered,
+     * to avoid allocating memory for each call.
+     */
+    std::vector< Access > accesses;
+
+    /**
+     * This holds the arguments of the call being remembered,
+     * to avoid allocating memory for each call.
+     */
+    std::vector< Cell > arguments;
+
+    /**
+     * This is the number of calls remembered.
+     */
+    uint64_t callsMemoized = 0;
+
+    /**
+     * This is the number of calls replayed instead of executed.
+     */
+    uint64_t callsSkipped = 0;
+
+    /**
+     * This is the number of instructions skipped by replaying calls.
+     */
+    uint64_t instructionsSkipped = 0;
+
+    /**
+     * This indicates whether or not any calls are in progress.
+     */
+    bool Recording() const {
+        return !frames.empty();
+    }
+
+    /**
+     * This returns what is known about the function at the given
+     * address, starting to keep track of it if it's new.
+     */
+    Function& FunctionAt(size_t entry) {
+        if (functionIndexes.size() <= entry) {
+            functionIndexes.resize(entry + 1);
+        }
+        auto& index = functionIndexes[entry];
+        if (index == 0) {
+            functions.push_back(Function());
+            index = functions.size();
+        }
+        return functions[index - 1];
+    }
+
+    /**
+     * This lets calls to the given function go by for a while without
+     * logging them, for longer each time in a row this happens.
+     */
+    static void CoolDown(Function& function) {
+        function.cooldown = COOLDOWN << function.failures;
+        if (function.failures < MAX_FAILURES) {
+            ++function.failures;
+        }
+    }
+
+    /**
+     * This gives up on all calls in progress, and lets calls to their
+     * functions go by for a while without logging them.
+     */
+    void Abort() {
+        for (const auto& frame: frames) {
+            CoolDown(FunctionAt(frame.entry));
+        }
+        frames.clear();
+        FinishLog();
+    }
+
+    /**
+     * This is called once no calls are in progress, to discard the log.
+     * Code executed by the calls only needs watching for modifications
+     * if an outcome which depends on it was remembered.
+     */
+    void FinishLog() {
+        log.clear();
+        if (outcomes == 0) {
+            codeCells.clear();
+        }
+    }
+
+    /**
+     * This forgets everything remembered, but keeps the statistics.
+     */
+    void Reset() {
+        functions.clear();
+        functionIndexes.clear();
+        outcomes = 0;
+        codeCells.clear();
+        Abort();
+    }
+
+    /**
+     * This forgets every outcome remembered, because the code of a
+     * remembered function was modified.  Functions whose outcomes were
+     * forgotten before being replayed often enough are let cool down,
+     * so that programs which keep modifying their code don't keep
+     * paying for logging calls whose outcomes are soon forgotten.
+     */
+    void Forget() {
+        Abort();
+        for (auto& function: functions) {
+            if (function.shapes.empty()) {
+                continue;
+            }
+            function.shapes.clear();
+            if (function.replayed < function.remembered / 4) {
+                CoolDown(function);
+            }
+            function.remembered = 0;
+            function.replayed = 0;
+        }
+        outcomes = 0;
+        codeCells.clear();
+    }
+
+    /**
+     * This adds the given event to the log.
+     */
+    void Log(
+        Event::Kind kind,
+        size_t address,
+        bool relative,
+        intmax_t value
+    ) {
+        if (log.size() >= MAX_LOG) {
+            Abort();
+            return;
+        }
+        Event event;
+        event.kind = kind;
+        event.address = address;
+        event.relative = relative;
+        event.value = value;
+        log.push_back(event);
+    }
+
+    /**
+     * This is called before the machine executes an instruction.
+     *
+     * @param[in] pos
+     *     This is the position of the instruction.
+     *
+     * @param[in] length
+     *     This is the number of cells in the instruction.
+     */
+    void OnInstruction(
+        size_t pos,
+        size_t length
+    ) {
+        if (!Recording()) {
+            return;
+        }
+        const auto end = pos + length;
+        if (codeCells.size() < end) {
+            codeCells.resize(std::max(end, codeCells.size() * 2));
+        }
+        for (size_t i = pos; i < end; ++i) {
+            codeCells[i] = true;
+        }
+        Log(Event::Kind::Code, end - 1, false, 0);
+    }
+
+    /**
+     * This is called when the machine reads a cell.
+     *
+     * @param[in] address
+     *     This is the address of the cell.
+     *
+     * @param[in] relative
+     *     This indicates whether the cell was accessed in relative mode.
+     *
+     * @param[in] value
+     *     This is the value read.
+     */
+    void OnRead(
+        size_t address,
+        bool relative,
+        intmax_t value
+    ) {
+        if (Recording()) {
+            Log(Event::Kind::Read, address, relative, value);
+        }
+    }
+
+    /**
+     * This is called when the machine writes a cell.
+     *
+     * @param[in] address
+     *     This is the address of the cell.
+     *
+     * @param[in] relative
+     *     This indicates whether the cell was accessed in relative mode.
+     *
+     * @param[in] value
+     *     This is the value written.
+     */
+    void OnWrite(
+        size_t address,
+        bool relative,
+        intmax_t value
+    ) {
+        if (
+            (address < codeCells.size())
+            && codeCells[address]
+        ) {
+            Forget();
+            return;
+        }
+        if (Recording()) {
+            Log(Event::Kind::Write, address, relative, value);
+        }
+    }
+
+    /**
+     * This is called when the machine performs input or output,
+     * which no remembered call may do.
+     */
+    void OnInputOutput() {
+        Abort();
+    }
+
+    /**
+     * This is called when a jump is taken which looks like a call.
+     * If the call can be replayed, its results are stored, and the
+     * machine should continue at the return address.  Otherwise the
+     * call is logged.
+     *
+     * @param[in,out] numbers
+     *     This is the memory of the machine.
+     *
+     * @param[in] base
+     *     This is the relative base at the time of the call.
+     *
+     * @param[in] entry
+     *     This is the address of the function called.
+     *
+     * @param[in] returnAddress
+     *     This is the address to which the function will return.
+     *
+     * @param[in,out] instructions
+     *     This is the instruction count of the machine.
+     *
+     * @return
+     *     An indication of whether or not the call was replayed
+     *     is returned.
+     */
+    bool OnCall(
+        std::vector< intmax_t >& numbers,
+        size_t base,
+        size_t entry,
+        size_t returnAddress,
+        uint64_t& instructions
+    ) {
+        auto& function = FunctionAt(entry);
+        for (const auto& shape: function.shapes) {
+            values.clear();
+            for (const auto& argument: shape.arguments) {
+                const auto address = (
+                    argument.relative
+                    ? (size_t)argument.address + base
+                    : (size_t)argument.address
+                );
+                values.push_back(
+                    (address < numbers.size())
+                    ? numbers[address]
+                    : 0
+                );
+            }
+            const auto outcome = shape.outcomes.find(values);
+            if (
+                (outcome == shape.outcomes.end())
+                || (outcome->second.highestAbsolute >= (intmax_t)base)
+            ) {
+                continue;
+            }
+            Replay(numbers, base, shape, values, outcome->second);
+            instructions += outcome->second.instructions;
+            ++callsSkipped;
+            instructionsSkipped += outcome->second.instructions;
+            ++function.replayed;
+            return true;
+        }
+        if (function.cooldown > 0) {
+            --function.cooldown;
+            return false;
+        }
+        if (function.calls < HOT_THRESHOLD) {
+            ++function.calls;
+            return false;
+        }
+        Frame frame;
+        frame.entry = entry;
+        frame.returnAddress = returnAddress;
+        frame.base = base;
+        frame.logStart = log.size();
+        frame.instructions = instructions;
+        frames.push_back(frame);
+        return false;
+    }
+
+    /**
+     * This stores the results of a remembered call, and logs what
+     * it did for the benefit of any calls in progress.
+     */
+    void Replay(
+        std::vector< intmax_t >& numbers,
+        size_t base,
+        const Shape& shape,
+        const std::vector< intmax_t >& values,
+        const Outcome& outcome
+    ) {
+        const auto highest = std::max(
+            outcome.highestData,
+            (
+                (outcome.highestRelative < 0)
+                ? -1
+                : (intmax_t)base + outcome.highestRelative
+            )
+        );
+        if (highest >= (intmax_t)numbers.size()) {
+            numbers.resize((size_t)highest + 1);
+        }
+        const auto address = [base](const Cell& cell) {
+            return (
+                cell.relative
+                ? (size_t)cell.address + base
+                : (size_t)cell.address
+            );
+        };
+        const auto recording = Recording();
+        if (recording) {
+            for (size_t i = 0; i < shape.arguments.size(); ++i) {
+                const auto& argument = shape.arguments[i];
+                Log(Event::Kind::Read, address(argument), argument.relative, values[i]);
+            }
+            if (outcome.highestRelative >= 0) {
+                Log(Event::Kind::Touch, base + (size_t)outcome.highestRelative, true, 0);
+            }
+            if (outcome.highestData >= 0) {
+                Log(Event::Kind::Touch, (size_t)outcome.highestData, false, 0);
+            }
+            if (outcome.highestAbsolute >= 0) {
+                Log(Event::Kind::Code, (size_t)outcome.highestAbsolute, false, 0);
+            }
+        }
+        for (const auto& write: outcome.writes) {
+            numbers[address(write.first)] = write.second;
+            if (recording) {
+                Log(Event::Kind::Write, address(write.first), write.first.relative, write.second);
+            }
+        }
+    }
+
+    /**
+     * This is called whenever a jump is taken, to finish any calls
+     * which return because of it.
+     *
+     * @param[in] relativeBase
+     *     This is the relative base of the machine.
+     *
+     * @param[in] target
+     *     This is the position to which the jump goes.
+     *
+     * @param[in] instructions
+     *     This is the instruction count of the machine.
+     */
+    void OnJump(
+        intmax_t relativeBase,
+        size_t target,
+        uint64_t instructions
+    ) {
+        while (Recording()) {
+            const auto& frame = frames.back();
+            if (relativeBase < (intmax_t)frame.base) {
+                // The function popped more than its own frame, so it
+                // must not have been a function after all.
+                frames.pop_back();
+                continue;
+            }
+            if (
+                (target != frame.returnAddress)
+                || (relativeBase != (intmax_t)frame.base)
+            ) {
+                break;
+            }
+            Remember(frame, instructions);
+            frames.pop_back();
+        }
+        if (!Recording()) {
+            FinishLog();
+        }
+    }
+
+    /**
+     * This remembers the outcome of the given call, which has just
+     * returned, if the call qualifies.
+     */
+    void Remember(
+        const Frame& frame,
+        uint64_t instructions
+    ) {
+        if (outcomes >= MAX_OUTCOMES) {
+            return;
+        }
+        accesses.clear();
+        Outcome outcome;
+        for (size_t i = frame.logStart; i < log.size(); ++i) {
+            const auto& event = log[i];
+            if (event.kind == Event::Kind::Code) {
+                if (event.address >= frame.base) {
+                    CoolDown(FunctionAt(frame.entry));
+                    return;
+                }
+                outcome.highestAbsolute = std::max(outcome.highestAbsolute, (intmax_t)event.address);
+                continue;
+            }
+            Cell cell;
+            cell.relative = event.relative;
+            if (event.relative) {
+                if (event.address < frame.base) {
+                    CoolDown(FunctionAt(frame.entry));
+                    return;
+                }
+                cell.address = (intmax_t)(event.address - frame.base);
+                outcome.highestRelative = std::max(outcome.highestRelative, cell.address);
+            } else {
+                if (event.address >= frame.base) {
+                    CoolDown(FunctionAt(frame.entry));
+                    return;
+                }
+                cell.address = (intmax_t)event.address;
+                outcome.highestData = std::max(outcome.highestData, cell.address);
+                outcome.highestAbsolute = std::max(outcome.highestAbsolute, cell.address);
+            }
+            if (event.kind != Event::Kind::Touch) {
+                Access access;
+                access.cell = cell;
+                access.write = (event.kind == Event::Kind::Write);
+                access.value = event.value;
+                accesses.push_back(access);
+            }
+        }
+        outcome.instructions = instructions - frame.instructions;
+
+        // Group the accesses by cell, keeping them in order for each
+        // cell.  A cell whose first access is a read is an argument,
+        // and the last write to a cell is its result.
+        std::stable_sort(accesses.begin(), accesses.end());
+        arguments.clear();
+        values.clear();
+        for (size_t i = 0; i < accesses.size();) {
+            const auto& cell = accesses[i].cell;
+            if (!accesses[i].write) {
+                arguments.push_back(cell);
+                values.push_back(accesses[i].value);
+            }
+            const Access* lastWrite = nullptr;
+            for (; (i < accesses.size()) && (accesses[i].cell == cell); ++i) {
+                if (accesses[i].write) {
+                    lastWrite = &accesses[i];
+                }
+            }
+            if (lastWrite != nullptr) {
+                outcome.writes.push_back(std::make_pair(lastWrite->cell, lastWrite->value));
+            }
+        }
+
+        // File the outcome under the shape of the call.
+        auto& function = FunctionAt(frame.entry);
+        auto& shapes = function.shapes;
+        auto shape = std::find_if(
+            shapes.begin(),
+            shapes.end(),
+            [this](const Shape& shape) {
+                return shape.arguments == arguments;
+            }
+        );
+        if (shape == shapes.end()) {
+            if (shapes.size() >= MAX_SHAPES) {
+                return;
+            }
+            shapes.push_back(Shape());
+            shape = shapes.end() - 1;
+            shape->arguments = arguments;
+        }
+        if (shape->outcomes.insert(std::make_pair(values, outcome)).second) {
+            ++outcomes;
+            ++callsMemoized;
+
+            // Stop logging calls to the function for a while if
+            // they aren't being replayed often enough.
+            if (++function.remembered >= USEFULNESS_CHECK) {
+                if (function.replayed < function.remembered / 4) {
+                    CoolDown(function);
+                } else {
+                    function.failures = 0;
+                }
+                function.remembered = 0;
+                function.replayed = 0;
+            }
+        }
+    }
+};
+
+#endif /* INTCODE_CALL_MEMOIZER_HPP */
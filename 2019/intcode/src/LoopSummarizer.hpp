@@ -0,0 +1,1047 @@
+#ifndef INTCODE_LOOP_SUMMARIZER_HPP
+#define INTCODE_LOOP_SUMMARIZER_HPP
+
+/**
+ * @file LoopSummarizer.hpp
+ *
+ * This module declares the LoopSummarizer structure, which replaces
+ * whole runs of simple counted Intcode loops with a single closed-form
+ * update of the memory they modify.
+ *
+ * A loop qualifies if its body is straight-line arithmetic (add,
+ * multiply, less-than, equals) ending in a backward conditional jump,
+ * and every cell the body writes is one of the following, in terms of
+ * the values of cells at the start of each iteration:
+ *
+ * - an induction variable: v' = v + d
+ * - an accumulator: v' = v + k + a sum of multiples of induction variables
+ * - a temporary: v' = k + a sum of multiples of induction variables
+ * - a comparison between two such sums
+ *
+ * Cells the body only reads are treated as constants.  The loop condition
+ * must be a temporary, induction variable, or comparison, so that the
+ * number of iterations can be solved for directly.  The machine's
+ * arithmetic is on signed integers, which must not overflow, so sums are
+ * computed in checked arithmetic, and a loop whose summary would
+ * overflow is left to the interpreter, along with anything else,
+ * including loops whose bodies would modify their own code.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <algorithm>
+#include <inttypes.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * This summarizes simple counted loops in Intcode programs.
+ */
+struct LoopSummarizer {
+    /**
+     * This is the maximum number of cells in any sum computed by a loop
+     * which may be summarized.  Sums are kept in fixed arrays, so that
+     * summarizing a loop doesn't allocate memory.
+     */
+    static const size_t MAX_TERMS = 8;
+
+    /**
+     * This is a sum of multiples of the values of cells, plus
+     * a constant.  Each term is the address of a cell and its
+     * (nonzero) coefficient.
+     */
+    struct Affine {
+        intmax_t constant = 0;
+        size_t count = 0;
+        size_t cells[MAX_TERMS];
+        intmax_t coefficients[MAX_TERMS];
+
+        /**
+         * This returns the index of the term for the given cell,
+         * or the number of terms if the cell has none.
+         */
+        size_t Find(size_t cell) const {
+            size_t i = 0;
+            while (
+                (i < count)
+                && (cells[i] != cell)
+            ) {
+                ++i;
+            }
+            return i;
+        }
+
+        /**
+         * This adds a multiple of the given cell to the sum, unless
+         * a coefficient would overflow, or there's no room for
+         * another term.
+         */
+        bool Add(size_t cell, intmax_t coefficient) {
+            const auto i = Find(cell);
+            if (i == count) {
+                if (count == MAX_TERMS) {
+                    return false;
+                }
+                cells[count] = cell;
+                coefficients[count] = coefficient;
+                ++count;
+            } else if (!CheckedAdd(coefficients[i], coefficient, coefficients[i])) {
+                return false;
+            }
+            if (coefficients[i] == 0) {
+                --count;
+                cells[i] = cells[count];
+                coefficients[i] = coefficients[count];
+            }
+            return true;
+        }
+    };
+
+    /**
+     * This is the symbolic value of a cell written by a loop body.
+     */
+    struct Value {
+        /**
+         * This is the value, or the left side of the comparison
+         * if the value is the result of a comparison.
+         */
+        Affine lhs;
+
+        /**
+         * This is the opcode of the comparison (7 for less-than,
+         * 8 for equals) if the value is the result of a comparison,
+         * or zero otherwise.
+         */
+        intmax_t comparison = 0;
+
+        /**
+         * This is the right side of the comparison, if the value is
+         * the result of a comparison.
+         */
+        Affine rhs;
+    };
+
+    /**
+     * This is what is known about a cell written by the body of a loop
+     * while the loop is being summarized.
+     */
+    struct Written {
+        /**
+         * This is the address of the cell.
+         */
+        size_t address = 0;
+
+        /**
+         * This indicates whether or not the body has written the cell
+         * yet, while it's being executed symbolically.
+         */
+        bool assigned = false;
+
+        /**
+         * This is the symbolic value of the cell at the end of
+         * an iteration.
+         */
+        Value value;
+
+        /**
+         * This indicates whether or not the cell is an induction
+         * variable.
+         */
+        bool induction = false;
+
+        /**
+         * This is how much the cell changes with each iteration,
+         * if it's an induction variable.
+         */
+        intmax_t step = 0;
+
+        /**
+         * This is the value of the cell after the last iteration.
+         */
+        intmax_t result = 0;
+
+        bool operator<(const Written& other) const {
+            return address < other.address;
+        }
+    };
+
+    /**
+     * This is one instruction in the body of a loop.
+     */
+    struct Step {
+        intmax_t opcode = 0;
+        int modes[3] = {0, 0, 0};
+        intmax_t operands[3] = {0, 0, 0};
+    };
+
+    /**
+     * This holds what is known about one loop, identified by the
+     * position of the jump at its end.
+     */
+    struct Loop {
+        /**
+         * This is the position of the first instruction of the loop.
+         */
+        size_t header = 0;
+
+        /**
+         * This is a copy of the code of the loop when it was analyzed,
+         * used to detect if the code is modified later.
+         */
+        std::vector< intmax_t > code;
+
+        /**
+         * These are the instructions of the loop, not counting
+         * the jump at the end.
+         */
+        std::vector< Step > body;
+
+        /**
+         * This is the jump at the end of the loop.
+         */
+        Step jump;
+
+        /**
+         * This indicates whether or not the code of the loop has
+         * a form which can be summarized.
+         */
+        bool summarizable = false;
+
+        /**
+         * This is the number of times the loop has come around
+         * without being summarized.
+         */
+        unsigned int heat = 0;
+
+        /**
+         * This is the number of times to let the loop come around
+         * before trying again to summarize it.
+         */
+        unsigned int cooldown = 0;
+
+        /**
+         * This is the number of times in a row the loop couldn't be
+         * summarized.  Each time, the loop is let cool down for twice
+         * as long as the time before.
+         */
+        unsigned int failures = 0;
+    };
+
+    /**
+     * This is the number of times a loop has to come around
+     * before trying to summarize it.
+     */
+    static const unsigned int HOT_THRESHOLD = 2;
+
+    /**
+     * This is the number of times to let a loop come around before
+     * trying again to summarize it after failing to do so the first
+     * time, either because of the values it was working with, or because
+     * its code doesn't qualify.  Code is only checked for changes once
+     * the cooldown is over.
+     */
+    static const unsigned int COOLDOWN = 64;
+
+    /**
+     * This is the maximum number of times the cooldown of a loop
+     * is doubled, after it keeps failing to be summarized.
+     */
+    static const unsigned int MAX_FAILURES = 12;
+
+    /**
+     * This is the maximum number of instructions in the body
+     * of a loop which may be summarized.
+     */
+    static const size_t MAX_BODY_LENGTH = 64;
+
+    /**
+     * This is the magnitude limit for values compared by a loop
+     * condition, which keeps comparisons free of wrap-around.
+     */
+    static const intmax_t COMPARISON_LIMIT = INTMAX_MAX / 4;
+
+    /**
+     * These are all the loops seen so far.
+     */
+    std::vector< Loop > loops;
+
+    /**
+     * This maps jump positions to indexes into the loops vector,
+     * plus one.  Zero means no loop ends at the position.
+     */
+    std::vector< size_t > loopIndexes;
+
+    /**
+     * This is the number of times a loop was summarized.
+     */
+    uint64_t loopsSummarized = 0;
+
+    /**
+     * This is the total number of loop iterations skipped
+     * by summarizing loops.
+     */
+    uint64_t iterationsSkipped = 0;
+
+    /**
+     * These are the cells written by the most recent summary.
+     */
+    std::vector< size_t > lastWritten;
+
+    /**
+     * These are the cells written by the loop being summarized, in
+     * order of address, kept here to avoid allocating memory for each
+     * summary.
+     */
+    std::vector< Written > written;
+
+    /**
+     * This forgets everything known about loops, but keeps the
+     * statistics.
+     */
+    void Reset() {
+        loops.clear();
+        loopIndexes.clear();
+    }
+
+    /**
+     * This adds two numbers, unless the sum would overflow.
+     */
+    static bool CheckedAdd(intmax_t a, intmax_t b, intmax_t& result) {
+        if (
+            ((b > 0) && (a > INTMAX_MAX - b))
+            || ((b < 0) && (a < INTMAX_MIN - b))
+        ) {
+            return false;
+        }
+        result = a + b;
+        return true;
+    }
+
+    /**
+     * This multiplies two numbers, unless the product would overflow.
+     */
+    static bool CheckedMultiply(intmax_t a, intmax_t b, intmax_t& result) {
+        if (
+            (a > 0)
+            ? (
+                (b > 0)
+                ? (a > INTMAX_MAX / b)
+                : (b < INTMAX_MIN / a)
+            )
+            : (
+                (b > 0)
+                ? (a < INTMAX_MIN / b)
+                : ((a != 0) && (b < INTMAX_MAX / a))
+            )
+        ) {
+            return false;
+        }
+        result = a * b;
+        return true;
+    }
+
+    /**
+     * This decodes the loop from the given header position to the
+     * jump at the given position, and determines whether or not it
+     * has a form which can be summarized.
+     *
+     * @param[in] numbers
+     *     This is the memory of the machine.
+     *
+     * @param[in] header
+     *     This is the position of the first instruction of the loop.
+     *
+     * @param[in] jumpPos
+     *     This is the position of the jump at the end of the loop.
+     *
+     * @param[out] loop
+     *     This is where to store what was learned about the loop.
+     */
+    static void Analyze(
+        const std::vector< intmax_t >& numbers,
+        size_t header,
+        size_t jumpPos,
+        Loop& loop
+    ) {
+        // Start over, but keep the memory already allocated for the loop,
+        // in case its code keeps being modified.
+        loop.header = header;
+        loop.code.assign(numbers.begin() + header, numbers.begin() + jumpPos + 3);
+        loop.body.clear();
+        loop.jump = Step();
+        loop.summarizable = false;
+        loop.failures = 0;
+        size_t pos = header;
+        while (pos <= jumpPos) {
+            Step step;
+            const auto word = numbers[pos];
+            if (word < 0) {
+                return;
+            }
+            step.opcode = word % 100;
+            const size_t parameters = (
+                (
+                    (step.opcode == 5)
+                    || (step.opcode == 6)
+                )
+                ? 2
+                : 3
+            );
+            if (
+                (
+                    (step.opcode < 1)
+                    || (step.opcode > 8)
+                    || (step.opcode == 3)
+                    || (step.opcode == 4)
+                )
+                || ((word / 100000) != 0)
+                || (pos + parameters > jumpPos + 2)
+            ) {
+                return;
+            }
+            intmax_t modeDigits = word / 100;
+            for (size_t i = 0; i < parameters; ++i) {
+                step.modes[i] = (int)(modeDigits % 10);
+                modeDigits /= 10;
+                step.operands[i] = numbers[pos + 1 + i];
+                if (step.modes[i] > 2) {
+                    return;
+                }
+            }
+            if (parameters == 2) {
+                if (
+                    (pos != jumpPos)
+                    || (step.modes[0] == 1)
+                    || (step.modes[1] != 1)
+                    || (step.operands[1] != (intmax_t)header)
+                ) {
+                    return;
+                }
+                loop.jump = step;
+                loop.summarizable = true;
+                return;
+            }
+            if (
+                (step.modes[2] == 1)
+                || (loop.body.size() >= MAX_BODY_LENGTH)
+            ) {
+                return;
+            }
+            loop.body.push_back(step);
+            pos += 4;
+        }
+    }
+
+    /**
+     * This returns what is known about the given cell, if it's written
+     * by the loop being summarized, or nullptr otherwise.
+     */
+    Written* FindWritten(size_t cell) {
+        Written key;
+        key.address = cell;
+        const auto entry = std::lower_bound(written.begin(), written.end(), key);
+        if (
+            (entry == written.end())
+            || (entry->address != cell)
+        ) {
+            return nullptr;
+        }
+        return &*entry;
+    }
+
+    /**
+     * This computes the value of the given sum at the start of the
+     * first iteration (alpha) and how much it changes with each
+     * iteration (beta), given that it only involves induction
+     * variables.
+     *
+     * @return
+     *     An indication of whether or not the sum involves only
+     *     induction variables and could be computed without
+     *     overflowing is returned.
+     */
+    bool Linearize(
+        const Affine& affine,
+        const std::vector< intmax_t >& numbers,
+        intmax_t& alpha,
+        intmax_t& beta
+    ) {
+        alpha = affine.constant;
+        beta = 0;
+        for (size_t i = 0; i < affine.count; ++i) {
+            const auto cell = affine.cells[i];
+            const auto induction = FindWritten(cell);
+            if (
+                (induction == nullptr)
+                || !induction->induction
+            ) {
+                return false;
+            }
+            intmax_t product;
+            if (
+                !CheckedMultiply(affine.coefficients[i], numbers[cell], product)
+                || !CheckedAdd(alpha, product, alpha)
+                || !CheckedMultiply(affine.coefficients[i], induction->step, product)
+                || !CheckedAdd(beta, product, beta)
+            ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * This computes alpha + beta * i, making sure it stays within
+     * the range where comparisons can't wrap around.
+     */
+    static bool Evaluate(
+        intmax_t alpha,
+        intmax_t beta,
+        intmax_t i,
+        intmax_t& value
+    ) {
+        return (
+            CheckedMultiply(beta, i, value)
+            && CheckedAdd(alpha, value, value)
+            && (value < COMPARISON_LIMIT)
+            && (value > -COMPARISON_LIMIT)
+        );
+    }
+
+    /**
+     * This attempts to summarize the loop which just jumped back to
+     * its start, by applying the effect of all its remaining
+     * iterations to memory at once.
+     *
+     * @param[in,out] numbers
+     *     This is the memory of the machine.
+     *
+     * @param[in] relativeBase
+     *     This is the relative base of the machine.
+     *
+     * @param[in] header
+     *     This is the position of the first instruction of the loop.
+     *
+     * @param[in] jumpPos
+     *     This is the position of the jump at the end of the loop.
+     *
+     * @param[in,out] instructions
+     *     This is the count of instructions executed by the machine,
+     *     which is advanced by the number of instructions the
+     *     summarized iterations would have executed.
+     *
+     * @return
+     *     An indication of whether or not the loop was summarized is
+     *     returned.  If so, the machine should continue with the
+     *     instruction after the jump at the end of the loop.
+     */
+    bool TrySummarize(
+        std::vector< intmax_t >& numbers,
+        intmax_t relativeBase,
+        size_t header,
+        size_t jumpPos,
+        uint64_t& instructions
+    ) {
+        if (jumpPos + 3 > numbers.size()) {
+            return false;
+        }
+        if (loopIndexes.size() <= jumpPos) {
+            loopIndexes.resize(jumpPos + 1);
+        }
+        auto& index = loopIndexes[jumpPos];
+        if (index == 0) {
+            loops.push_back(Loop());
+            index = loops.size();
+        }
+        auto& loop = loops[index - 1];
+        if (loop.cooldown > 0) {
+            --loop.cooldown;
+            return false;
+        }
+        if (++loop.heat < HOT_THRESHOLD) {
+            return false;
+        }
+        loop.heat = 0;
+
+        // Analyze the loop the first time it gets hot, and guard against
+        // it having been modified since it was analyzed.
+        if (
+            loop.code.empty()
+            || (loop.header != header)
+            || !std::equal(loop.code.begin(), loop.code.end(), numbers.begin() + header)
+        ) {
+            Analyze(numbers, header, jumpPos, loop);
+        }
+        if (
+            loop.summarizable
+            && Summarize(numbers, relativeBase, loop, instructions)
+        ) {
+            loop.failures = 0;
+            ++loopsSummarized;
+            return true;
+        }
+        loop.cooldown = COOLDOWN << loop.failures;
+        if (loop.failures < MAX_FAILURES) {
+            ++loop.failures;
+        }
+        return false;
+    }
+
+    /**
+     * This applies the effect of all remaining iterations of the
+     * given loop to memory, if possible.
+     */
+    bool Summarize(
+        std::vector< intmax_t >& numbers,
+        intmax_t relativeBase,
+        const Loop& loop,
+        uint64_t& instructions
+    ) {
+        const auto address = [relativeBase](const Step& step, size_t i) -> intmax_t {
+            return (
+                (step.modes[i] == 2)
+                ? relativeBase + step.operands[i]
+                : step.operands[i]
+            );
+        };
+
+        // Find every cell written by the body, making sure the body
+        // doesn't write to its own code.  Make room for every cell
+        // accessed, just as the machine would.
+        const auto codeEnd = loop.header + loop.code.size();
+        written.clear();
+        intmax_t highest = 0;
+        for (const auto& step: loop.body) {
+            for (size_t i = 0; i < 3; ++i) {
+                if (step.modes[i] == 1) {
+                    continue;
+                }
+                const auto cell = address(step, i);
+                if (cell < 0) {
+                    return false;
+                }
+                highest = std::max(highest, cell);
+                if (i == 2) {
+                    if (
+                        ((size_t)cell >= loop.header)
+                        && ((size_t)cell < codeEnd)
+                    ) {
+                        return false;
+                    }
+                    Written entry;
+                    entry.address = (size_t)cell;
+                    written.push_back(entry);
+                }
+            }
+        }
+        std::sort(written.begin(), written.end());
+        written.erase(
+            std::unique(
+                written.begin(),
+                written.end(),
+                [](const Written& lhs, const Written& rhs) {
+                    return lhs.address == rhs.address;
+                }
+            ),
+            written.end()
+        );
+        const auto conditionCell = address(loop.jump, 0);
+        if (conditionCell < 0) {
+            return false;
+        }
+        highest = std::max(highest, conditionCell);
+        if ((size_t)highest >= numbers.size()) {
+            numbers.resize((size_t)highest + 1);
+        }
+
+        // Execute the body symbolically, in terms of the values
+        // of written cells at the start of an iteration.
+        const auto read = [&](const Step& step, size_t i, Affine& affine) -> bool {
+            affine = Affine();
+            if (step.modes[i] == 1) {
+                affine.constant = step.operands[i];
+                return true;
+            }
+            const auto cell = (size_t)address(step, i);
+            const auto entry = FindWritten(cell);
+            if (entry == nullptr) {
+                affine.constant = numbers[cell];
+            } else if (entry->assigned) {
+                if (entry->value.comparison != 0) {
+                    return false;
+                }
+                affine = entry->value.lhs;
+            } else {
+                affine.cells[0] = cell;
+                affine.coefficients[0] = 1;
+                affine.count = 1;
+            }
+            return true;
+        };
+        for (const auto& step: loop.body) {
+            Affine arg1, arg2;
+            if (
+                !read(step, 0, arg1)
+                || !read(step, 1, arg2)
+            ) {
+                return false;
+            }
+            Value result;
+            switch (step.opcode) {
+                case 1: { // add
+                    result.lhs = arg1;
+                    if (!CheckedAdd(result.lhs.constant, arg2.constant, result.lhs.constant)) {
+                        return false;
+                    }
+                    for (size_t j = 0; j < arg2.count; ++j) {
+                        if (!result.lhs.Add(arg2.cells[j], arg2.coefficients[j])) {
+                            return false;
+                        }
+                    }
+                } break;
+
+                case 2: { // multiply
+                    if (arg1.count != 0) {
+                        std::swap(arg1, arg2);
+                    }
+                    if (arg1.count != 0) {
+                        return false;
+                    }
+                    const auto factor = arg1.constant;
+                    if (!CheckedMultiply(arg2.constant, factor, result.lhs.constant)) {
+                        return false;
+                    }
+                    if (factor != 0) {
+                        for (size_t j = 0; j < arg2.count; ++j) {
+                            intmax_t coefficient;
+                            if (!CheckedMultiply(arg2.coefficients[j], factor, coefficient)) {
+                                return false;
+                            }
+                            result.lhs.cells[j] = arg2.cells[j];
+                            result.lhs.coefficients[j] = coefficient;
+                        }
+                        result.lhs.count = arg2.count;
+                    }
+                } break;
+
+                default: { // less-than, equals
+                    if (
+                        (arg1.count == 0)
+                        && (arg2.count == 0)
+                    ) {
+                        result.lhs.constant = (
+                            (step.opcode == 7)
+                            ? (arg1.constant < arg2.constant)
+                            : (arg1.constant == arg2.constant)
+                        ) ? 1 : 0;
+                    } else {
+                        result.lhs = arg1;
+                        result.comparison = step.opcode;
+                        result.rhs = arg2;
+                    }
+                } break;
+            }
+            const auto entry = FindWritten((size_t)address(step, 2));
+            entry->value = result;
+            entry->assigned = true;
+        }
+
+        // Classify every written cell, first finding the induction
+        // variables, and make sure everything else depends only
+        // on them.
+        for (auto& entry: written) {
+            const auto& value = entry.value;
+            if (
+                (value.comparison == 0)
+                && (value.lhs.count == 1)
+                && (value.lhs.cells[0] == entry.address)
+                && (value.lhs.coefficients[0] == 1)
+            ) {
+                entry.induction = true;
+                entry.step = value.lhs.constant;
+            }
+        }
+        const auto dependsOnlyOnInductions = [this](const Affine& affine, size_t self) -> bool {
+            for (size_t i = 0; i < affine.count; ++i) {
+                if (affine.cells[i] == self) {
+                    continue;
+                }
+                const auto induction = FindWritten(affine.cells[i]);
+                if (
+                    (induction == nullptr)
+                    || !induction->induction
+                ) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        for (const auto& entry: written) {
+            const auto& value = entry.value;
+            if (value.comparison != 0) {
+                if (
+                    !dependsOnlyOnInductions(value.lhs, SIZE_MAX)
+                    || !dependsOnlyOnInductions(value.rhs, SIZE_MAX)
+                ) {
+                    return false;
+                }
+                continue;
+            }
+            const auto self = value.lhs.Find(entry.address);
+            if (
+                (
+                    (self != value.lhs.count)
+                    && (value.lhs.coefficients[self] != 1)
+                )
+                || !dependsOnlyOnInductions(value.lhs, entry.address)
+            ) {
+                return false;
+            }
+        }
+
+        // Solve for the number of iterations left.  The loop condition
+        // is alpha + beta * i at the end of iteration i, or else
+        // a comparison of two such sums.
+        const auto condition = FindWritten((size_t)conditionCell);
+        if (condition == nullptr) {
+            return false;
+        }
+        const auto& conditionValue = condition->value;
+        intmax_t alpha, beta;
+        intmax_t rhsAlpha = 0, rhsBeta = 0;
+        if (
+            (conditionValue.comparison == 0)
+            && (conditionValue.lhs.Find((size_t)conditionCell) != conditionValue.lhs.count)
+            && !condition->induction
+        ) {
+            return false;
+        }
+        if (
+            !Linearize(conditionValue.lhs, numbers, alpha, beta)
+            || !Linearize(conditionValue.rhs, numbers, rhsAlpha, rhsBeta)
+        ) {
+            return false;
+        }
+        if (conditionValue.comparison != 0) {
+            // Compare the difference of the two sides, making sure
+            // neither side, nor their difference, can wrap around
+            // at the start.
+            intmax_t start;
+            if (
+                !Evaluate(alpha, 0, 0, start)
+                || !Evaluate(rhsAlpha, 0, 0, start)
+                || !CheckedAdd(alpha, -rhsAlpha, alpha)
+                || !CheckedAdd(beta, -rhsBeta, beta)
+            ) {
+                return false;
+            }
+        }
+
+        // Keep everything well within range, so that solving for the
+        // number of iterations can't overflow.
+        intmax_t check;
+        if (
+            !Evaluate(alpha, 0, 0, check)
+            || !Evaluate(beta, 0, 0, check)
+        ) {
+            return false;
+        }
+
+        // Determine, in terms of the difference (or plain value) d,
+        // what keeps the loop going.
+        enum class Continue { NonZero, Zero, Negative, NonNegative };
+        Continue keepGoing;
+        const auto jumpIfTrue = (loop.jump.opcode == 5);
+        if (conditionValue.comparison == 0) {
+            keepGoing = jumpIfTrue ? Continue::NonZero : Continue::Zero;
+        } else if (conditionValue.comparison == 7) {
+            keepGoing = jumpIfTrue ? Continue::Negative : Continue::NonNegative;
+        } else {
+            keepGoing = jumpIfTrue ? Continue::Zero : Continue::NonZero;
+        }
+        intmax_t last = 0;
+        switch (keepGoing) {
+            case Continue::NonZero: {
+                if (
+                    (beta == 0)
+                    || ((-alpha) % beta != 0)
+                    || ((-alpha) / beta < 0)
+                ) {
+                    return false;
+                }
+                last = (-alpha) / beta;
+            } break;
+
+            case Continue::Zero: {
+                if (alpha != 0) {
+                    last = 0;
+                } else if (beta != 0) {
+                    last = 1;
+                } else {
+                    return false;
+                }
+            } break;
+
+            case Continue::Negative: {
+                if (alpha >= 0) {
+                    last = 0;
+                } else if (beta <= 0) {
+                    return false;
+                } else {
+                    last = (-alpha + beta - 1) / beta;
+                }
+            } break;
+
+            case Continue::NonNegative: {
+                if (alpha < 0) {
+                    last = 0;
+                } else if (beta >= 0) {
+                    return false;
+                } else {
+                    last = alpha / (-beta) + 1;
+                }
+            } break;
+        }
+
+        // Make sure every comparison the loop makes stays within range
+        // up to the last iteration.  Since the sums are linear, it's
+        // enough to check the first and last iterations.
+        if (!Evaluate(alpha, beta, last, check)) {
+            return false;
+        }
+        for (const auto& entry: written) {
+            const auto& value = entry.value;
+            if (value.comparison == 0) {
+                continue;
+            }
+            intmax_t lhsAlpha, lhsBeta, otherAlpha, otherBeta;
+            if (
+                !Linearize(value.lhs, numbers, lhsAlpha, lhsBeta)
+                || !Linearize(value.rhs, numbers, otherAlpha, otherBeta)
+                || !Evaluate(lhsAlpha, lhsBeta, last, check)
+                || !Evaluate(otherAlpha, otherBeta, last, check)
+                || !Evaluate(lhsAlpha, 0, 0, check)
+                || !Evaluate(otherAlpha, 0, 0, check)
+            ) {
+                return false;
+            }
+        }
+
+        // Compute the final value of every written cell after the
+        // remaining iterations, using the values at the start.
+        const auto iterations = last + 1;
+        intmax_t triangle;
+        if (
+            !(
+                ((iterations % 2) == 0)
+                ? CheckedMultiply(iterations / 2, iterations - 1, triangle)
+                : CheckedMultiply(iterations, (iterations - 1) / 2, triangle)
+            )
+        ) {
+            return false;
+        }
+        const auto sumAt = [&](const Affine& affine, intmax_t i, size_t self, intmax_t& sum) -> bool {
+            sum = affine.constant;
+            for (size_t j = 0; j < affine.count; ++j) {
+                if (affine.cells[j] == self) {
+                    continue;
+                }
+                const auto start = numbers[affine.cells[j]];
+                const auto step = FindWritten(affine.cells[j])->step;
+                intmax_t value;
+                if (
+                    !CheckedMultiply(step, i, value)
+                    || !CheckedAdd(start, value, value)
+                    || !CheckedMultiply(affine.coefficients[j], value, value)
+                    || !CheckedAdd(sum, value, sum)
+                ) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        for (auto& entry: written) {
+            const auto cell = entry.address;
+            const auto& value = entry.value;
+            if (value.comparison != 0) {
+                intmax_t lhs, rhs;
+                if (
+                    !sumAt(value.lhs, last, SIZE_MAX, lhs)
+                    || !sumAt(value.rhs, last, SIZE_MAX, rhs)
+                ) {
+                    return false;
+                }
+                entry.result = (
+                    (value.comparison == 7)
+                    ? (lhs < rhs)
+                    : (lhs == rhs)
+                ) ? 1 : 0;
+                continue;
+            }
+            intmax_t total;
+            if (entry.induction) {
+                if (
+                    !CheckedMultiply(entry.step, iterations, total)
+                    || !CheckedAdd(numbers[cell], total, total)
+                ) {
+                    return false;
+                }
+            } else if (value.lhs.Find(cell) != value.lhs.count) {
+                // Accumulator: add up the sum over every iteration.
+                // What's added each iteration is linear in the
+                // iteration, so as long as it doesn't change sign, the
+                // sum only moves one way, and if the final sum is
+                // within range, so are all the ones before it.
+                intmax_t first, final;
+                if (
+                    !sumAt(value.lhs, 0, cell, first)
+                    || !sumAt(value.lhs, last, cell, final)
+                    || ((first < 0) && (final > 0))
+                    || ((first > 0) && (final < 0))
+                    || !CheckedMultiply(value.lhs.constant, iterations, total)
+                    || !CheckedAdd(numbers[cell], total, total)
+                ) {
+                    return false;
+                }
+                for (size_t i = 0; i < value.lhs.count; ++i) {
+                    if (value.lhs.cells[i] == cell) {
+                        continue;
+                    }
+                    const auto start = numbers[value.lhs.cells[i]];
+                    const auto step = FindWritten(value.lhs.cells[i])->step;
+                    intmax_t starts, steps;
+                    if (
+                        !CheckedMultiply(start, iterations, starts)
+                        || !CheckedMultiply(step, triangle, steps)
+                        || !CheckedAdd(starts, steps, steps)
+                        || !CheckedMultiply(value.lhs.coefficients[i], steps, steps)
+                        || !CheckedAdd(total, steps, total)
+                    ) {
+                        return false;
+                    }
+                }
+            } else {
+                // Temporary: it's linear in the iteration, so if its
+                // values at the first and last iterations are within
+                // range, so are all the others.
+                if (
+                    !sumAt(value.lhs, 0, cell, total)
+                    || !sumAt(value.lhs, last, cell, total)
+                ) {
+                    return false;
+                }
+            }
+            entry.result = total;
+        }
+        lastWritten.clear();
+        for (const auto& entry: written) {
+            numbers[entry.address] = entry.result;
+            lastWritten.push_back(entry.address);
+        }
+        instructions += (uint64_t)iterations * (loop.body.size() + 1);
+        iterationsSkipped += (uint64_t)iterations;
+        return true;
+    }
+};
+
+#endif /* INTCODE_LOOP_SUMMARIZER_HPP */
@@ -0,0 +1,277 @@
+#ifndef INTCODE_MACHINE_HPP
+#define INTCODE_MACHINE_HPP
+
+/**
+ * @file Machine.hpp
+ *
+ * This module declares the Machine structure, which is the reference
+ * Intcode interpreter used by the Intcode tools.  It behaves exactly
+ * like the machines built into the individual puzzle solvers.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+/**
+ * This is the reference Intcode interpreter.
+ */
+struct Machine {
+    /**
+     * This is the position of the next instruction to execute.
+     */
+    size_t pos = 0;
+
+    /**
+     * This is the memory of the machine.
+     */
+    std::vector< intmax_t > numbers;
+
+    /**
+     * These are the values not yet consumed by input instructions.
+     */
+    std::vector< intmax_t > input;
+
+    /**
+     * This indicates whether or not the machine has executed
+     * a halt instruction.
+     */
+    bool halted = false;
+
+    /**
+     * This is the base added to the operands of relative-mode parameters.
+     */
+    intmax_t relativeBase = 0;
+
+    /**
+     * This is the number of instructions the machine has executed.
+     */
+    uint64_t instructions = 0;
+
+    /**
+     * This is the number of cells in each page of memory, as far as
+     * keeping track of which parts of memory have been written.
+     */
+    static constexpr size_t CELLS_PER_PAGE = 64;
+
+    /**
+     * If not empty, this marks which pages of memory have been written
+     * since it was last cleared, so that memory can be put back the way
+     * it was cheaply.  Only the pages it covers are tracked; the machine
+     * doesn't grow it as memory grows.
+     */
+    std::vector< bool > dirtyPages;
+
+    void ExpandToFit(size_t index) {
+        if (index >= numbers.size()) {
+            numbers.resize(index + 1);
+        }
+    }
+
+    size_t LoadIndex(
+        size_t pos,
+        int mode
+    ) {
+        switch (mode) {
+            case 0: { // position
+                const auto index = (size_t)numbers[pos];
+                return index;
+            } break;
+
+            case 2: { // relative
+                const auto offset = numbers[pos];
+                const auto index = (size_t)(relativeBase + offset);
+                return index;
+            } break;
+
+            default: {
+                (void)fprintf(stderr, "Invalid index mode for offset %zu\n", pos);
+                exit(1);
+            }
+        }
+        return 0;
+    }
+
+    intmax_t LoadArgument(
+        size_t pos,
+        int mode
+    ) {
+        switch (mode) {
+            case 0: { // position
+                const auto index = (size_t)numbers[pos];
+                ExpandToFit(index);
+                const auto arg = numbers[index];
+                return arg;
+            } break;
+
+            case 1: { // immediate
+                const auto arg = numbers[pos];
+                return arg;
+            } break;
+
+            case 2: { // relative
+                const auto offset = numbers[pos];
+                const auto index = (size_t)(relativeBase + offset);
+                ExpandToFit(index);
+                const auto arg = numbers[index];
+                return arg;
+            } break;
+
+            default: {
+                (void)fprintf(stderr, "Invalid argument mode for offset %zu\n", pos);
+                exit(1);
+            }
+        }
+        return 0;
+    }
+
+    void Store(
+        size_t index,
+        intmax_t value
+    ) {
+        ExpandToFit(index);
+        numbers[index] = value;
+        const auto page = index / CELLS_PER_PAGE;
+        if (page < dirtyPages.size()) {
+            dirtyPages[page] = true;
+        }
+    }
+
+    /**
+     * This method executes the next instruction, unless the machine
+     * has halted or needs input which hasn't been provided yet.
+     *
+     * @param[in,out] output
+     *     This is where to append any value output by the machine.
+     *
+     * @return
+     *     An indication of whether or not an instruction was executed
+     *     is returned.
+     */
+    bool Step(std::vector< intmax_t >& output) {
+        if (halted) {
+            return false;
+        }
+        const auto opcode = numbers[pos] % 100;
+        ++instructions;
+        switch (opcode) {
+            case 1: { // add
+                const auto arg1 = LoadArgument(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = LoadArgument(pos + 2, (numbers[pos] / 1000) % 10);
+                const auto index3 = LoadIndex(pos + 3, (numbers[pos] / 10000) % 10);
+                Store(index3, arg1 + arg2);
+                pos += 4;
+            } break;
+
+            case 2: { // multiply
+                const auto arg1 = LoadArgument(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = LoadArgument(pos + 2, (numbers[pos] / 1000) % 10);
+                const auto index3 = LoadIndex(pos + 3, (numbers[pos] / 10000) % 10);
+                Store(index3, arg1 * arg2);
+                pos += 4;
+            } break;
+
+            case 3: { // input
+                const auto index = LoadIndex(pos + 1, (numbers[pos] / 100) % 10);
+                if (input.empty()) {
+                    --instructions;
+                    return false;
+                }
+                const auto inputValue = input[0];
+                (void)input.erase(input.begin());
+                Store(index, inputValue);
+                pos += 2;
+            } break;
+
+            case 4: { // output
+                const auto outputValue = LoadArgument(pos + 1, (numbers[pos] / 100) % 10);
+                output.push_back(outputValue);
+                pos += 2;
+            } break;
+
+            case 5: { // jump-if-true
+                const auto arg1 = LoadArgument(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = (size_t)LoadArgument(pos + 2, (numbers[pos] / 1000) % 10);
+                if (arg1 != 0) {
+                    pos = arg2;
+                } else {
+                    pos += 3;
+                }
+            } break;
+
+            case 6: { // jump-if-false
+                const auto arg1 = LoadArgument(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = (size_t)LoadArgument(pos + 2, (numbers[pos] / 1000) % 10);
+                if (arg1 == 0) {
+                    pos = arg2;
+                } else {
+                    pos += 3;
+                }
+            } break;
+
+            case 7: { // less-than
+                const auto arg1 = LoadArgument(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = LoadArgument(pos + 2, (numbers[pos] / 1000) % 10);
+                const auto index3 = LoadIndex(pos + 3, (numbers[pos] / 10000) % 10);
+                Store(
+                    index3,
+                    (
+                        (arg1 < arg2)
+                        ? 1
+                        : 0
+                    )
+                );
+                pos += 4;
+            } break;
+
+            case 8: { // equals
+                const auto arg1 = LoadArgument(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = LoadArgument(pos + 2, (numbers[pos] / 1000) % 10);
+                const auto index3 = LoadIndex(pos + 3, (numbers[pos] / 10000) % 10);
+                Store(
+                    index3,
+                    (
+                        (arg1 == arg2)
+                        ? 1
+                        : 0
+                    )
+                );
+                pos += 4;
+            } break;
+
+            case 9: { // adjust relative base
+                const auto arg1 = LoadArgument(pos + 1, (numbers[pos] / 100) % 10);
+                relativeBase += arg1;
+                pos += 2;
+            } break;
+
+            case 99: { // stop
+                halted = true;
+            } break;
+
+            default: { // ERROR!!
+                (void)fprintf(stderr, "Invalid opcode (%" PRIdMAX ")\n", opcode);
+                exit(1);
+            } break;
+        }
+        return true;
+    }
+
+    /**
+     * This method runs the machine until it either halts or needs
+     * input which hasn't been provided yet.
+     *
+     * @param[in,out] output
+     *     This is where to append any values output by the machine.
+     */
+    void Run(std::vector< intmax_t >& output) {
+        while (Step(output)) {
+        }
+    }
+};
+
+#endif /* INTCODE_MACHINE_HPP */
@@ -0,0 +1,99 @@
+#ifndef INTCODE_MACHINE_POOL_HPP
+#define INTCODE_MACHINE_POOL_HPP
+
+/**
+ * @file MachinePool.hpp
+ *
+ * This module declares the MachinePool structure, which hands out
+ * reference Intcode machines loaded with a program, and takes them back
+ * to be reused, so that many short runs of the same program don't each
+ * pay for setting up a machine.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "Machine.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/**
+ * This is a pool of machines loaded with the same program.
+ */
+struct MachinePool {
+    /**
+     * This is the program loaded into the machines.  It shouldn't be
+     * changed once any machines have been handed out.
+     */
+    std::vector< intmax_t > image;
+
+    /**
+     * This is the amount of memory, in cells, to reserve in each
+     * machine, for programs which use memory past the end of their image.
+     */
+    size_t capacity = 0;
+
+    /**
+     * These are the machines not currently handed out.
+     */
+    std::vector< std::unique_ptr< Machine > > idle;
+
+    /**
+     * This hands out a machine loaded with the program, ready to run
+     * from the beginning, with no input.
+     *
+     * @return
+     *     The machine is returned.
+     */
+    std::unique_ptr< Machine > Acquire() {
+        if (idle.empty()) {
+            std::unique_ptr< Machine > machine(new Machine());
+            machine->numbers.reserve(std::max(capacity, image.size()));
+            machine->numbers = image;
+            machine->dirtyPages.resize(
+                (image.size() + Machine::CELLS_PER_PAGE - 1) / Machine::CELLS_PER_PAGE
+            );
+            return machine;
+        }
+        auto machine = std::move(idle.back());
+        idle.pop_back();
+        return machine;
+    }
+
+    /**
+     * This takes back a machine handed out by the pool, putting it back
+     * in its initial state.  Only the pages of memory written by the
+     * program are restored from the image, and the machine keeps its
+     * memory and input buffers, so that reusing it doesn't allocate
+     * any memory.
+     *
+     * @param[in] machine
+     *     This is the machine to take back.
+     */
+    void Release(std::unique_ptr< Machine > machine) {
+        auto& dirtyPages = machine->dirtyPages;
+        machine->numbers.resize(image.size());
+        for (size_t page = 0; page < dirtyPages.size(); ++page) {
+            if (!dirtyPages[page]) {
+                continue;
+            }
+            const auto begin = page * Machine::CELLS_PER_PAGE;
+            const auto end = std::min(begin + Machine::CELLS_PER_PAGE, image.size());
+            (void)std::copy(
+                image.begin() + begin,
+                image.begin() + end,
+                machine->numbers.begin() + begin
+            );
+            dirtyPages[page] = false;
+        }
+        machine->input.clear();
+        machine->pos = 0;
+        machine->halted = false;
+        machine->relativeBase = 0;
+        machine->instructions = 0;
+        idle.push_back(std::move(machine));
+    }
+};
+
+#endif /* INTCODE_MACHINE_POOL_HPP */
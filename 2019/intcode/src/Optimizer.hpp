@@ -0,0 +1,1022 @@
+#ifndef INTCODE_OPTIMIZER_HPP
+#define INTCODE_OPTIMIZER_HPP
+
+/**
+ * @file Optimizer.hpp
+ *
+ * This module declares the Optimizer structure, which rewrites Intcode
+ * programs so that they do less work on any machine, without changing
+ * what they compute.
+ *
+ * The optimizer never moves instructions, since there's no way to tell
+ * in general which numbers in a program are addresses.  Instead it
+ * rewrites operands in place, clears cells which can never be executed
+ * or read, and trims cells from the end of the program which are never
+ * used at all.
+ *
+ * The rewrites only save memory reads and cells; they don't remove
+ * instructions, so programs run the same number of instructions as
+ * before.  Most of the puzzle programs can't be optimized at all:
+ * 5-x modifies its own instructions, 2-x runs on operands patched by
+ * the host, and the rest copy or index data by writing computed
+ * addresses into the operands of their own instructions, which leaves
+ * no cell known never to be written.  Only the 9-x and 19-x programs
+ * are changed, and only with the well-behaved assumption.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "Assembler.hpp"
+
+#include <algorithm>
+#include <inttypes.h>
+#include <map>
+#include <set>
+#include <vector>
+
+/**
+ * This rewrites Intcode programs so that they do less work.
+ */
+struct Optimizer {
+    /**
+     * These are the settings which control the optimizer.
+     */
+    struct Options {
+        /**
+         * If set, the optimizer assumes that relative-mode parameters
+         * never access cells of the program itself (the stack lives
+         * beyond the end of the program), and that jumps which don't
+         * use immediate operands only target addresses computed from
+         * immediate operands alone (such as return addresses pushed
+         * onto the stack), never landing inside other instructions.
+         * Without these assumptions, the optimizer can't do anything
+         * with programs that use relative-mode parameters to write
+         * memory or jump.
+         */
+        bool assumeWellBehaved = false;
+
+        /**
+         * These are the positions of any cells which the host
+         * modifies before running the program, or inspects afterwards.
+         */
+        std::set< size_t > hostCells;
+
+        /**
+         * This enables replacing position-mode reads of cells never
+         * written with immediate operands.
+         */
+        bool substituteImmediates = true;
+
+        /**
+         * This enables replacing position-mode reads of cells holding
+         * values known from earlier stores with immediate operands.
+         */
+        bool propagateConstants = true;
+
+        /**
+         * This enables retargeting jumps to unconditional jumps
+         * so that they go straight to the final destination.
+         */
+        bool threadJumps = true;
+
+        /**
+         * This enables clearing cells which are never executed
+         * or read, and trimming unused cells from the end.
+         */
+        bool removeDeadCode = true;
+    };
+
+    /**
+     * This holds information about what the optimizer did.
+     */
+    struct Report {
+        /**
+         * This indicates whether or not the program has jumps
+         * which don't use immediate operands.
+         */
+        bool indirectJumps = false;
+
+        /**
+         * This indicates whether or not the program may modify
+         * its own instructions.
+         */
+        bool selfModifying = false;
+
+        /**
+         * This indicates whether or not the optimizer had to give up
+         * because it couldn't tell which cells might be executed,
+         * read, or written.
+         */
+        bool unanalyzable = false;
+
+        /**
+         * This is the number of times the passes were run.
+         */
+        size_t rounds = 0;
+
+        /**
+         * This is the number of position-mode reads of cells never
+         * written that were replaced with immediate operands.
+         */
+        size_t immediatesSubstituted = 0;
+
+        /**
+         * This is the number of position-mode reads of cells holding
+         * known values that were replaced with immediate operands.
+         */
+        size_t constantsPropagated = 0;
+
+        /**
+         * This is the number of jumps retargeted to skip
+         * unconditional jumps.
+         */
+        size_t jumpsThreaded = 0;
+
+        /**
+         * This is the number of non-zero cells cleared because they
+         * are never executed or read.
+         */
+        size_t cellsCleared = 0;
+
+        /**
+         * This is the number of unused cells trimmed from the end
+         * of the program.
+         */
+        size_t cellsTrimmed = 0;
+    };
+
+    /**
+     * This holds what is known about which cells of a program
+     * may be executed, read, or written.
+     */
+    struct Analysis {
+        /**
+         * These are all the instructions which may be executed,
+         * by position.
+         */
+        std::map< size_t, Instruction > instructions;
+
+        /**
+         * These are the positions of instructions which may be
+         * reached by jumps that don't use immediate operands.
+         */
+        std::set< size_t > indirectTargets;
+
+        /**
+         * These are the positions in the program computed by
+         * instructions from immediate operands alone, or loaded from
+         * written cells by jumps.  They are the possible targets of
+         * indirect jumps.
+         */
+        std::set< size_t > candidates;
+
+        /**
+         * This holds, for each cell, the number of instructions
+         * which include the cell.
+         */
+        std::vector< int > owners;
+
+        /**
+         * This indicates, for each cell, whether or not it may be
+         * read as data.
+         */
+        std::vector< bool > read;
+
+        /**
+         * This indicates, for each cell, whether or not it may be
+         * written.
+         */
+        std::vector< bool > written;
+
+        /**
+         * This indicates whether or not the program has jumps
+         * which don't use immediate operands.
+         */
+        bool indirectJumps = false;
+
+        /**
+         * This indicates whether or not any written cell is the first
+         * cell of an instruction which may be executed.
+         */
+        bool selfModifying = false;
+
+        /**
+         * This indicates whether or not the analysis failed to
+         * bound the cells which may be executed, read, or written.
+         */
+        bool unbounded = false;
+    };
+
+    /**
+     * This determines whether or not the given operand cell holds
+     * a value that can't change while the program runs.
+     *
+     * @param[in] analysis
+     *     This is what is known about the program.
+     *
+     * @param[in] cell
+     *     This is the position of the cell to check.
+     *
+     * @return
+     *     An indication of whether or not the cell holds
+     *     a constant value is returned.
+     */
+    static bool IsConstant(
+        const Analysis& analysis,
+        size_t cell
+    ) {
+        return !analysis.written[cell];
+    }
+
+    /**
+     * This finds the instructions which may be executed by the
+     * given program, and which cells the program may read or write.
+     *
+     * @param[in] numbers
+     *     This is the program to analyze.
+     *
+     * @param[in] options
+     *     These are the settings which control the optimizer.
+     *
+     * @param[in] candidates
+     *     These are the possible targets of indirect jumps found
+     *     by any earlier analysis of the program, before it was
+     *     rewritten.
+     *
+     * @return
+     *     What is known about the program is returned.
+     */
+    static Analysis Analyze(
+        const std::vector< intmax_t >& numbers,
+        const Options& options,
+        const std::set< size_t >& candidates
+    ) {
+        const auto size = numbers.size();
+        Analysis analysis;
+        analysis.written.resize(size);
+        for (auto cell: options.hostCells) {
+            if (cell < size) {
+                analysis.written[cell] = true;
+            }
+        }
+        for (;;) {
+            // Find all instructions which may be executed, given
+            // which cells are currently known to be written.
+            analysis.instructions.clear();
+            analysis.indirectTargets.clear();
+            analysis.indirectJumps = false;
+            analysis.candidates = candidates;
+            std::vector< size_t > unvisited;
+            unvisited.push_back(0);
+            for (;;) {
+                while (!unvisited.empty()) {
+                    const auto pos = unvisited.back();
+                    unvisited.pop_back();
+                    if (analysis.instructions.find(pos) != analysis.instructions.end()) {
+                        continue;
+                    }
+                    Instruction instruction;
+                    if (!DecodeInstruction(numbers, pos, instruction)) {
+                        // A machine will crash if it gets here, so
+                        // there is nowhere to go from here.  If there's
+                        // at least a cell here, keep it as it is.
+                        if (pos < size) {
+                            instruction.pos = pos;
+                            analysis.instructions[pos] = instruction;
+                        }
+                        continue;
+                    }
+                    analysis.instructions[pos] = instruction;
+                    const auto operation = instruction.operation;
+                    if (
+                        (
+                            (operation->opcode == 1)
+                            || (operation->opcode == 2)
+                        )
+                        && (instruction.modes[0] == 1)
+                        && (instruction.modes[1] == 1)
+                        && IsConstant(analysis, pos + 1)
+                        && IsConstant(analysis, pos + 2)
+                    ) {
+                        const auto value = (
+                            (operation->opcode == 1)
+                            ? instruction.operands[0] + instruction.operands[1]
+                            : instruction.operands[0] * instruction.operands[1]
+                        );
+                        if (
+                            (value >= 0)
+                            && ((size_t)value < size)
+                        ) {
+                            (void)analysis.candidates.insert((size_t)value);
+                        }
+                    }
+                    if (operation->opcode == 99) {
+                        continue;
+                    }
+                    if (!operation->jump) {
+                        unvisited.push_back(pos + instruction.Length());
+                        continue;
+                    }
+                    bool mayJump = true;
+                    bool mayContinue = true;
+                    if (
+                        (instruction.modes[0] == 1)
+                        && IsConstant(analysis, pos + 1)
+                    ) {
+                        const auto nonZero = (instruction.operands[0] != 0);
+                        if (operation->opcode == 5) {
+                            mayJump = nonZero;
+                        } else {
+                            mayJump = !nonZero;
+                        }
+                        mayContinue = !mayJump;
+                    }
+                    if (mayContinue) {
+                        unvisited.push_back(pos + instruction.Length());
+                    }
+                    if (!mayJump) {
+                        continue;
+                    }
+                    intmax_t target = -1;
+                    if (IsConstant(analysis, pos + 2)) {
+                        if (instruction.modes[1] == 1) {
+                            target = instruction.operands[1];
+                        } else if (
+                            (instruction.modes[1] == 0)
+                            && (instruction.operands[1] >= 0)
+                            && ((size_t)instruction.operands[1] < size)
+                            && IsConstant(analysis, (size_t)instruction.operands[1])
+                        ) {
+                            target = numbers[(size_t)instruction.operands[1]];
+                        } else {
+                            analysis.indirectJumps = true;
+                            if (
+                                (instruction.modes[1] == 0)
+                                && (instruction.operands[1] >= 0)
+                                && ((size_t)instruction.operands[1] < size)
+                            ) {
+                                const auto value = numbers[(size_t)instruction.operands[1]];
+                                if (
+                                    (value >= 0)
+                                    && ((size_t)value < size)
+                                ) {
+                                    (void)analysis.candidates.insert((size_t)value);
+                                }
+                            }
+                        }
+                    } else {
+                        analysis.indirectJumps = true;
+                    }
+                    if (target >= 0) {
+                        unvisited.push_back((size_t)target);
+                    }
+                }
+                if (!analysis.indirectJumps) {
+                    break;
+                }
+                if (!options.assumeWellBehaved) {
+                    analysis.unbounded = true;
+                    return analysis;
+                }
+                std::vector< bool > inside(size);
+                for (const auto& entry: analysis.instructions) {
+                    if (entry.second.operation != nullptr) {
+                        for (size_t i = 1; i < entry.second.Length(); ++i) {
+                            inside[entry.first + i] = true;
+                        }
+                    }
+                }
+                for (auto candidate: analysis.candidates) {
+                    Instruction instruction;
+                    if (
+                        !inside[candidate]
+                        && DecodeInstruction(numbers, candidate, instruction)
+                        && analysis.indirectTargets.insert(candidate).second
+                    ) {
+                        unvisited.push_back(candidate);
+                    }
+                }
+                if (unvisited.empty()) {
+                    break;
+                }
+            }
+
+            // Find all cells which may be read or written by the
+            // instructions found.
+            std::vector< bool > written(size);
+            analysis.read.assign(size, false);
+            analysis.owners.assign(size, 0);
+            for (auto cell: options.hostCells) {
+                if (cell < size) {
+                    written[cell] = true;
+                    analysis.read[cell] = true;
+                }
+            }
+            for (const auto& entry: analysis.instructions) {
+                const auto& instruction = entry.second;
+                const auto operation = instruction.operation;
+                ++analysis.owners[instruction.pos];
+                if (operation == nullptr) {
+                    continue;
+                }
+                for (size_t i = 0; i < operation->parameters; ++i) {
+                    const auto cell = instruction.pos + 1 + i;
+                    ++analysis.owners[cell];
+                    if (instruction.modes[i] == 1) {
+                        continue;
+                    }
+                    const auto isDestination = ((int)i == operation->destination);
+                    if (instruction.modes[i] == 2) {
+                        if (!options.assumeWellBehaved) {
+                            analysis.unbounded = true;
+                            return analysis;
+                        }
+                        continue;
+                    }
+                    if (!IsConstant(analysis, cell)) {
+                        analysis.unbounded = true;
+                        return analysis;
+                    }
+                    const auto address = instruction.operands[i];
+                    if (
+                        (address < 0)
+                        || ((size_t)address >= size)
+                    ) {
+                        continue;
+                    }
+                    if (isDestination) {
+                        written[(size_t)address] = true;
+                    } else {
+                        analysis.read[(size_t)address] = true;
+                    }
+                }
+            }
+            bool grew = false;
+            for (size_t cell = 0; cell < size; ++cell) {
+                if (written[cell] && !analysis.written[cell]) {
+                    analysis.written[cell] = true;
+                    grew = true;
+                }
+            }
+            if (!grew) {
+                break;
+            }
+        }
+        for (const auto& entry: analysis.instructions) {
+            if (analysis.written[entry.first]) {
+                analysis.selfModifying = true;
+                break;
+            }
+        }
+        return analysis;
+    }
+
+    /**
+     * This determines whether or not the given cell may be rewritten
+     * without changing what the program computes, other than how
+     * the one instruction using the cell behaves.
+     *
+     * @param[in] analysis
+     *     This is what is known about the program.
+     *
+     * @param[in] cell
+     *     This is the position of the cell to check.
+     *
+     * @return
+     *     An indication of whether or not the cell may be rewritten
+     *     is returned.
+     */
+    static bool IsRewritable(
+        const Analysis& analysis,
+        size_t cell
+    ) {
+        return (
+            (analysis.owners[cell] == 1)
+            && !analysis.read[cell]
+            && !analysis.written[cell]
+        );
+    }
+
+    /**
+     * This rewrites one position-mode read parameter of an instruction
+     * into an immediate-mode parameter having the given value.
+     *
+     * @param[in] analysis
+     *     This is what is known about the program.
+     *
+     * @param[in] instruction
+     *     This is the instruction to rewrite.
+     *
+     * @param[in] parameter
+     *     This is the index of the parameter to rewrite.
+     *
+     * @param[in] value
+     *     This is the value to give the parameter.
+     *
+     * @param[in,out] numbers
+     *     This is the program to modify.
+     *
+     * @return
+     *     An indication of whether or not the parameter
+     *     was rewritten is returned.
+     */
+    static bool MakeImmediate(
+        const Analysis& analysis,
+        const Instruction& instruction,
+        size_t parameter,
+        intmax_t value,
+        std::vector< intmax_t >& numbers
+    ) {
+        const auto cell = instruction.pos + 1 + parameter;
+        if (
+            !IsRewritable(analysis, instruction.pos)
+            || !IsRewritable(analysis, cell)
+        ) {
+            return false;
+        }
+        intmax_t modeScale = 100;
+        for (size_t i = 0; i < parameter; ++i) {
+            modeScale *= 10;
+        }
+        numbers[instruction.pos] += modeScale;
+        numbers[cell] = value;
+        return true;
+    }
+
+    /**
+     * This replaces position-mode reads of cells which are
+     * never written with immediate operands.
+     *
+     * @param[in] analysis
+     *     This is what is known about the program.
+     *
+     * @param[in,out] numbers
+     *     This is the program to modify.
+     *
+     * @return
+     *     The number of parameters rewritten is returned.
+     */
+    static size_t SubstituteImmediates(
+        const Analysis& analysis,
+        std::vector< intmax_t >& numbers
+    ) {
+        const auto original = numbers;
+        size_t rewritten = 0;
+        for (const auto& entry: analysis.instructions) {
+            const auto& instruction = entry.second;
+            const auto operation = instruction.operation;
+            if (operation == nullptr) {
+                continue;
+            }
+            for (size_t i = 0; i < operation->parameters; ++i) {
+                const auto address = instruction.operands[i];
+                if (
+                    (instruction.modes[i] != 0)
+                    || ((int)i == operation->destination)
+                    || (address < 0)
+                    || ((size_t)address >= original.size())
+                    || analysis.written[(size_t)address]
+                ) {
+                    continue;
+                }
+                if (MakeImmediate(analysis, instruction, i, original[(size_t)address], numbers)) {
+                    ++rewritten;
+                }
+            }
+        }
+        return rewritten;
+    }
+
+    /**
+     * This replaces position-mode reads of written cells with
+     * immediate operands, wherever the values of the cells are known
+     * on every path leading to the instruction reading them.
+     *
+     * @param[in] analysis
+     *     This is what is known about the program.
+     *
+     * @param[in] options
+     *     These are the settings which control the optimizer.
+     *
+     * @param[in,out] numbers
+     *     This is the program to modify.
+     *
+     * @return
+     *     The number of parameters rewritten is returned.
+     */
+    static size_t PropagateConstants(
+        const Analysis& analysis,
+        const Options& options,
+        std::vector< intmax_t >& numbers
+    ) {
+        typedef std::map< size_t, intmax_t > State;
+        const auto original = numbers;
+        const auto size = original.size();
+
+        // Determine the values of cells that are known on entry.
+        // Cells the host may modify aren't known at all, and nothing
+        // is known about written cells where indirect jumps land.
+        State entryState;
+        for (size_t cell = 0; cell < size; ++cell) {
+            if (
+                analysis.written[cell]
+                && (options.hostCells.find(cell) == options.hostCells.end())
+            ) {
+                entryState[cell] = original[cell];
+            }
+        }
+        std::map< size_t, State > states;
+        std::set< size_t > unvisited;
+        states[0] = entryState;
+        (void)unvisited.insert(0);
+        for (auto target: analysis.indirectTargets) {
+            states[target] = State();
+            (void)unvisited.insert(target);
+        }
+        const auto valueOf = [&](
+            const Instruction& instruction,
+            size_t parameter,
+            const State& state,
+            intmax_t& value
+        ) -> bool {
+            const auto operand = instruction.operands[parameter];
+            switch (instruction.modes[parameter]) {
+                case 0: {
+                    if (
+                        (operand < 0)
+                        || ((size_t)operand >= size)
+                    ) {
+                        return false;
+                    }
+                    if (!analysis.written[(size_t)operand]) {
+                        value = original[(size_t)operand];
+                        return true;
+                    }
+                    const auto known = state.find((size_t)operand);
+                    if (known == state.end()) {
+                        return false;
+                    }
+                    value = known->second;
+                    return true;
+                } break;
+
+                case 1: {
+                    if (!IsConstant(analysis, instruction.pos + 1 + parameter)) {
+                        return false;
+                    }
+                    value = operand;
+                    return true;
+                } break;
+
+                default: {
+                    return false;
+                } break;
+            }
+        };
+        const auto merge = [&](
+            size_t target,
+            const State& incoming
+        ){
+            const auto existing = states.find(target);
+            if (existing == states.end()) {
+                states[target] = incoming;
+                (void)unvisited.insert(target);
+                return;
+            }
+            auto& state = existing->second;
+            bool changed = false;
+            for (auto it = state.begin(); it != state.end(); ) {
+                const auto other = incoming.find(it->first);
+                if (
+                    (other == incoming.end())
+                    || (other->second != it->second)
+                ) {
+                    it = state.erase(it);
+                    changed = true;
+                } else {
+                    ++it;
+                }
+            }
+            if (changed) {
+                (void)unvisited.insert(target);
+            }
+        };
+
+        // Flow the known values through the program until
+        // nothing more changes.
+        while (!unvisited.empty()) {
+            const auto pos = *unvisited.begin();
+            (void)unvisited.erase(unvisited.begin());
+            const auto instructionEntry = analysis.instructions.find(pos);
+            if (
+                (instructionEntry == analysis.instructions.end())
+                || (instructionEntry->second.operation == nullptr)
+            ) {
+                continue;
+            }
+            const auto& instruction = instructionEntry->second;
+            const auto operation = instruction.operation;
+            auto state = states[pos];
+            intmax_t arg1 = 0;
+            intmax_t arg2 = 0;
+            const auto known1 = (
+                (operation->parameters >= 1)
+                && valueOf(instruction, 0, state, arg1)
+            );
+            const auto known2 = (
+                (operation->parameters >= 2)
+                && valueOf(instruction, 1, state, arg2)
+            );
+            if (operation->destination >= 0) {
+                const auto destination = (size_t)operation->destination;
+                if (instruction.modes[destination] == 0) {
+                    const auto address = instruction.operands[destination];
+                    if (
+                        (address >= 0)
+                        && ((size_t)address < size)
+                    ) {
+                        intmax_t result = 0;
+                        bool known = (known1 && known2);
+                        switch (operation->opcode) {
+                            case 1: result = arg1 + arg2; break;
+                            case 2: result = arg1 * arg2; break;
+                            case 7: result = ((arg1 < arg2) ? 1 : 0); break;
+                            case 8: result = ((arg1 == arg2) ? 1 : 0); break;
+                            default: known = false; break;
+                        }
+                        if (known) {
+                            state[(size_t)address] = result;
+                        } else {
+                            (void)state.erase((size_t)address);
+                        }
+                    }
+                }
+            }
+            if (operation->opcode == 99) {
+                continue;
+            }
+            if (!operation->jump) {
+                merge(pos + instruction.Length(), state);
+                continue;
+            }
+            bool mayJump = true;
+            bool mayContinue = true;
+            if (known1) {
+                mayJump = ((operation->opcode == 5) == (arg1 != 0));
+                mayContinue = !mayJump;
+            }
+            if (mayContinue) {
+                merge(pos + instruction.Length(), state);
+            }
+            if (
+                mayJump
+                && known2
+                && (arg2 >= 0)
+            ) {
+                merge((size_t)arg2, state);
+            }
+        }
+
+        // Rewrite every read of a cell whose value is known.
+        size_t rewritten = 0;
+        for (const auto& stateEntry: states) {
+            const auto instructionEntry = analysis.instructions.find(stateEntry.first);
+            if (
+                (instructionEntry == analysis.instructions.end())
+                || (instructionEntry->second.operation == nullptr)
+            ) {
+                continue;
+            }
+            const auto& instruction = instructionEntry->second;
+            const auto operation = instruction.operation;
+            for (size_t i = 0; i < operation->parameters; ++i) {
+                if (
+                    (instruction.modes[i] != 0)
+                    || ((int)i == operation->destination)
+                ) {
+                    continue;
+                }
+                const auto known = stateEntry.second.find((size_t)instruction.operands[i]);
+                if (
+                    (instruction.operands[i] < 0)
+                    || (known == stateEntry.second.end())
+                ) {
+                    continue;
+                }
+                if (MakeImmediate(analysis, instruction, i, known->second, numbers)) {
+                    ++rewritten;
+                }
+            }
+        }
+        return rewritten;
+    }
+
+    /**
+     * This determines whether or not the given instruction always
+     * jumps to a constant target.
+     *
+     * @param[in] analysis
+     *     This is what is known about the program.
+     *
+     * @param[in] instruction
+     *     This is the instruction to check.
+     *
+     * @return
+     *     An indication of whether or not the instruction always
+     *     jumps to a constant target is returned.
+     */
+    static bool IsUnconditionalJump(
+        const Analysis& analysis,
+        const Instruction& instruction
+    ) {
+        const auto operation = instruction.operation;
+        return (
+            (operation != nullptr)
+            && operation->jump
+            && (instruction.modes[0] == 1)
+            && (instruction.modes[1] == 1)
+            && ((operation->opcode == 5) == (instruction.operands[0] != 0))
+            && !analysis.written[instruction.pos]
+            && !analysis.written[instruction.pos + 1]
+            && !analysis.written[instruction.pos + 2]
+        );
+    }
+
+    /**
+     * This retargets jumps to unconditional jumps so that they go
+     * straight to the final destination.
+     *
+     * @param[in] analysis
+     *     This is what is known about the program.
+     *
+     * @param[in,out] numbers
+     *     This is the program to modify.
+     *
+     * @return
+     *     The number of jumps retargeted is returned.
+     */
+    static size_t ThreadJumps(
+        const Analysis& analysis,
+        std::vector< intmax_t >& numbers
+    ) {
+        size_t threaded = 0;
+        for (const auto& entry: analysis.instructions) {
+            const auto& instruction = entry.second;
+            const auto operation = instruction.operation;
+            if (
+                (operation == nullptr)
+                || !operation->jump
+                || (instruction.modes[1] != 1)
+                || !IsRewritable(analysis, instruction.pos + 2)
+            ) {
+                continue;
+            }
+            auto target = instruction.operands[1];
+            std::set< intmax_t > visited;
+            for (;;) {
+                if (!visited.insert(target).second) {
+                    break;
+                }
+                const auto next = analysis.instructions.find((size_t)target);
+                if (
+                    (target < 0)
+                    || (next == analysis.instructions.end())
+                    || !IsUnconditionalJump(analysis, next->second)
+                ) {
+                    break;
+                }
+                target = next->second.operands[1];
+            }
+            if (target != instruction.operands[1]) {
+                numbers[instruction.pos + 2] = target;
+                ++threaded;
+            }
+        }
+        return threaded;
+    }
+
+    /**
+     * This clears cells which are never executed or read,
+     * and trims unused cells from the end of the program.
+     *
+     * @param[in] analysis
+     *     This is what is known about the program.
+     *
+     * @param[in,out] numbers
+     *     This is the program to modify.
+     *
+     * @param[in,out] report
+     *     This is where to record what was done.
+     *
+     * @return
+     *     An indication of whether or not the program was changed
+     *     is returned.
+     */
+    static bool RemoveDeadCode(
+        const Analysis& analysis,
+        std::vector< intmax_t >& numbers,
+        Report& report
+    ) {
+        bool changed = false;
+        size_t end = 0;
+        for (size_t cell = 0; cell < numbers.size(); ++cell) {
+            const auto keep = (
+                (analysis.owners[cell] > 0)
+                || analysis.read[cell]
+            );
+            if (
+                keep
+                || analysis.written[cell]
+            ) {
+                end = cell + 1;
+            }
+            if (
+                !keep
+                && (numbers[cell] != 0)
+            ) {
+                numbers[cell] = 0;
+                ++report.cellsCleared;
+                changed = true;
+            }
+        }
+        if (end < numbers.size()) {
+            report.cellsTrimmed += numbers.size() - end;
+            numbers.resize(end);
+            changed = true;
+        }
+        return changed;
+    }
+
+    /**
+     * This optimizes the given Intcode program.
+     *
+     * @param[in] program
+     *     This is the program to optimize.
+     *
+     * @param[in] options
+     *     These are the settings which control the optimizer.
+     *
+     * @param[out] report
+     *     This is where to record what the optimizer did.
+     *
+     * @return
+     *     The optimized program is returned.
+     */
+    static std::vector< intmax_t > Optimize(
+        const std::vector< intmax_t >& program,
+        const Options& options,
+        Report& report
+    ) {
+        auto numbers = program;
+        std::set< size_t > candidates;
+        for (;;) {
+            const auto analysis = Analyze(numbers, options, candidates);
+            candidates = analysis.candidates;
+            report.indirectJumps = (report.indirectJumps || analysis.indirectJumps);
+            if (analysis.unbounded) {
+                report.unanalyzable = true;
+                break;
+            }
+            if (analysis.selfModifying) {
+                report.selfModifying = true;
+                break;
+            }
+            ++report.rounds;
+            size_t changes = 0;
+            if (options.substituteImmediates) {
+                const auto count = SubstituteImmediates(analysis, numbers);
+                report.immediatesSubstituted += count;
+                changes += count;
+            }
+            if (
+                (changes == 0)
+                && options.propagateConstants
+            ) {
+                const auto count = PropagateConstants(analysis, options, numbers);
+                report.constantsPropagated += count;
+                changes += count;
+            }
+            if (
+                (changes == 0)
+                && options.threadJumps
+            ) {
+                const auto count = ThreadJumps(analysis, numbers);
+                report.jumpsThreaded += count;
+                changes += count;
+            }
+            if (
+                (changes == 0)
+                && options.removeDeadCode
+                && RemoveDeadCode(analysis, numbers, report)
+            ) {
+                ++changes;
+            }
+            if (changes == 0) {
+                break;
+            }
+        }
+        return numbers;
+    }
+};
+
+#endif /* INTCODE_OPTIMIZER_HPP */
@@ -0,0 +1,495 @@
+#ifndef INTCODE_OPTIMIZING_MACHINE_HPP
+#define INTCODE_OPTIMIZING_MACHINE_HPP
+
+/**
+ * @file OptimizingMachine.hpp
+ *
+ * This module declares the OptimizingMachine structure, which is an
+ * Intcode interpreter that recognizes patterns in the code it runs
+ * and skips work it can prove makes no difference.  It produces
+ * exactly the same memory, output, and instruction count as the
+ * reference Machine.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "CallMemoizer.hpp"
+#include "LoopSummarizer.hpp"
+#include "Machine.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+/**
+ * This is the optimizing Intcode interpreter.
+ */
+struct OptimizingMachine: Machine {
+    /**
+     * This is the number of instructions to run before trying any
+     * optimizations, so that short runs don't pay for learning
+     * about the program.
+     */
+    uint64_t warmup = 10000;
+
+    /**
+     * This enables replacing simple counted loops with
+     * closed-form updates.
+     */
+    bool summarizeLoops = true;
+
+    /**
+     * This keeps track of the loops the machine has seen.
+     */
+    LoopSummarizer loops;
+
+    /**
+     * This enables replaying calls to pure functions made again
+     * with the same arguments.  Anything which modifies the code
+     * of the machine between runs should reset the memoizer.
+     */
+    bool memoizeCalls = true;
+
+    /**
+     * This keeps track of the calls the machine has made.
+     */
+    CallMemoizer calls;
+
+    /**
+     * This is the number of instructions memoizing calls is given
+     * to pay off, before checking whether any calls were replayed.
+     */
+    static const uint64_t MEMOIZE_CHECK = 1 << 17;
+
+    /**
+     * This is the number of instructions for which memoizing calls
+     * is paused the first time it doesn't pay off.  Each time in a row
+     * it doesn't pay off, it's paused for twice as long.
+     */
+    static const uint64_t MEMOIZE_PAUSE = 1 << 20;
+
+    /**
+     * This is the maximum number of times the pause in memoizing
+     * calls is doubled.
+     */
+    static const unsigned int MAX_MEMOIZE_PAUSES = 6;
+
+    /**
+     * This is the instruction count at which to next check whether
+     * memoizing calls is paying off, or zero before the first check
+     * is scheduled.
+     */
+    uint64_t memoizeCheck = 0;
+
+    /**
+     * This is the instruction count at which memoizing calls resumes,
+     * after being paused.
+     */
+    uint64_t memoizeFrom = 0;
+
+    /**
+     * This is the number of calls replayed as of the last check
+     * whether memoizing calls is paying off.
+     */
+    uint64_t callsSkippedAtCheck = 0;
+
+    /**
+     * This is the number of times in a row memoizing calls was paused.
+     */
+    unsigned int memoizePauses = 0;
+
+    /**
+     * This returns the number of cells in the instruction
+     * with the given opcode.
+     */
+    static size_t InstructionLength(intmax_t opcode) {
+        switch (opcode) {
+            case 1: case 2: case 7: case 8: return 4;
+            case 5: case 6: return 3;
+            case 3: case 4: case 9: return 2;
+            default: return 1;
+        }
+    }
+
+    /**
+     * This loads an argument of the current instruction.  When tracking,
+     * memory read from is logged for any call being recorded.
+     */
+    template< bool Tracking > intmax_t LoadArgument(
+        size_t pos,
+        int mode
+    ) {
+        const auto arg = Machine::LoadArgument(pos, mode);
+        if (
+            Tracking
+            && (mode != 1)
+            && calls.Recording()
+        ) {
+            calls.OnRead(
+                (
+                    (mode == 2)
+                    ? (size_t)(relativeBase + numbers[pos])
+                    : (size_t)numbers[pos]
+                ),
+                (mode == 2),
+                arg
+            );
+        }
+        return arg;
+    }
+
+    /**
+     * This stores a result of the current instruction.  When tracking,
+     * the write is passed to the memoizer, which both logs it for any
+     * call being recorded and watches for code being modified.
+     */
+    template< bool Tracking > void Store(
+        size_t index,
+        intmax_t value,
+        int mode
+    ) {
+        Machine::Store(index, value);
+        if (Tracking) {
+            calls.OnWrite(index, (mode == 2), value);
+        }
+    }
+
+    /**
+     * This determines whether or not to memoize calls at the moment.
+     * Memoizing calls costs something for every jump, so if no calls
+     * are replayed for a while, everything remembered is forgotten,
+     * and memoizing is paused.
+     *
+     * @return
+     *     An indication of whether or not to memoize calls is returned.
+     */
+    bool MemoizingCalls() {
+        if (
+            !memoizeCalls
+            || (instructions < memoizeFrom)
+        ) {
+            return false;
+        }
+        if (memoizeCheck == 0) {
+            memoizeCheck = instructions + MEMOIZE_CHECK;
+        } else if (instructions >= memoizeCheck) {
+            if (calls.callsSkipped != callsSkippedAtCheck) {
+                memoizePauses = 0;
+            } else if (!calls.Recording()) {
+                calls.Forget();
+                memoizeFrom = instructions + (MEMOIZE_PAUSE << memoizePauses);
+                if (memoizePauses < MAX_MEMOIZE_PAUSES) {
+                    ++memoizePauses;
+                }
+                memoizeCheck = memoizeFrom + MEMOIZE_CHECK;
+                return false;
+            }
+            memoizeCheck = instructions + MEMOIZE_CHECK;
+            callsSkippedAtCheck = calls.callsSkipped;
+        }
+        return true;
+    }
+
+    /**
+     * This is called whenever a jump is taken, to give the optimizations
+     * a chance to skip ahead.
+     *
+     * @param[in] jumpPos
+     *     This is the position of the jump instruction.
+     *
+     * @param[in] target
+     *     This is the position to which the jump goes.
+     */
+    void OnJump(
+        size_t jumpPos,
+        size_t target
+    ) {
+        pos = target;
+        if (instructions < warmup) {
+            return;
+        }
+        if (MemoizingCalls()) {
+            calls.OnJump(relativeBase, target, instructions);
+
+            // A jump with the address of the next instruction at [rb]
+            // is a call.
+            const auto returnAddress = jumpPos + 3;
+            if (
+                (relativeBase >= 0)
+                && ((size_t)relativeBase < numbers.size())
+                && (numbers[(size_t)relativeBase] == (intmax_t)returnAddress)
+                && (target != returnAddress)
+                && (target < numbers.size())
+                && calls.OnCall(numbers, (size_t)relativeBase, target, returnAddress, instructions)
+            ) {
+                pos = returnAddress;
+                return;
+            }
+        }
+        if (
+            summarizeLoops
+            && (target <= jumpPos)
+            && loops.TrySummarize(numbers, relativeBase, target, jumpPos, instructions)
+        ) {
+            pos = jumpPos + 3;
+
+            // The summary went around the log of any calls in progress,
+            // and may have written to the code of remembered functions.
+            if (memoizeCalls) {
+                calls.Abort();
+                for (const auto cell: loops.lastWritten) {
+                    calls.OnWrite(cell, false, numbers[cell]);
+                }
+            }
+        }
+    }
+
+    /**
+     * This method executes the next instruction, either with or without
+     * the bookkeeping needed for memoizing calls.
+     *
+     * @param[in,out] output
+     *     This is where to append any value output by the machine.
+     *
+     * @return
+     *     An indication of whether or not an instruction was executed
+     *     is returned.
+     */
+    template< bool Tracking > bool Step(std::vector< intmax_t >& output) {
+        if (halted) {
+            return false;
+        }
+        const auto opcode = numbers[pos] % 100;
+        ++instructions;
+        if (
+            Tracking
+            && calls.Recording()
+        ) {
+            calls.OnInstruction(pos, InstructionLength(opcode));
+        }
+        switch (opcode) {
+            case 1: { // add
+                const auto arg1 = LoadArgument< Tracking >(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = LoadArgument< Tracking >(pos + 2, (numbers[pos] / 1000) % 10);
+                const auto mode3 = (int)((numbers[pos] / 10000) % 10);
+                const auto index3 = LoadIndex(pos + 3, mode3);
+                Store< Tracking >(index3, arg1 + arg2, mode3);
+                pos += 4;
+            } break;
+
+            case 2: { // multiply
+                const auto arg1 = LoadArgument< Tracking >(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = LoadArgument< Tracking >(pos + 2, (numbers[pos] / 1000) % 10);
+                const auto mode3 = (int)((numbers[pos] / 10000) % 10);
+                const auto index3 = LoadIndex(pos + 3, mode3);
+                Store< Tracking >(index3, arg1 * arg2, mode3);
+                pos += 4;
+            } break;
+
+            case 3: { // input
+                const auto mode = (int)((numbers[pos] / 100) % 10);
+                const auto index = LoadIndex(pos + 1, mode);
+                if (input.empty()) {
+                    --instructions;
+                    calls.Abort();
+                    return false;
+                }
+                const auto inputValue = input[0];
+                (void)input.erase(input.begin());
+                calls.OnInputOutput();
+                Store< Tracking >(index, inputValue, mode);
+                pos += 2;
+            } break;
+
+            case 4: { // output
+                const auto outputValue = LoadArgument< Tracking >(pos + 1, (numbers[pos] / 100) % 10);
+                output.push_back(outputValue);
+                calls.OnInputOutput();
+                pos += 2;
+            } break;
+
+            case 5: { // jump-if-true
+                const auto arg1 = LoadArgument< Tracking >(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = (size_t)LoadArgument< Tracking >(pos + 2, (numbers[pos] / 1000) % 10);
+                if (arg1 != 0) {
+                    OnJump(pos, arg2);
+                } else {
+                    pos += 3;
+                }
+            } break;
+
+            case 6: { // jump-if-false
+                const auto arg1 = LoadArgument< Tracking >(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = (size_t)LoadArgument< Tracking >(pos + 2, (numbers[pos] / 1000) % 10);
+                if (arg1 == 0) {
+                    OnJump(pos, arg2);
+                } else {
+                    pos += 3;
+                }
+            } break;
+
+            case 7: { // less-than
+                const auto arg1 = LoadArgument< Tracking >(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = LoadArgument< Tracking >(pos + 2, (numbers[pos] / 1000) % 10);
+                const auto mode3 = (int)((numbers[pos] / 10000) % 10);
+                const auto index3 = LoadIndex(pos + 3, mode3);
+                Store< Tracking >(
+                    index3,
+                    (
+                        (arg1 < arg2)
+                        ? 1
+                        : 0
+                    ),
+                    mode3
+                );
+                pos += 4;
+            } break;
+
+            case 8: { // equals
+                const auto arg1 = LoadArgument< Tracking >(pos + 1, (numbers[pos] / 100) % 10);
+                const auto arg2 = LoadArgument< Tracking >(pos + 2, (numbers[pos] / 1000) % 10);
+                const auto mode3 = (int)((numbers[pos] / 10000) % 10);
+                const auto index3 = LoadIndex(pos + 3, mode3);
+                Store< Tracking >(
+                    index3,
+                    (
+                        (arg1 == arg2)
+                        ? 1
+                        : 0
+                    ),
+                    mode3
+                );
+                pos += 4;
+            } break;
+
+            case 9: { // adjust relative base
+                const auto arg1 = LoadArgument< Tracking >(pos + 1, (numbers[pos] / 100) % 10);
+                relativeBase += arg1;
+                pos += 2;
+            } break;
+
+            case 99: { // stop
+                halted = true;
+                calls.OnInputOutput();
+            } break;
+
+            default: { // ERROR!!
+                (void)fprintf(stderr, "Invalid opcode (%" PRIdMAX ")\n", opcode);
+                exit(1);
+            } break;
+        }
+        return true;
+    }
+
+    /**
+     * This method executes the next instruction, unless the machine
+     * has halted or needs input which hasn't been provided yet.  If the
+     * instruction is a jump, the optimizations may skip past any number
+     * of the instructions which follow it.
+     *
+     * @param[in,out] output
+     *     This is where to append any value output by the machine.
+     *
+     * @return
+     *     An indication of whether or not an instruction was executed
+     *     is returned.
+     */
+    bool Step(std::vector< intmax_t >& output) {
+        // Reads only matter while a call is being recorded, but writes
+        // matter as long as any code is known, in case it's modified.
+        if (
+            memoizeCalls
+            && (
+                calls.Recording()
+                || !calls.codeCells.empty()
+            )
+        ) {
+            return Step< true >(output);
+        } else {
+            return Step< false >(output);
+        }
+    }
+
+    /**
+     * This method runs the machine until it either halts or needs
+     * input which hasn't been provided yet.
+     *
+     * @param[in,out] output
+     *     This is where to append any values output by the machine.
+     */
+    void Run(std::vector< intmax_t >& output) {
+        // Until the warmup is over, none of the optimizations are tried,
+        // so unless there's code to watch for being modified, the
+        // machine does nothing the reference machine doesn't.
+        if (
+            !calls.Recording()
+            && calls.codeCells.empty()
+        ) {
+            while (instructions < warmup) {
+                if (!Machine::Step(output)) {
+                    return;
+                }
+            }
+        }
+        for (;;) {
+            if (
+                memoizeCalls
+                && (
+                    calls.Recording()
+                    || !calls.codeCells.empty()
+                )
+            ) {
+                if (!Step< true >(output)) {
+                    return;
+                }
+                continue;
+            }
+
+            // Nothing needs tracking until a call is recorded.
+            do {
+                if (!Step< false >(output)) {
+                    return;
+                }
+            } while (!calls.Recording());
+        }
+    }
+
+    /**
+     * This method puts the machine back into its initial state, with
+     * the given program loaded and no input.  What the machine learned
+     * about the program in previous runs is kept, unless the code it
+     * learned about differs from the given program.
+     *
+     * @param[in] program
+     *     This is the program to load into the machine.
+     */
+    void Restart(const std::vector< intmax_t >& program) {
+        calls.Abort();
+        for (size_t i = 0; i < calls.codeCells.size(); ++i) {
+            if (
+                calls.codeCells[i]
+                && (
+                    (i >= numbers.size())
+                    || (i >= program.size())
+                    || (numbers[i] != program[i])
+                )
+            ) {
+                calls.Reset();
+                break;
+            }
+        }
+        numbers.assign(program.begin(), program.end());
+        input.clear();
+        pos = 0;
+        halted = false;
+        relativeBase = 0;
+        instructions = 0;
+        memoizeCheck = 0;
+        memoizeFrom = 0;
+        callsSkippedAtCheck = calls.callsSkipped;
+        memoizePauses = 0;
+    }
+};
+
+#endif /* INTCODE_OPTIMIZING_MACHINE_HPP */
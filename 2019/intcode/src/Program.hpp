@@ -0,0 +1,123 @@
+#ifndef INTCODE_PROGRAM_HPP
+#define INTCODE_PROGRAM_HPP
+
+/**
+ * @file Program.hpp
+ *
+ * This module declares the functions used by the Intcode tools
+ * to load and save Intcode programs in their textual form.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <fstream>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/**
+ * This function parses the next comma-delimited number
+ * from the given input string.
+ *
+ * @param[in] input
+ *     This is the string from which to parse the number.
+ *
+ * @param[in,out] pos
+ *     This is the position in the input at which to begin parsing.
+ *     On return, it's updated to be just past the delimiter
+ *     following the number.
+ *
+ * @return
+ *     The number parsed is returned.
+ */
+inline intmax_t GetNextNumber(
+    const std::string& input,
+    size_t& pos
+) {
+    auto delimiter = input.find(',', pos);
+    if (delimiter == std::string::npos) {
+        delimiter = input.length();
+    }
+    intmax_t number;
+    if (sscanf(input.substr(pos, delimiter - pos).c_str(), "%" SCNdMAX, &number) != 1) {
+        (void)fprintf(stderr, "Bad input detected at position %zu\n", pos);
+        exit(1);
+    }
+    pos = delimiter + 1;
+    return number;
+}
+
+/**
+ * This function parses an Intcode program from its textual form.
+ *
+ * @param[in] line
+ *     This is the comma-delimited text of the program.
+ *
+ * @return
+ *     The numbers making up the program are returned.
+ */
+inline std::vector< intmax_t > ParseProgram(const std::string& line) {
+    size_t pos = 0;
+    const auto inputLength = line.length();
+    std::vector< intmax_t > numbers;
+    while (pos < inputLength) {
+        const auto number = GetNextNumber(line, pos);
+        numbers.push_back(number);
+    }
+    return numbers;
+}
+
+/**
+ * This function reads an Intcode program from the file at the given path.
+ *
+ * @param[in] path
+ *     This is the path of the file holding the program.
+ *
+ * @return
+ *     The numbers making up the program are returned.
+ */
+inline std::vector< intmax_t > ReadProgram(const std::string& path) {
+    std::ifstream input(path);
+    if (!input) {
+        (void)fprintf(stderr, "Unable to open '%s'\n", path.c_str());
+        exit(1);
+    }
+    std::string line;
+    (void)std::getline(input, line);
+    while (
+        !line.empty()
+        && (
+            (line.back() == '\r')
+            || (line.back() == ' ')
+        )
+    ) {
+        line.pop_back();
+    }
+    return ParseProgram(line);
+}
+
+/**
+ * This function formats an Intcode program into its textual form.
+ *
+ * @param[in] numbers
+ *     These are the numbers making up the program.
+ *
+ * @return
+ *     The comma-delimited text of the program is returned.
+ */
+inline std::string FormatProgram(const std::vector< intmax_t >& numbers) {
+    std::string line;
+    char buffer[32];
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        if (i > 0) {
+            line += ',';
+        }
+        (void)snprintf(buffer, sizeof(buffer), "%" PRIdMAX, numbers[i]);
+        line += buffer;
+    }
+    return line;
+}
+
+#endif /* INTCODE_PROGRAM_HPP */
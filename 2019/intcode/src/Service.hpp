@@ -0,0 +1,203 @@
+#ifndef INTCODE_SERVICE_HPP
+#define INTCODE_SERVICE_HPP
+
+/**
+ * @file Service.hpp
+ *
+ * This module declares what the Intcode daemon and its clients share:
+ * where the daemon listens by default, and how the lines of its
+ * protocol are sent and received.
+ *
+ * The protocol is line-oriented text over a Unix domain socket.
+ * The requests are:
+ *
+ *     LOAD <name>              load the program in the given file
+ *                              of the daemon's programs directory
+ *     PROGRAM <numbers>        load the given comma-delimited program
+ *     RUN <id> [<inputs>]      run a loaded program on the given
+ *                              comma-delimited inputs
+ *
+ * The responses are:
+ *
+ *     ID <id>                              a program was loaded
+ *     OUT <job> <value>                    a job output a value
+ *     DONE <job> <state> <instructions>    a job halted or needs input
+ *     FAILED <job> <message>               a job couldn't be run
+ *     ERROR <message>                      a request couldn't be handled
+ *
+ * Programs are identified by a hash of their numbers, so loading the
+ * same program again gives the same ID without storing it twice.  Each
+ * RUN request on a connection starts a job, numbered from zero in the
+ * order the requests were received.  Jobs are run in parallel, so the
+ * responses of different jobs may be interleaved, but the responses of
+ * any one job are in order, and DONE or FAILED is always its last.
+ *
+ * A job fails if it executes an invalid instruction, accesses memory
+ * too far out, or runs too many instructions.  LOAD only works if the
+ * daemon was given a directory of programs, and the daemon only keeps
+ * so many programs loaded and jobs queued at once.  It also serves only
+ * so many connections at once, and answers a request line which is too
+ * long with ERROR, and then stops reading from that connection.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <errno.h>
+#include <string>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * This is the path of the socket on which the daemon listens,
+ * unless told otherwise.
+ */
+constexpr const char* DEFAULT_SOCKET_PATH = "/tmp/aoc_intcode.sock";
+
+/**
+ * This function sets up the address of a Unix domain socket.
+ *
+ * @param[in] path
+ *     This is the path of the socket.
+ *
+ * @param[out] address
+ *     This is where to store the address.
+ *
+ * @return
+ *     An indication of whether or not the path fits in the address
+ *     is returned.
+ */
+inline bool MakeSocketAddress(
+    const std::string& path,
+    sockaddr_un& address
+) {
+    (void)memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.length() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    (void)memcpy(address.sun_path, path.c_str(), path.length());
+    return true;
+}
+
+/**
+ * This function sends all the given data to a socket.
+ *
+ * @param[in] fd
+ *     This is the socket to which to send the data.
+ *
+ * @param[in] data
+ *     This is the data to send.
+ *
+ * @return
+ *     An indication of whether or not all the data was sent
+ *     is returned.
+ */
+inline bool SendAll(
+    int fd,
+    const std::string& data
+) {
+    size_t done = 0;
+    while (done < data.length()) {
+        const auto sent = send(fd, data.data() + done, data.length() - done, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        done += (size_t)sent;
+    }
+    return true;
+}
+
+/**
+ * This breaks the data received from a socket into lines.
+ */
+struct LineReader {
+    /**
+     * This is the socket from which to receive data.
+     */
+    int fd = -1;
+
+    /**
+     * This holds data received but not yet returned as lines.
+     */
+    std::string buffer;
+
+    /**
+     * This is the position in the buffer of the next line.
+     */
+    size_t start = 0;
+
+    /**
+     * If non-zero, this is the length of the longest line accepted.
+     */
+    size_t maxLength = 0;
+
+    /**
+     * This indicates whether or not reading stopped because a line
+     * was longer than the longest line accepted.
+     */
+    bool tooLong = false;
+
+    /**
+     * This returns the next line received, without its line ending,
+     * waiting for it if necessary.
+     *
+     * @param[out] line
+     *     This is where to store the line.
+     *
+     * @return
+     *     An indication of whether or not a line was received is
+     *     returned.  If not, the socket was closed or broken, or the
+     *     line was too long, and any unterminated line at the end
+     *     is discarded.
+     */
+    bool ReadLine(std::string& line) {
+        for (;;) {
+            const auto end = buffer.find('\n', start);
+            const auto length = (
+                (end == std::string::npos)
+                ? buffer.length()
+                : end
+            ) - start;
+            if (
+                (maxLength > 0)
+                && (length > maxLength)
+            ) {
+                tooLong = true;
+                return false;
+            }
+            if (end != std::string::npos) {
+                line.assign(buffer, start, end - start);
+                if (
+                    !line.empty()
+                    && (line.back() == '\r')
+                ) {
+                    line.pop_back();
+                }
+                start = end + 1;
+                return true;
+            }
+            (void)buffer.erase(0, start);
+            start = 0;
+            char chunk[65536];
+            const auto received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            if (received == 0) {
+                return false;
+            }
+            (void)buffer.append(chunk, (size_t)received);
+        }
+    }
+};
+
+#endif /* INTCODE_SERVICE_HPP */
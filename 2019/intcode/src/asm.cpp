@@ -0,0 +1,245 @@
+/**
+ * @file asm.cpp
+ *
+ * This module holds the main() function of the Intcode assembler,
+ * disassembler, and optimizer.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "Assembler.hpp"
+#include "Machine.hpp"
+#include "Optimizer.hpp"
+#include "Program.hpp"
+
+#include <inttypes.h>
+#include <iostream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <crtdbg.h>
+#endif /* _WIN32 */
+
+namespace {
+
+    /**
+     * This function prints the usage of the program and exits.
+     */
+    void Usage() {
+        (void)fprintf(
+            stderr,
+            (
+                "Usage:\n"
+                "  aoc_intcode_asm disasm [PROGRAM]\n"
+                "  aoc_intcode_asm asm [LISTING]\n"
+                "  aoc_intcode_asm opt [OPTIONS] [PROGRAM]\n"
+                "\n"
+                "PROGRAM defaults to input.txt; LISTING defaults to standard input.\n"
+                "\n"
+                "Options for opt:\n"
+                "  -w, --well-behaved   assume relative-mode parameters never touch the\n"
+                "                       program, and indirect jumps only go to addresses\n"
+                "                       computed from immediate operands (return addresses)\n"
+                "  --host CELLS         comma-separated cells the host patches before\n"
+                "                       running the program or reads afterwards\n"
+                "  --check INPUTS       run the original and optimized programs with the\n"
+                "                       comma-separated inputs and compare their outputs\n"
+                "  --no-immediates      don't replace reads of unwritten cells\n"
+                "  --no-constants       don't propagate constants\n"
+                "  --no-threading       don't thread jumps\n"
+                "  --no-dead-code       don't clear or trim unused cells\n"
+            )
+        );
+        exit(1);
+    }
+
+    /**
+     * This function runs the given program on the reference machine.
+     *
+     * @param[in] numbers
+     *     This is the program to run.
+     *
+     * @param[in] input
+     *     These are the values to give the program as input.
+     *
+     * @param[out] halted
+     *     This is where to store whether or not the program halted.
+     *
+     * @return
+     *     The output of the program is returned.
+     */
+    std::vector< intmax_t > RunProgram(
+        const std::vector< intmax_t >& numbers,
+        const std::vector< intmax_t >& input,
+        bool& halted
+    ) {
+        Machine machine;
+        machine.numbers = numbers;
+        machine.input = input;
+        std::vector< intmax_t > output;
+        machine.Run(output);
+        halted = machine.halted;
+        return output;
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    //_crtBreakAlloc = 18;
+    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif /* _WIN32 */
+    if (argc < 2) {
+        Usage();
+    }
+    const std::string command = argv[1];
+
+    // Translate a program into assembly language.
+    if (command == "disasm") {
+        if (argc > 3) {
+            Usage();
+        }
+        const auto numbers = ReadProgram((argc == 3) ? argv[2] : "input.txt");
+        printf("%s", Disassemble(numbers).c_str());
+        return EXIT_SUCCESS;
+    }
+
+    // Translate assembly language into a program.
+    if (command == "asm") {
+        if (argc > 3) {
+            Usage();
+        }
+        std::string listing;
+        if (argc == 3) {
+            std::ifstream file(argv[2]);
+            if (!file) {
+                (void)fprintf(stderr, "Unable to open '%s'\n", argv[2]);
+                return EXIT_FAILURE;
+            }
+            listing.assign(
+                std::istreambuf_iterator< char >(file),
+                std::istreambuf_iterator< char >()
+            );
+        } else {
+            listing.assign(
+                std::istreambuf_iterator< char >(std::cin),
+                std::istreambuf_iterator< char >()
+            );
+        }
+        printf("%s\n", FormatProgram(Assemble(listing)).c_str());
+        return EXIT_SUCCESS;
+    }
+
+    // Optimize a program.
+    if (command != "opt") {
+        Usage();
+    }
+    Optimizer::Options options;
+    std::string path = "input.txt";
+    bool check = false;
+    std::vector< intmax_t > checkInput;
+    bool havePath = false;
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (
+            (arg == "-w")
+            || (arg == "--well-behaved")
+        ) {
+            options.assumeWellBehaved = true;
+        } else if (
+            (arg == "--host")
+            && (i + 1 < argc)
+        ) {
+            for (auto cell: ParseProgram(argv[++i])) {
+                (void)options.hostCells.insert((size_t)cell);
+            }
+        } else if (
+            (arg == "--check")
+            && (i + 1 < argc)
+        ) {
+            check = true;
+            checkInput = ParseProgram(argv[++i]);
+        } else if (arg == "--no-immediates") {
+            options.substituteImmediates = false;
+        } else if (arg == "--no-constants") {
+            options.propagateConstants = false;
+        } else if (arg == "--no-threading") {
+            options.threadJumps = false;
+        } else if (arg == "--no-dead-code") {
+            options.removeDeadCode = false;
+        } else if (
+            !havePath
+            && (arg[0] != '-')
+        ) {
+            path = arg;
+            havePath = true;
+        } else {
+            Usage();
+        }
+    }
+    const auto numbers = ReadProgram(path);
+    Optimizer::Report report;
+    const auto optimized = Optimizer::Optimize(numbers, options, report);
+    printf("%s\n", FormatProgram(optimized).c_str());
+    (void)fprintf(
+        stderr,
+        (
+            "Cells: %zu -> %zu (%zu trimmed, %zu cleared)\n"
+            "Immediates substituted: %zu\n"
+            "Constants propagated: %zu\n"
+            "Jumps threaded: %zu\n"
+            "Rounds: %zu\n"
+        ),
+        numbers.size(), optimized.size(), report.cellsTrimmed, report.cellsCleared,
+        report.immediatesSubstituted,
+        report.constantsPropagated,
+        report.jumpsThreaded,
+        report.rounds
+    );
+    if (report.unanalyzable) {
+        (void)fprintf(
+            stderr,
+            "Warning: couldn't tell which cells the program uses; %s\n",
+            (
+                options.assumeWellBehaved
+                ? "it computes addresses or modifies its own operands"
+                : "try --well-behaved if it only uses relative mode for its stack"
+            )
+        );
+    }
+    if (report.selfModifying) {
+        (void)fprintf(stderr, "Warning: program modifies its own instructions; left as-is\n");
+    }
+
+    // Optionally make sure the optimized program computes
+    // the same thing as the original.
+    if (check) {
+        bool originalHalted = false;
+        bool optimizedHalted = false;
+        const auto originalOutput = RunProgram(numbers, checkInput, originalHalted);
+        const auto optimizedOutput = RunProgram(optimized, checkInput, optimizedHalted);
+        if (
+            (originalOutput != optimizedOutput)
+            || (originalHalted != optimizedHalted)
+        ) {
+            (void)fprintf(stderr, "Check FAILED: optimized program behaves differently\n");
+            return EXIT_FAILURE;
+        }
+        (void)fprintf(stderr, "Check passed (%zu outputs)\n", originalOutput.size());
+    }
+    return EXIT_SUCCESS;
+}
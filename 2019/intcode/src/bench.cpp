@@ -0,0 +1,601 @@
+/**
+ * @file bench.cpp
+ *
+ * This module holds the main() function of the Intcode benchmark, which
+ * runs a fixed corpus of programs on the Intcode machines and reports
+ * how fast they ran, in JSON, so that results can be compared across
+ * commits.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "Assembler.hpp"
+#include "Machine.hpp"
+#include "MachinePool.hpp"
+#include "OptimizingMachine.hpp"
+#include "Program.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <inttypes.h>
+#include <map>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <crtdbg.h>
+#endif /* _WIN32 */
+
+#ifndef AOC_2019_DIR
+#define AOC_2019_DIR "."
+#endif /* AOC_2019_DIR */
+
+namespace {
+
+    /**
+     * This counts the memory allocations made by the program.
+     */
+    uint64_t allocations = 0;
+
+}
+
+/**
+ * These replace every form of the global allocation and deallocation
+ * functions, so that allocations can be counted, and every form of
+ * deallocation matches the allocation it frees.  Both are kept out of
+ * line, since otherwise GCC sees memory from operator new being
+ * given to free (or memory from malloc being given to operator delete)
+ * wherever they are inlined into the same function, and warns about the
+ * mismatch.
+ */
+#ifdef __GNUC__
+#define NOINLINE __attribute__((noinline))
+#else
+#define NOINLINE
+#endif /* __GNUC__ */
+
+NOINLINE void* operator new(size_t size) {
+    ++allocations;
+    const auto memory = malloc((size == 0) ? 1 : size);
+    if (memory == NULL) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+NOINLINE void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    operator delete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+namespace {
+
+    /**
+     * This program spends its time in counted loops: one which can be
+     * summarized in closed form, and one which can't, both nested in an
+     * outer loop.  It takes the trip count of the loops as input.
+     */
+    const char* const LOOP_HEAVY_LISTING = (
+        "    in [n]\n"
+        "    add [n], 0, [i]\n"
+        "outer:\n"
+        "    add [n], 0, [j]\n"
+        "inner:\n"
+        "    add [sum], [j], [sum]\n"
+        "    add [j], -1, [j]\n"
+        "    jnz [j], inner\n"
+        "    add [n], 0, [j]\n"
+        "toggle:\n"
+        "    eq [t], 0, [t]\n"
+        "    add [count], [t], [count]\n"
+        "    add [j], -1, [j]\n"
+        "    jnz [j], toggle\n"
+        "    add [i], -1, [i]\n"
+        "    jnz [i], outer\n"
+        "    out [sum]\n"
+        "    out [count]\n"
+        "    hlt\n"
+        "n:\n"
+        "    .data 0\n"
+        "i:\n"
+        "    .data 0\n"
+        "j:\n"
+        "    .data 0\n"
+        "t:\n"
+        "    .data 0\n"
+        "sum:\n"
+        "    .data 0\n"
+        "count:\n"
+        "    .data 0\n"
+    );
+
+    /**
+     * This program spends its time sweeping the relative base over
+     * a large area of memory, filling it in and then adding it up.
+     * It takes the size of the area and the number of sweeps as input.
+     */
+    const char* const MEMORY_HEAVY_LISTING = (
+        "    in [n]\n"
+        "    in [passes]\n"
+        "    arb stack\n"
+        "pass:\n"
+        "    add [n], 0, [i]\n"
+        "fill:\n"
+        "    mul [i], 7, [rb+0]\n"
+        "    arb 1\n"
+        "    add [i], -1, [i]\n"
+        "    jnz [i], fill\n"
+        "    add [n], 0, [i]\n"
+        "sum:\n"
+        "    arb -1\n"
+        "    add [total], [rb+0], [total]\n"
+        "    add [i], -1, [i]\n"
+        "    jnz [i], sum\n"
+        "    add [passes], -1, [passes]\n"
+        "    jnz [passes], pass\n"
+        "    out [total]\n"
+        "    hlt\n"
+        "n:\n"
+        "    .data 0\n"
+        "passes:\n"
+        "    .data 0\n"
+        "i:\n"
+        "    .data 0\n"
+        "total:\n"
+        "    .data 0\n"
+        "stack:\n"
+        "    .data 0\n"
+    );
+
+    /**
+     * This function prints the usage of the program and exits.
+     */
+    void Usage() {
+        (void)fprintf(
+            stderr,
+            (
+                "Usage: aoc_intcode_bench [OPTIONS]\n"
+                "\n"
+                "Options:\n"
+                "  --root DIR        directory holding the 2019 puzzles\n"
+                "                    (default " AOC_2019_DIR ")\n"
+                "  --warmup N        untimed runs of each benchmark (default 1)\n"
+                "  --reps N          timed runs of each benchmark (default 5)\n"
+                "  --engine ENGINE   reference, optimized, pooled, or all (default all)\n"
+                "  --only NAME       only run benchmarks whose names contain NAME\n"
+            )
+        );
+        exit(1);
+    }
+
+    /**
+     * This is one run of a program, from the beginning, with
+     * the given input.
+     */
+    struct Job {
+        const std::vector< intmax_t >* numbers = nullptr;
+        std::vector< intmax_t > input;
+    };
+
+    /**
+     * This is a named set of jobs which are timed together.
+     */
+    struct Benchmark {
+        std::string name;
+        std::vector< Job > jobs;
+    };
+
+    /**
+     * This is what was measured for a benchmark on one engine.
+     */
+    struct Result {
+        uint64_t instructions = 0;
+        double seconds = 0.0;
+        uint64_t allocations = 0;
+        intmax_t checksum = 0;
+    };
+
+    /**
+     * This function runs all the jobs of the given benchmark once,
+     * on the given kind of machine.
+     *
+     * @param[in] benchmark
+     *     This is the benchmark to run.
+     *
+     * @return
+     *     What was measured is returned.
+     */
+    template< typename MachineType > Result RunBenchmark(const Benchmark& benchmark) {
+        Result result;
+        const auto allocationsBefore = allocations;
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& job: benchmark.jobs) {
+            MachineType machine;
+            machine.numbers = *job.numbers;
+            machine.input = job.input;
+            std::vector< intmax_t > output;
+            machine.Run(output);
+            result.instructions += machine.instructions;
+            for (const auto value: output) {
+                result.checksum = result.checksum * 31 + value;
+            }
+        }
+        result.seconds = std::chrono::duration< double >(
+            std::chrono::steady_clock::now() - start
+        ).count();
+        result.allocations = allocations - allocationsBefore;
+        return result;
+    }
+
+    /**
+     * This stands in for a kind of machine, to run jobs on reference
+     * machines handed out by a pool for each program, rather than on
+     * new machines.
+     */
+    struct Pooled {
+    };
+
+    /**
+     * This function runs all the jobs of the given benchmark once,
+     * on machines handed out by pools.  The pools, and the buffer
+     * collecting output, are kept from one run of the benchmark to
+     * the next, so that only the first run sets them up.
+     *
+     * @param[in] benchmark
+     *     This is the benchmark to run.
+     *
+     * @return
+     *     What was measured is returned.
+     */
+    template<> Result RunBenchmark< Pooled >(const Benchmark& benchmark) {
+        static std::map< const std::vector< intmax_t >*, MachinePool > pools;
+        static std::vector< intmax_t > output;
+        Result result;
+        const auto allocationsBefore = allocations;
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& job: benchmark.jobs) {
+            auto& pool = pools[job.numbers];
+            if (pool.image.empty()) {
+                pool.image = *job.numbers;
+            }
+            auto machine = pool.Acquire();
+            machine->input.assign(job.input.begin(), job.input.end());
+            output.clear();
+            machine->Run(output);
+            result.instructions += machine->instructions;
+            for (const auto value: output) {
+                result.checksum = result.checksum * 31 + value;
+            }
+            pool.Release(std::move(machine));
+        }
+        result.seconds = std::chrono::duration< double >(
+            std::chrono::steady_clock::now() - start
+        ).count();
+        result.allocations = allocations - allocationsBefore;
+        return result;
+    }
+
+    /**
+     * This function runs the given benchmark repeatedly on the given
+     * kind of machine, and prints the results as a JSON object.
+     *
+     * @param[in] benchmark
+     *     This is the benchmark to run.
+     *
+     * @param[in] engine
+     *     This is the name of the kind of machine.
+     *
+     * @param[in] warmup
+     *     This is the number of untimed runs to make first.
+     *
+     * @param[in] reps
+     *     This is the number of timed runs to make.
+     *
+     * @param[in] first
+     *     This indicates whether or not this is the first result printed.
+     */
+    template< typename MachineType > void Measure(
+        const Benchmark& benchmark,
+        const char* engine,
+        size_t warmup,
+        size_t reps,
+        bool first
+    ) {
+        for (size_t i = 0; i < warmup; ++i) {
+            (void)RunBenchmark< MachineType >(benchmark);
+        }
+        std::vector< Result > results;
+        for (size_t i = 0; i < reps; ++i) {
+            results.push_back(RunBenchmark< MachineType >(benchmark));
+        }
+        std::sort(
+            results.begin(),
+            results.end(),
+            [](const Result& a, const Result& b) {
+                return a.seconds < b.seconds;
+            }
+        );
+        const auto& median = results[results.size() / 2];
+        const auto instructions = (double)median.instructions;
+        printf(
+            (
+                "%s    {\n"
+                "      \"name\": \"%s\",\n"
+                "      \"engine\": \"%s\",\n"
+                "      \"runs\": %zu,\n"
+                "      \"instructions\": %" PRIu64 ",\n"
+                "      \"checksum\": %" PRIdMAX ",\n"
+                "      \"seconds\": %.6f,\n"
+                "      \"min_seconds\": %.6f,\n"
+                "      \"instructions_per_second\": %.0f,\n"
+                "      \"ns_per_instruction\": %.3f,\n"
+                "      \"allocations_per_run\": %.2f\n"
+                "    }"
+            ),
+            (first ? "" : ",\n"),
+            benchmark.name.c_str(),
+            engine,
+            benchmark.jobs.size(),
+            median.instructions,
+            median.checksum,
+            median.seconds,
+            results.front().seconds,
+            instructions / median.seconds,
+            median.seconds * 1e9 / instructions,
+            (double)median.allocations / (double)benchmark.jobs.size()
+        );
+    }
+
+    /**
+     * This function plays the 13-2 breakout game with a simple player
+     * which keeps the paddle under the ball, and records the joystick
+     * input it gives, so that the game can be replayed without it.
+     *
+     * @param[in] numbers
+     *     This is the game program, with quarters already inserted.
+     *
+     * @return
+     *     The recorded joystick input is returned.
+     */
+    std::vector< intmax_t > RecordBreakout(const std::vector< intmax_t >& numbers) {
+        Machine machine;
+        machine.numbers = numbers;
+        std::vector< intmax_t > recording;
+        intmax_t ball = 0;
+        intmax_t paddle = 0;
+        while (!machine.halted) {
+            std::vector< intmax_t > output;
+            machine.Run(output);
+            for (size_t i = 0; i + 2 < output.size(); i += 3) {
+                if (output[i + 2] == 4) {
+                    ball = output[i];
+                } else if (output[i + 2] == 3) {
+                    paddle = output[i];
+                }
+            }
+            if (!machine.halted) {
+                const intmax_t joystick = (
+                    (paddle == ball)
+                    ? 0
+                    : (
+                        (paddle < ball)
+                        ? 1
+                        : -1
+                    )
+                );
+                machine.input.push_back(joystick);
+                recording.push_back(joystick);
+            }
+        }
+        return recording;
+    }
+
+    /**
+     * This function finds the left edge of the tractor beam in the given
+     * row, by probing from the left until the beam is found.
+     *
+     * @param[in] numbers
+     *     This is the tractor beam drone program.
+     *
+     * @param[in] y
+     *     This is the row in which to find the edge of the beam.
+     *
+     * @return
+     *     The column of the leftmost position in the beam is returned.
+     */
+    intmax_t FindBeamEdge(
+        const std::vector< intmax_t >& numbers,
+        intmax_t y
+    ) {
+        for (intmax_t x = 0;; ++x) {
+            Machine machine;
+            machine.numbers = numbers;
+            machine.input = {x, y};
+            std::vector< intmax_t > output;
+            machine.Run(output);
+            if (
+                !output.empty()
+                && (output[0] == 1)
+            ) {
+                return x;
+            }
+        }
+    }
+
+    /**
+     * This function adds a batch of tractor beam probes to the given
+     * benchmark, for the square area with the given corner and size.
+     */
+    void AddProbes(
+        Benchmark& benchmark,
+        const std::vector< intmax_t >& numbers,
+        intmax_t left,
+        intmax_t top,
+        intmax_t size
+    ) {
+        for (intmax_t y = top; y < top + size; ++y) {
+            for (intmax_t x = left; x < left + size; ++x) {
+                Job job;
+                job.numbers = &numbers;
+                job.input = {x, y};
+                benchmark.jobs.push_back(job);
+            }
+        }
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    //_crtBreakAlloc = 18;
+    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif /* _WIN32 */
+    std::string root = AOC_2019_DIR;
+    size_t warmup = 1;
+    size_t reps = 5;
+    std::string engine = "all";
+    std::string only;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage();
+        }
+        if (arg == "--root") {
+            root = argv[++i];
+        } else if (arg == "--warmup") {
+            warmup = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--reps") {
+            reps = std::max((size_t)1, (size_t)strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--engine") {
+            engine = argv[++i];
+            if (
+                (engine != "reference")
+                && (engine != "optimized")
+                && (engine != "pooled")
+                && (engine != "all")
+            ) {
+                Usage();
+            }
+        } else if (arg == "--only") {
+            only = argv[++i];
+        } else {
+            Usage();
+        }
+    }
+
+    // Load the programs in the corpus.
+    const auto boost = ReadProgram(root + "/9-2/example/input.txt");
+    auto breakout = ReadProgram(root + "/13-2/example/input.txt");
+    breakout[0] = 2;
+    const auto beam = ReadProgram(root + "/19-1/example/input.txt");
+    const auto loopHeavy = Assemble(LOOP_HEAVY_LISTING);
+    const auto memoryHeavy = Assemble(MEMORY_HEAVY_LISTING);
+
+    // Build the benchmarks.
+    std::vector< Benchmark > benchmarks;
+    Benchmark benchmark;
+    Job job;
+    benchmark.name = "9-2 BOOST";
+    job.numbers = &boost;
+    job.input = {2};
+    benchmark.jobs.assign(1, job);
+    benchmarks.push_back(benchmark);
+    benchmark.name = "13-2 breakout replay";
+    job.numbers = &breakout;
+    job.input = RecordBreakout(breakout);
+    benchmark.jobs.assign(1, job);
+    benchmarks.push_back(benchmark);
+    benchmark.name = "19-1 probes";
+    benchmark.jobs.clear();
+    AddProbes(benchmark, beam, 0, 0, 50);
+    benchmarks.push_back(benchmark);
+    benchmark.name = "19-2 far probes";
+    benchmark.jobs.clear();
+    AddProbes(benchmark, beam, FindBeamEdge(beam, 1000) - 25, 975, 50);
+    benchmarks.push_back(benchmark);
+    benchmark.name = "synthetic loop-heavy";
+    job.numbers = &loopHeavy;
+    job.input = {1000};
+    benchmark.jobs.assign(1, job);
+    benchmarks.push_back(benchmark);
+    benchmark.name = "synthetic memory-heavy";
+    job.numbers = &memoryHeavy;
+    job.input = {100000, 5};
+    benchmark.jobs.assign(1, job);
+    benchmarks.push_back(benchmark);
+
+    // Run the benchmarks and report the results.
+    printf(
+        (
+            "{\n"
+            "  \"warmup\": %zu,\n"
+            "  \"repetitions\": %zu,\n"
+            "  \"results\": [\n"
+        ),
+        warmup,
+        reps
+    );
+    bool first = true;
+    for (const auto& benchmark: benchmarks) {
+        if (benchmark.name.find(only) == std::string::npos) {
+            continue;
+        }
+        if (
+            (engine == "reference")
+            || (engine == "all")
+        ) {
+            Measure< Machine >(benchmark, "reference", warmup, reps, first);
+            first = false;
+        }
+        if (
+            (engine == "optimized")
+            || (engine == "all")
+        ) {
+            Measure< OptimizingMachine >(benchmark, "optimized", warmup, reps, first);
+            first = false;
+        }
+        if (
+            (engine == "pooled")
+            || (engine == "all")
+        ) {
+            Measure< Pooled >(benchmark, "pooled", warmup, reps, first);
+            first = false;
+        }
+    }
+    printf(
+        (
+            "\n"
+            "  ]\n"
+            "}\n"
+        )
+    );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,236 @@
+/**
+ * @file client.cpp
+ *
+ * This module holds the main() function of the Intcode client, which
+ * has the Intcode daemon run a program on one or more sets of inputs,
+ * and prints the outputs of each run on its own line.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "Program.hpp"
+#include "Service.hpp"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <crtdbg.h>
+#endif /* _WIN32 */
+
+namespace {
+
+    /**
+     * This holds what the daemon reported about one run.
+     */
+    struct Run {
+        /**
+         * These are the values output by the program.
+         */
+        std::vector< intmax_t > output;
+
+        /**
+         * This is the state in which the program finished,
+         * or why it couldn't be run.
+         */
+        std::string state;
+
+        /**
+         * This is the number of instructions the program executed.
+         */
+        uint64_t instructions = 0;
+    };
+
+    /**
+     * This function prints the usage of the program and exits.
+     */
+    void Usage() {
+        (void)fprintf(
+            stderr,
+            (
+                "Usage: aoc_intcode_client [OPTIONS] PROGRAM [INPUTS...]\n"
+                "\n"
+                "Each INPUTS is a comma-separated list, and is a separate run\n"
+                "of the program; with none, the program is run once with no input.\n"
+                "\n"
+                "Options:\n"
+                "  --socket PATH   connect to the daemon on the given socket (default: %s)\n"
+                "  --stats         report the state and instruction count of each run\n"
+                "                  on the standard error stream\n"
+            ),
+            DEFAULT_SOCKET_PATH
+        );
+        exit(1);
+    }
+
+    /**
+     * This function reports an unexpected response from the daemon
+     * and exits.
+     *
+     * @param[in] line
+     *     This is the response.
+     */
+    void Unexpected(const std::string& line) {
+        (void)fprintf(stderr, "Unexpected response from daemon: %s\n", line.c_str());
+        exit(1);
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    //_crtBreakAlloc = 18;
+    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif /* _WIN32 */
+    std::string socketPath = DEFAULT_SOCKET_PATH;
+    bool stats = false;
+    std::vector< std::string > positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (
+            (arg == "--socket")
+            && (i + 1 < argc)
+        ) {
+            socketPath = argv[++i];
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (
+            (arg[0] == '-')
+            && (arg.length() > 1)
+            && !isdigit((unsigned char)arg[1])
+        ) {
+            Usage();
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.empty()) {
+        Usage();
+    }
+    if (positional.size() == 1) {
+        positional.push_back("");
+    }
+    sockaddr_un address;
+    if (!MakeSocketAddress(socketPath, address)) {
+        (void)fprintf(stderr, "Socket path '%s' is too long\n", socketPath.c_str());
+        return EXIT_FAILURE;
+    }
+    const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (
+        (fd < 0)
+        || (connect(fd, (const sockaddr*)&address, sizeof(address)) != 0)
+    ) {
+        (void)fprintf(stderr, "Unable to connect to daemon at '%s'\n", socketPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // Send the program as text, so the daemon doesn't need to be able
+    // to read our files, then learn its ID.
+    const auto numbers = ReadProgram(positional[0]);
+    LineReader reader;
+    reader.fd = fd;
+    std::string line;
+    if (
+        !SendAll(fd, "PROGRAM " + FormatProgram(numbers) + "\n")
+        || !reader.ReadLine(line)
+    ) {
+        (void)fprintf(stderr, "Lost connection to daemon\n");
+        return EXIT_FAILURE;
+    }
+    if (line.compare(0, 3, "ID ") != 0) {
+        Unexpected(line);
+    }
+    const auto id = line.substr(3);
+
+    // Queue all the runs at once, so the daemon can run them in parallel.
+    std::string requests;
+    for (size_t i = 1; i < positional.size(); ++i) {
+        requests += "RUN " + id;
+        if (!positional[i].empty()) {
+            requests += " " + FormatProgram(ParseProgram(positional[i]));
+        }
+        requests += "\n";
+    }
+    if (!SendAll(fd, requests)) {
+        (void)fprintf(stderr, "Lost connection to daemon\n");
+        return EXIT_FAILURE;
+    }
+    (void)shutdown(fd, SHUT_WR);
+    std::vector< Run > runs(positional.size() - 1);
+    size_t remaining = runs.size();
+    while (
+        (remaining > 0)
+        && reader.ReadLine(line)
+    ) {
+        uint64_t job;
+        int consumed = 0;
+        char state[32];
+        if (line.compare(0, 4, "OUT ") == 0) {
+            intmax_t value;
+            if (
+                (sscanf(line.c_str() + 4, "%" SCNu64 " %" SCNdMAX, &job, &value) != 2)
+                || (job >= runs.size())
+            ) {
+                Unexpected(line);
+            }
+            runs[job].output.push_back(value);
+        } else if (line.compare(0, 5, "DONE ") == 0) {
+            uint64_t instructions;
+            if (
+                (sscanf(line.c_str() + 5, "%" SCNu64 " %31s %" SCNu64, &job, state, &instructions) != 3)
+                || (job >= runs.size())
+            ) {
+                Unexpected(line);
+            }
+            runs[job].state = state;
+            runs[job].instructions = instructions;
+            --remaining;
+        } else if (line.compare(0, 7, "FAILED ") == 0) {
+            if (
+                (sscanf(line.c_str() + 7, "%" SCNu64 " %n", &job, &consumed) != 1)
+                || (consumed == 0)
+                || (job >= runs.size())
+            ) {
+                Unexpected(line);
+            }
+            runs[job].state = "failed: " + line.substr(7 + (size_t)consumed);
+            --remaining;
+        } else {
+            Unexpected(line);
+        }
+    }
+    (void)close(fd);
+    if (remaining > 0) {
+        (void)fprintf(stderr, "Lost connection to daemon\n");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < runs.size(); ++i) {
+        printf("%s\n", FormatProgram(runs[i].output).c_str());
+        if (stats) {
+            (void)fprintf(
+                stderr,
+                "Run %zu: %s, %" PRIu64 " instructions\n",
+                i + 1,
+                runs[i].state.c_str(),
+                runs[i].instructions
+            );
+        }
+    }
+    return EXIT_SUCCESS;
+}
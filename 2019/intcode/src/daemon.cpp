@@ -0,0 +1,782 @@
+/**
+ * @file daemon.cpp
+ *
+ * This module holds the main() function of the Intcode daemon, which
+ * keeps parsed programs resident and runs jobs on them for clients
+ * connecting over a Unix domain socket, so that repeated runs don't
+ * pay for starting a process, parsing the program, or setting up a
+ * machine.  See Service.hpp for the protocol.
+ *
+ * Clients aren't trusted: a job which executes an invalid instruction,
+ * strays too far in memory, or runs too long fails, without disturbing
+ * the daemon or any other job.  Only the user running the daemon may
+ * connect to it, and it only loads files from the directory it's told
+ * to, if any.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "Assembler.hpp"
+#include "OptimizingMachine.hpp"
+#include "Service.hpp"
+
+#include <condition_variable>
+#include <ctype.h>
+#include <deque>
+#include <fstream>
+#include <inttypes.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is the amount of output a job buffers before
+     * sending it to its client.
+     */
+    constexpr size_t OUTPUT_BUFFER_SIZE = 65536;
+
+    /**
+     * This is the highest cell address a job may use before it fails,
+     * which keeps runaway addresses from exhausting memory.
+     */
+    constexpr intmax_t MEMORY_LIMIT = 1 << 24;
+
+    /**
+     * This is the number of instructions a job may execute before
+     * it fails, unless told otherwise.
+     */
+    constexpr uint64_t DEFAULT_MAX_STEPS = 1000000000;
+
+    /**
+     * This is the most programs the daemon keeps loaded at once.
+     */
+    constexpr size_t MAX_PROGRAMS = 1024;
+
+    /**
+     * This is the most jobs which may be waiting for a worker at once.
+     */
+    constexpr size_t MAX_QUEUED_JOBS = 4096;
+
+    /**
+     * This is the most clients the daemon serves at once.
+     */
+    constexpr size_t MAX_CONNECTIONS = 64;
+
+    /**
+     * This is the longest request line the daemon accepts, which is
+     * plenty for the text of any puzzle program.
+     */
+    constexpr size_t MAX_LINE_LENGTH = 1 << 20;
+
+    /**
+     * This is a connection from a client of the daemon.
+     */
+    struct Connection {
+        /**
+         * This is the socket connected to the client.
+         */
+        int fd = -1;
+
+        /**
+         * This serializes the responses sent by jobs running
+         * in parallel.
+         */
+        std::mutex sendMutex;
+
+        /**
+         * This indicates whether or not sending to the client failed,
+         * in which case jobs for it may as well stop.
+         */
+        bool broken = false;
+
+        ~Connection() {
+            (void)close(fd);
+        }
+
+        /**
+         * This sends the given lines to the client.
+         *
+         * @param[in] lines
+         *     These are the lines to send.
+         *
+         * @return
+         *     An indication of whether or not the client is still
+         *     connected is returned.
+         */
+        bool Send(const std::string& lines) {
+            std::lock_guard< std::mutex > lock(sendMutex);
+            if (
+                !broken
+                && !SendAll(fd, lines)
+            ) {
+                broken = true;
+            }
+            return !broken;
+        }
+    };
+
+    /**
+     * This is a request to run a program.
+     */
+    struct Job {
+        /**
+         * This is the connection on which the job was requested.
+         */
+        std::shared_ptr< Connection > connection;
+
+        /**
+         * This is the number of the job on its connection.
+         */
+        uint64_t number = 0;
+
+        /**
+         * This is the program to run.
+         */
+        std::shared_ptr< const std::vector< intmax_t > > program;
+
+        /**
+         * This is the input to give the program.
+         */
+        std::vector< intmax_t > input;
+    };
+
+    /**
+     * This holds the state shared by all the threads of the daemon.
+     */
+    struct Service {
+        /**
+         * This protects the other members.
+         */
+        std::mutex mutex;
+
+        /**
+         * This is signaled whenever a job is queued.
+         */
+        std::condition_variable jobQueued;
+
+        /**
+         * These are the jobs waiting for a worker.
+         */
+        std::deque< Job > jobs;
+
+        /**
+         * These are the programs loaded, keyed by their hashes.
+         */
+        std::map< uint64_t, std::shared_ptr< const std::vector< intmax_t > > > programs;
+
+        /**
+         * If not empty, this is the directory from which programs
+         * may be loaded by name.
+         */
+        std::string programsDirectory;
+
+        /**
+         * This is the number of instructions a job may execute
+         * before it fails.
+         */
+        uint64_t maxSteps = DEFAULT_MAX_STEPS;
+
+        /**
+         * This is the number of clients whose requests are being read.
+         */
+        size_t connections = 0;
+    };
+
+    /**
+     * This function prints the usage of the program and exits.
+     */
+    void Usage() {
+        (void)fprintf(
+            stderr,
+            (
+                "Usage: aoc_intcode_daemon [OPTIONS]\n"
+                "\n"
+                "Options:\n"
+                "  --socket PATH     listen on the given socket (default: %s)\n"
+                "  --workers N       number of jobs to run at once (default: one per CPU)\n"
+                "  --programs DIR    allow LOAD of the program files in DIR\n"
+                "  --max-steps N     instructions a job may execute (default: %" PRIu64 ")\n"
+            ),
+            DEFAULT_SOCKET_PATH,
+            DEFAULT_MAX_STEPS
+        );
+        exit(1);
+    }
+
+    /**
+     * This function parses comma-delimited numbers, without giving up
+     * on the whole daemon if they're malformed.
+     *
+     * @param[in] text
+     *     This is the text to parse.
+     *
+     * @param[out] numbers
+     *     This is where to store the numbers parsed.
+     *
+     * @return
+     *     An indication of whether or not the text was well-formed
+     *     is returned.
+     */
+    bool TryParseNumbers(
+        const std::string& text,
+        std::vector< intmax_t >& numbers
+    ) {
+        numbers.clear();
+        const char* next = text.c_str();
+        while (isspace((unsigned char)*next)) {
+            ++next;
+        }
+        if (*next == '\0') {
+            return true;
+        }
+        for (;;) {
+            char* end;
+            errno = 0;
+            const auto number = strtoimax(next, &end, 10);
+            if (
+                (end == next)
+                || (errno != 0)
+            ) {
+                return false;
+            }
+            numbers.push_back(number);
+            next = end;
+            while (isspace((unsigned char)*next)) {
+                ++next;
+            }
+            if (*next == '\0') {
+                return true;
+            }
+            if (*next != ',') {
+                return false;
+            }
+            ++next;
+        }
+    }
+
+    /**
+     * This function computes the hash which identifies a program.
+     *
+     * @param[in] numbers
+     *     These are the numbers making up the program.
+     *
+     * @return
+     *     The hash of the program is returned.
+     */
+    uint64_t HashProgram(const std::vector< intmax_t >& numbers) {
+        // FNV-1a, over the bytes of each number, least significant first.
+        uint64_t hash = 14695981039346656037ULL;
+        for (const auto number: numbers) {
+            auto value = (uintmax_t)number;
+            for (size_t i = 0; i < sizeof(value); ++i) {
+                hash ^= (value & 0xFF);
+                hash *= 1099511628211ULL;
+                value >>= 8;
+            }
+        }
+        return hash;
+    }
+
+    /**
+     * This function handles a request to load a program.
+     *
+     * @param[in,out] service
+     *     This is the state shared by the threads of the daemon.
+     *
+     * @param[in] text
+     *     This is the textual form of the program.
+     *
+     * @return
+     *     The response to the request is returned.
+     */
+    std::string LoadProgram(
+        Service& service,
+        const std::string& text
+    ) {
+        std::vector< intmax_t > numbers;
+        if (
+            !TryParseNumbers(text, numbers)
+            || numbers.empty()
+        ) {
+            return "ERROR malformed program\n";
+        }
+        const auto id = HashProgram(numbers);
+        {
+            std::lock_guard< std::mutex > lock(service.mutex);
+            if (
+                (service.programs.size() >= MAX_PROGRAMS)
+                && (service.programs.find(id) == service.programs.end())
+            ) {
+                return "ERROR too many programs loaded\n";
+            }
+            auto& program = service.programs[id];
+            if (program == nullptr) {
+                program = std::make_shared< const std::vector< intmax_t > >(std::move(numbers));
+            }
+        }
+        char buffer[32];
+        (void)snprintf(buffer, sizeof(buffer), "ID %016" PRIx64 "\n", id);
+        return buffer;
+    }
+
+    /**
+     * This function handles a request to load a program from a file.
+     * Only files directly inside the programs directory may be loaded,
+     * so that clients can't have the daemon read anything else.
+     *
+     * @param[in,out] service
+     *     This is the state shared by the threads of the daemon.
+     *
+     * @param[in] name
+     *     This is the name of the file in the programs directory.
+     *
+     * @return
+     *     The response to the request is returned.
+     */
+    std::string LoadProgramFile(
+        Service& service,
+        const std::string& name
+    ) {
+        if (service.programsDirectory.empty()) {
+            return "ERROR LOAD is disabled; send the program with PROGRAM instead\n";
+        }
+        if (
+            name.empty()
+            || (name[0] == '.')
+            || (name.find('/') != std::string::npos)
+        ) {
+            return "ERROR invalid program name '" + name + "'\n";
+        }
+        std::ifstream file(service.programsDirectory + "/" + name);
+        std::string text;
+        if (
+            !file
+            || !std::getline(file, text)
+        ) {
+            return "ERROR unable to read '" + name + "'\n";
+        }
+        return LoadProgram(service, text);
+    }
+
+    /**
+     * This function handles a request to run a program, by queuing
+     * a job for the workers.
+     *
+     * @param[in,out] service
+     *     This is the state shared by the threads of the daemon.
+     *
+     * @param[in] connection
+     *     This is the connection on which the job was requested.
+     *
+     * @param[in] number
+     *     This is the number of the job on its connection.
+     *
+     * @param[in] arguments
+     *     These are the program ID and inputs given for the job.
+     *
+     * @return
+     *     The response to the request is returned, if the job
+     *     couldn't be queued.  Otherwise, an empty string is returned,
+     *     and the worker running the job will respond.
+     */
+    std::string QueueJob(
+        Service& service,
+        const std::shared_ptr< Connection >& connection,
+        uint64_t number,
+        const std::string& arguments
+    ) {
+        Job job;
+        job.connection = connection;
+        job.number = number;
+        const auto delimiter = arguments.find(' ');
+        const auto idText = arguments.substr(0, delimiter);
+        char* end;
+        const auto id = (uint64_t)strtoull(idText.c_str(), &end, 16);
+        const char* problem = nullptr;
+        if (
+            idText.empty()
+            || (*end != '\0')
+        ) {
+            problem = "malformed program ID";
+        } else if (
+            (delimiter != std::string::npos)
+            && !TryParseNumbers(arguments.substr(delimiter + 1), job.input)
+        ) {
+            problem = "malformed inputs";
+        } else {
+            std::lock_guard< std::mutex > lock(service.mutex);
+            const auto program = service.programs.find(id);
+            if (program == service.programs.end()) {
+                problem = "unknown program ID";
+            } else if (service.jobs.size() >= MAX_QUEUED_JOBS) {
+                problem = "too many jobs queued";
+            } else {
+                job.program = program->second;
+                service.jobs.push_back(std::move(job));
+                service.jobQueued.notify_one();
+            }
+        }
+        if (problem == nullptr) {
+            return "";
+        }
+        char buffer[64];
+        (void)snprintf(buffer, sizeof(buffer), "FAILED %" PRIu64 " %s\n", number, problem);
+        return buffer;
+    }
+
+    /**
+     * This function reads and handles the requests of one client,
+     * until the client disconnects.
+     *
+     * @param[in,out] service
+     *     This is the state shared by the threads of the daemon.
+     *
+     * @param[in] connection
+     *     This is the connection to the client.
+     */
+    void Serve(
+        Service& service,
+        std::shared_ptr< Connection > connection
+    ) {
+        LineReader reader;
+        reader.fd = connection->fd;
+        reader.maxLength = MAX_LINE_LENGTH;
+        std::string line;
+        uint64_t jobs = 0;
+        while (reader.ReadLine(line)) {
+            const auto delimiter = line.find(' ');
+            const auto command = line.substr(0, delimiter);
+            const auto arguments = (
+                (delimiter == std::string::npos)
+                ? std::string()
+                : line.substr(delimiter + 1)
+            );
+            std::string response;
+            if (command == "LOAD") {
+                response = LoadProgramFile(service, arguments);
+            } else if (command == "PROGRAM") {
+                response = LoadProgram(service, arguments);
+            } else if (command == "RUN") {
+                response = QueueJob(service, connection, jobs++, arguments);
+            } else if (!command.empty()) {
+                response = "ERROR unknown request '" + command + "'\n";
+            }
+            if (
+                !response.empty()
+                && !connection->Send(response)
+            ) {
+                break;
+            }
+        }
+
+        if (reader.tooLong) {
+            (void)connection->Send("ERROR request too long\n");
+        }
+
+        // Let the client know we're done with its requests; the
+        // connection is closed once its last job is done.
+        (void)shutdown(connection->fd, SHUT_RD);
+        std::lock_guard< std::mutex > lock(service.mutex);
+        --service.connections;
+    }
+
+    /**
+     * This function checks whether the machine can safely execute its
+     * next instruction, which is the case unless the instruction is
+     * invalid or would access memory beyond the limit.
+     *
+     * @param[in] machine
+     *     This is the machine to check.
+     *
+     * @return
+     *     Why the machine can't continue is returned, or nullptr
+     *     if it can.
+     */
+    const char* CheckNextInstruction(const Machine& machine) {
+        Instruction instruction;
+        if (!DecodeInstruction(machine.numbers, machine.pos, instruction)) {
+            return "invalid instruction";
+        }
+        for (size_t i = 0; i < instruction.operation->parameters; ++i) {
+            intmax_t address;
+            if (instruction.modes[i] == 0) {
+                address = instruction.operands[i];
+            } else if (instruction.modes[i] == 2) {
+                address = machine.relativeBase + instruction.operands[i];
+            } else {
+                continue;
+            }
+            if (
+                (address < 0)
+                || (address >= MEMORY_LIMIT)
+            ) {
+                return "memory access out of bounds";
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * This function runs one job on the given machine, sending its
+     * outputs to the client as they accumulate.
+     *
+     * @param[in,out] service
+     *     This is the state shared by the threads of the daemon.
+     *
+     * @param[in,out] machine
+     *     This is the machine on which to run the job.
+     *
+     * @param[in,out] job
+     *     This is the job to run.
+     *
+     * @param[in,out] response
+     *     This holds the responses not yet sent to the client.
+     *
+     * @return
+     *     Why the job failed is returned, or nullptr if it didn't.
+     */
+    const char* RunJob(
+        Service& service,
+        OptimizingMachine& machine,
+        Job& job,
+        std::string& response
+    ) {
+        std::vector< intmax_t > output;
+        char buffer[64];
+        machine.Restart(*job.program);
+        machine.input.swap(job.input);
+        while (!machine.halted) {
+            const auto problem = CheckNextInstruction(machine);
+            if (problem != nullptr) {
+                return problem;
+            }
+            if (machine.instructions >= service.maxSteps) {
+                return "step limit reached";
+            }
+            if (!machine.Step(output)) {
+                break;
+            }
+            if (output.empty()) {
+                continue;
+            }
+            for (const auto value: output) {
+                (void)snprintf(
+                    buffer,
+                    sizeof(buffer),
+                    "OUT %" PRIu64 " %" PRIdMAX "\n",
+                    job.number,
+                    value
+                );
+                response += buffer;
+            }
+            output.clear();
+            if (response.length() >= OUTPUT_BUFFER_SIZE) {
+                if (!job.connection->Send(response)) {
+                    return "client disconnected";
+                }
+                response.clear();
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * This function runs jobs as they're queued, forever.  Each worker
+     * keeps its own machine, so that a program run again on the same
+     * worker reuses its memory and what was learned about the program.
+     *
+     * @param[in,out] service
+     *     This is the state shared by the threads of the daemon.
+     */
+    void Work(Service& service) {
+        OptimizingMachine machine;
+        std::shared_ptr< const std::vector< intmax_t > > loaded;
+        std::string response;
+        char buffer[128];
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock< std::mutex > lock(service.mutex);
+                while (service.jobs.empty()) {
+                    service.jobQueued.wait(lock);
+                }
+                job = std::move(service.jobs.front());
+                service.jobs.pop_front();
+            }
+            if (job.program != loaded) {
+                machine.loops = LoopSummarizer();
+                machine.calls.Reset();
+                loaded = job.program;
+            }
+            response.clear();
+            const char* problem;
+            try {
+                problem = RunJob(service, machine, job, response);
+            } catch (const std::bad_alloc&) {
+                problem = "out of memory";
+            }
+            if (problem == nullptr) {
+                (void)snprintf(
+                    buffer,
+                    sizeof(buffer),
+                    "DONE %" PRIu64 " %s %" PRIu64 "\n",
+                    job.number,
+                    machine.halted ? "halted" : "needs-input",
+                    machine.instructions
+                );
+            } else {
+                // Whatever the machine learned about the program may
+                // be incomplete, so don't trust it for the next job.
+                loaded = nullptr;
+                (void)snprintf(
+                    buffer,
+                    sizeof(buffer),
+                    "FAILED %" PRIu64 " %s\n",
+                    job.number,
+                    problem
+                );
+            }
+            response += buffer;
+            (void)job.connection->Send(response);
+        }
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    std::string socketPath = DEFAULT_SOCKET_PATH;
+    size_t workers = std::thread::hardware_concurrency();
+    Service service;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (
+            (arg == "--socket")
+            && (i + 1 < argc)
+        ) {
+            socketPath = argv[++i];
+        } else if (
+            (arg == "--workers")
+            && (i + 1 < argc)
+        ) {
+            workers = (size_t)strtoul(argv[++i], NULL, 10);
+            if (workers == 0) {
+                Usage();
+            }
+        } else if (
+            (arg == "--programs")
+            && (i + 1 < argc)
+        ) {
+            service.programsDirectory = argv[++i];
+            if (service.programsDirectory.empty()) {
+                Usage();
+            }
+        } else if (
+            (arg == "--max-steps")
+            && (i + 1 < argc)
+        ) {
+            service.maxSteps = (uint64_t)strtoull(argv[++i], NULL, 10);
+            if (service.maxSteps == 0) {
+                Usage();
+            }
+        } else {
+            Usage();
+        }
+    }
+    if (workers == 0) {
+        workers = 1;
+    }
+    sockaddr_un address;
+    if (!MakeSocketAddress(socketPath, address)) {
+        (void)fprintf(stderr, "Socket path '%s' is too long\n", socketPath.c_str());
+        return EXIT_FAILURE;
+    }
+    const auto listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket");
+        return EXIT_FAILURE;
+    }
+
+    // Only replace a socket left behind by an earlier daemon, never
+    // some other file which happens to be in the way.
+    struct stat existing;
+    if (lstat(socketPath.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            (void)fprintf(stderr, "'%s' exists and is not a socket\n", socketPath.c_str());
+            return EXIT_FAILURE;
+        }
+        (void)unlink(socketPath.c_str());
+    }
+
+    // Only the user running the daemon may connect to it.  The socket
+    // is created without permissions for anyone else, so there's no
+    // moment when they could connect before it's locked down.
+    const auto mask = umask(0177);
+    const auto bound = bind(listener, (const sockaddr*)&address, sizeof(address));
+    (void)umask(mask);
+    if (bound != 0) {
+        perror("bind");
+        return EXIT_FAILURE;
+    }
+    if (chmod(socketPath.c_str(), 0600) != 0) {
+        perror("chmod");
+        return EXIT_FAILURE;
+    }
+    if (listen(listener, SOMAXCONN) != 0) {
+        perror("listen");
+        return EXIT_FAILURE;
+    }
+    (void)signal(SIGPIPE, SIG_IGN);
+    std::vector< std::thread > pool;
+    for (size_t i = 0; i < workers; ++i) {
+        pool.emplace_back(Work, std::ref(service));
+    }
+    (void)fprintf(
+        stderr,
+        "Listening on %s with %zu workers\n",
+        socketPath.c_str(),
+        workers
+    );
+    for (;;) {
+        const auto fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("accept");
+            return EXIT_FAILURE;
+        }
+        const auto connection = std::make_shared< Connection >();
+        connection->fd = fd;
+        {
+            std::lock_guard< std::mutex > lock(service.mutex);
+            if (service.connections >= MAX_CONNECTIONS) {
+                (void)connection->Send("ERROR too many connections\n");
+                continue;
+            }
+            ++service.connections;
+        }
+        std::thread(Serve, std::ref(service), connection).detach();
+    }
+}
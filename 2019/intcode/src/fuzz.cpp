@@ -0,0 +1,1027 @@
+/**
+ * @file fuzz.cpp
+ *
+ * This module holds the main() function of the Intcode differential
+ * fuzzer, which generates random Intcode programs and runs each one on
+ * the reference machine and the optimizing machine in lockstep, stopping
+ * at the first difference between them.  It can also check the program
+ * optimizer instead, by running each program before and after it's
+ * optimized, and comparing what the two do.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "Assembler.hpp"
+#include "Machine.hpp"
+#include "Optimizer.hpp"
+#include "OptimizingMachine.hpp"
+#include "Program.hpp"
+
+#include <algorithm>
+#include <inttypes.h>
+#include <random>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <crtdbg.h>
+#endif /* _WIN32 */
+
+namespace {
+
+    /**
+     * This is the number of cells of data in each generated program.
+     */
+    constexpr intmax_t DATA_CELLS = 16;
+
+    /**
+     * This is the highest cell address a program may use before the
+     * fuzzer considers it to have crashed, which keeps runaway
+     * addresses from exhausting memory.
+     */
+    constexpr intmax_t MEMORY_LIMIT = 1 << 20;
+
+    /**
+     * This function prints the usage of the program and exits.
+     */
+    void Usage() {
+        (void)fprintf(
+            stderr,
+            (
+                "Usage: aoc_intcode_fuzz [OPTIONS]\n"
+                "\n"
+                "Options:\n"
+                "  --seed N      seed of the first program (default 1)\n"
+                "  --runs N      number of programs to try (default 1000)\n"
+                "  --budget N    instructions to run per program (default 200000)\n"
+                "  --no-loops    don't summarize counted loops\n"
+                "  --no-calls    don't memoize calls to pure functions\n"
+                "  --optimizer   check the program optimizer instead of the\n"
+                "                optimizing machine\n"
+                "  --well-behaved\n"
+                "                with --optimizer, let the optimizer assume\n"
+                "                the program is well-behaved\n"
+                "  --dump        print each program's listing before running it\n"
+            )
+        );
+        exit(1);
+    }
+
+    /**
+     * This function formats a string the way printf would.
+     */
+    std::string Format(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        char buffer[256];
+        (void)vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return buffer;
+    }
+
+    /**
+     * This generates random Intcode programs, as assembly language
+     * listings.  The programs are built from pieces which resemble what
+     * the puzzle programs do, so that the optimizations have something
+     * to recognize: straight-line arithmetic, counted loops, calls to
+     * recursive functions, forward branches, and instructions which
+     * modify the operands and opcodes of other instructions.
+     */
+    struct ProgramGenerator {
+        /**
+         * This is an arithmetic instruction which other instructions
+         * may modify.
+         */
+        struct Patchable {
+            /**
+             * This is the label of the instruction.
+             */
+            std::string label;
+
+            /**
+             * This is the part of the instruction word which holds
+             * the parameter modes.
+             */
+            intmax_t modes = 0;
+        };
+
+        std::mt19937_64 generator;
+        std::string listing;
+        std::string library;
+        size_t nextLabel = 0;
+        std::vector< Patchable > patchables;
+        std::vector< std::string > pendingLabels;
+        std::vector< std::string > functions;
+
+        explicit ProgramGenerator(uint64_t seed)
+            : generator(seed)
+        {
+        }
+
+        intmax_t Random(intmax_t low, intmax_t high) {
+            return std::uniform_int_distribution< intmax_t >(low, high)(generator);
+        }
+
+        bool Chance(int percent) {
+            return Random(0, 99) < percent;
+        }
+
+        std::string NewLabel(const char* prefix) {
+            return Format("%s%zu", prefix, nextLabel++);
+        }
+
+        void Emit(std::string& out, const std::string& statement) {
+            out += "    " + statement + "\n";
+        }
+
+        void Label(std::string& out, const std::string& label) {
+            out += label + ":\n";
+        }
+
+        std::string DataCell() {
+            return Format("[data+%" PRIdMAX "]", Random(0, DATA_CELLS - 1));
+        }
+
+        std::string StackCell() {
+            return Format("[rb+%" PRIdMAX "]", Random(2, 7));
+        }
+
+        std::string Source() {
+            const auto choice = Random(0, 9);
+            if (choice < 3) {
+                return Format("%" PRIdMAX, Random(-10, 10));
+            } else if (choice < 7) {
+                return DataCell();
+            } else if (
+                (choice < 9)
+                || patchables.empty()
+            ) {
+                return StackCell();
+            } else {
+                return Format(
+                    "[%s+%" PRIdMAX "]",
+                    patchables[(size_t)Random(0, (intmax_t)patchables.size() - 1)].label.c_str(),
+                    Random(0, 3)
+                );
+            }
+        }
+
+        std::string Destination() {
+            return (
+                Chance(75)
+                ? DataCell()
+                : StackCell()
+            );
+        }
+
+        /**
+         * This emits an add, multiply, less-than, or equals instruction
+         * with random operands.
+         */
+        void EmitArithmetic(std::string& out) {
+            static const char* const mnemonics[] = {"add", "mul", "lt", "eq"};
+            const auto label = NewLabel("i");
+            const auto lhs = Source();
+            const auto rhs = Source();
+            const auto destination = Destination();
+            Label(out, label);
+            Emit(
+                out,
+                Format(
+                    "%s %s, %s, %s",
+                    mnemonics[Random(0, 3)],
+                    lhs.c_str(),
+                    rhs.c_str(),
+                    destination.c_str()
+                )
+            );
+            Patchable patchable;
+            patchable.label = label;
+            const auto mode = [](const std::string& operand) -> intmax_t {
+                if (operand[0] != '[') {
+                    return 1;
+                }
+                return (operand.substr(0, 3) == "[rb") ? 2 : 0;
+            };
+            patchable.modes = (
+                mode(lhs) * 100
+                + mode(rhs) * 1000
+                + mode(destination) * 10000
+            );
+            patchables.push_back(patchable);
+        }
+
+        /**
+         * This emits an instruction which modifies an operand or the
+         * opcode of an earlier arithmetic instruction.
+         */
+        void EmitPatch(std::string& out) {
+            if (patchables.empty()) {
+                EmitArithmetic(out);
+                return;
+            }
+            const auto& target = patchables[(size_t)Random(0, (intmax_t)patchables.size() - 1)];
+            if (Chance(30)) {
+                static const intmax_t opcodes[] = {1, 2, 7, 8};
+                Emit(
+                    out,
+                    Format(
+                        "add 0, %" PRIdMAX ", [%s]",
+                        target.modes + opcodes[Random(0, 3)],
+                        target.label.c_str()
+                    )
+                );
+            } else if (Chance(50)) {
+                Emit(
+                    out,
+                    Format(
+                        "add [%s+%" PRIdMAX "], 1, [%s+%" PRIdMAX "]",
+                        target.label.c_str(),
+                        Random(1, 2),
+                        target.label.c_str(),
+                        Random(1, 2)
+                    )
+                );
+            } else {
+                Emit(
+                    out,
+                    Format(
+                        "add 0, %" PRIdMAX ", [%s+%" PRIdMAX "]",
+                        Random(0, 40),
+                        target.label.c_str(),
+                        Random(1, 3)
+                    )
+                );
+            }
+        }
+
+        /**
+         * This emits a loop which runs a number of times given by
+         * a counter, with a short body of random arithmetic.
+         */
+        void EmitLoop(std::string& out) {
+            const auto counter = Format("[data+%" PRIdMAX "]", Random(0, DATA_CELLS - 1));
+            const auto trips = (
+                Chance(20)
+                ? Random(1000, 100000)
+                : Random(0, 50)
+            );
+            const auto header = NewLabel("loop");
+            const auto countUp = Chance(50);
+            Emit(out, Format("add 0, %" PRIdMAX ", %s", (countUp ? 0 : trips), counter.c_str()));
+            Label(out, header);
+            const auto bodyLength = Random(1, 4);
+            for (intmax_t i = 0; i < bodyLength; ++i) {
+                const auto accumulator = DataCell();
+                switch (Random(0, 4)) {
+                    case 0: {
+                        Emit(out, Format("add %s, %s, %s", accumulator.c_str(), counter.c_str(), accumulator.c_str()));
+                    } break;
+
+                    case 1: {
+                        Emit(out, Format("add %s, %" PRIdMAX ", %s", accumulator.c_str(), Random(-5, 5), accumulator.c_str()));
+                    } break;
+
+                    case 2: {
+                        Emit(out, Format("mul %s, %" PRIdMAX ", %s", counter.c_str(), Random(-3, 3), accumulator.c_str()));
+                    } break;
+
+                    case 3: {
+                        if (Chance(10)) {
+                            EmitPatch(out);
+                        } else {
+                            EmitArithmetic(out);
+                        }
+                    } break;
+
+                    default: {
+                        Emit(out, Format("lt %s, %s, %s", counter.c_str(), Source().c_str(), accumulator.c_str()));
+                    } break;
+                }
+            }
+            if (countUp) {
+                const auto condition = DataCell();
+                Emit(out, Format("add %s, 1, %s", counter.c_str(), counter.c_str()));
+                Emit(out, Format("lt %s, %" PRIdMAX ", %s", counter.c_str(), trips, condition.c_str()));
+                Emit(out, Format("jnz %s, %s", condition.c_str(), header.c_str()));
+            } else {
+                Emit(out, Format("add %s, -1, %s", counter.c_str(), counter.c_str()));
+                Emit(out, Format("jnz %s, %s", counter.c_str(), header.c_str()));
+            }
+        }
+
+        /**
+         * This adds to the library a recursive function, in the style
+         * of the one in the BOOST program, and returns its label.
+         */
+        std::string MakeFunction() {
+            const auto name = NewLabel("f");
+            const auto base = NewLabel("base");
+            const auto done = NewLabel("done");
+            const auto return1 = NewLabel("r");
+            const auto return2 = NewLabel("r");
+            const auto scratch = (
+                Chance(50)
+                ? std::string("[rb-1]")
+                : DataCell()
+            );
+            Label(library, name);
+            Emit(library, "arb 3");
+            Emit(library, Format("lt [rb-2], %" PRIdMAX ", %s", Random(1, 3), scratch.c_str()));
+            Emit(library, Format("jnz %s, %s", scratch.c_str(), base.c_str()));
+            Emit(library, "add [rb-2], -1, [rb+1]");
+            Emit(library, Format("add 0, %s, [rb]", return1.c_str()));
+            Emit(library, Format("jz 0, %s", name.c_str()));
+            Label(library, return1);
+            Emit(library, "add [rb+1], 0, [rb-1]");
+            Emit(library, Format("add [rb-2], %" PRIdMAX ", [rb+1]", Random(-3, -2)));
+            Emit(library, Format("add 0, %s, [rb]", return2.c_str()));
+            Emit(library, Format("jz 0, %s", name.c_str()));
+            Label(library, return2);
+            Emit(library, "add [rb+1], [rb-1], [rb-2]");
+            Emit(library, Format("jz 0, %s", done.c_str()));
+            Label(library, base);
+            switch (Random(0, 3)) {
+                case 0: {
+                    Emit(library, Format("add [rb-2], %s, [rb-2]", DataCell().c_str()));
+                } break;
+
+                case 1: {
+                    Emit(library, "out [rb-2]");
+                } break;
+
+                case 2: {
+                    EmitPatch(library);
+                } break;
+
+                default: {
+                    Emit(library, "mul [rb-2], 1, [rb-2]");
+                } break;
+            }
+            Label(library, done);
+            Emit(library, "arb -3");
+            Emit(library, "jnz 1, [rb]");
+            functions.push_back(name);
+            return name;
+        }
+
+        /**
+         * This emits a call to a recursive function.
+         */
+        void EmitCall(std::string& out) {
+            const auto function = (
+                (
+                    functions.empty()
+                    || Chance(20)
+                )
+                ? MakeFunction()
+                : functions[(size_t)Random(0, (intmax_t)functions.size() - 1)]
+            );
+            const auto returnLabel = NewLabel("c");
+            if (Chance(50)) {
+                Emit(out, Format("add 0, %" PRIdMAX ", [rb+1]", Random(-2, 22)));
+            } else {
+                Emit(out, Format("add %s, 0, [rb+1]", DataCell().c_str()));
+            }
+            Emit(out, Format("add 0, %s, [rb]", returnLabel.c_str()));
+            Emit(out, Format("jz 0, %s", function.c_str()));
+            Label(out, returnLabel);
+            Emit(out, Format("add [rb+1], 0, %s", DataCell().c_str()));
+        }
+
+        /**
+         * This generates a random program.
+         *
+         * @return
+         *     The assembly language listing of the program is returned.
+         */
+        std::string Generate() {
+            Emit(listing, "arb stack");
+            const auto segments = Random(1, 12);
+            for (intmax_t i = 0; i < segments; ++i) {
+                if (
+                    !pendingLabels.empty()
+                    && Chance(50)
+                ) {
+                    Label(listing, pendingLabels.back());
+                    pendingLabels.pop_back();
+                }
+                switch (Random(0, 9)) {
+                    case 0: case 1: case 2: {
+                        const auto length = Random(1, 5);
+                        for (intmax_t j = 0; j < length; ++j) {
+                            EmitArithmetic(listing);
+                        }
+                    } break;
+
+                    case 3: case 4: {
+                        EmitLoop(listing);
+                    } break;
+
+                    case 5: case 6: {
+                        EmitCall(listing);
+                    } break;
+
+                    case 7: {
+                        EmitPatch(listing);
+                    } break;
+
+                    case 8: {
+                        const auto target = NewLabel("skip");
+                        Emit(
+                            listing,
+                            Format(
+                                "%s %s, %s",
+                                (Chance(50) ? "jnz" : "jz"),
+                                DataCell().c_str(),
+                                target.c_str()
+                            )
+                        );
+                        pendingLabels.push_back(target);
+                    } break;
+
+                    default: {
+                        if (Chance(50)) {
+                            Emit(listing, Format("in %s", Destination().c_str()));
+                        } else {
+                            Emit(listing, Format("out %s", Source().c_str()));
+                        }
+                    } break;
+                }
+            }
+            while (!pendingLabels.empty()) {
+                Label(listing, pendingLabels.back());
+                pendingLabels.pop_back();
+            }
+            Emit(listing, "hlt");
+            listing += library;
+            Label(listing, "data");
+            std::string data;
+            for (intmax_t i = 0; i < DATA_CELLS; ++i) {
+                data += Format("%s%" PRIdMAX, ((i == 0) ? "" : ", "), Random(-20, 20));
+            }
+            Emit(listing, ".data " + data);
+            Label(listing, "stack");
+            Emit(listing, ".data 0");
+            return listing;
+        }
+    };
+
+    /**
+     * This function checks whether the machine can safely execute its
+     * next instruction, which is the case unless the instruction is
+     * invalid or would access memory out of bounds.
+     *
+     * @param[in] machine
+     *     This is the machine to check.
+     *
+     * @param[out] reason
+     *     This is where to store why the machine can't continue.
+     *
+     * @return
+     *     An indication of whether or not the machine can safely execute
+     *     its next instruction is returned.
+     */
+    bool CanStep(
+        const Machine& machine,
+        std::string& reason
+    ) {
+        const auto& numbers = machine.numbers;
+        const auto pos = machine.pos;
+        if (pos >= numbers.size()) {
+            reason = Format("instruction at %zu is past the end of memory", pos);
+            return false;
+        }
+        const auto word = numbers[pos];
+        const auto opcode = word % 100;
+        const auto operation = FindOperation(opcode);
+        if (
+            (word < 0)
+            || (operation == nullptr)
+        ) {
+            reason = Format("invalid instruction %" PRIdMAX " at %zu", word, pos);
+            return false;
+        }
+        if (pos + operation->parameters >= numbers.size()) {
+            reason = Format("instruction at %zu runs past the end of memory", pos);
+            return false;
+        }
+        intmax_t modeScale = 100;
+        for (size_t i = 0; i < operation->parameters; ++i) {
+            const auto mode = (word / modeScale) % 10;
+            modeScale *= 10;
+            const auto operand = numbers[pos + 1 + i];
+            intmax_t address;
+            if (mode == 0) {
+                address = operand;
+            } else if (mode == 2) {
+                address = machine.relativeBase + operand;
+            } else if (
+                (mode == 1)
+                && ((int)i != operation->destination)
+            ) {
+                continue;
+            } else {
+                reason = Format("invalid mode for parameter %zu of instruction at %zu", i + 1, pos);
+                return false;
+            }
+            if (
+                (address < 0)
+                || (address >= MEMORY_LIMIT)
+            ) {
+                reason = Format("instruction at %zu accesses cell %" PRIdMAX, pos, address);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * This function compares the states of the two machines.
+     *
+     * @return
+     *     A description of the first difference found between the
+     *     machines is returned, or an empty string if they're the same.
+     */
+    std::string Compare(
+        const Machine& reference,
+        const std::vector< intmax_t >& referenceOutput,
+        const Machine& optimized,
+        const std::vector< intmax_t >& optimizedOutput
+    ) {
+        if (reference.instructions != optimized.instructions) {
+            return Format(
+                "instruction count %" PRIu64 " vs %" PRIu64,
+                reference.instructions,
+                optimized.instructions
+            );
+        }
+        if (reference.pos != optimized.pos) {
+            return Format("PC %zu vs %zu", reference.pos, optimized.pos);
+        }
+        if (reference.relativeBase != optimized.relativeBase) {
+            return Format(
+                "relative base %" PRIdMAX " vs %" PRIdMAX,
+                reference.relativeBase,
+                optimized.relativeBase
+            );
+        }
+        if (reference.halted != optimized.halted) {
+            return Format(
+                "halted %s vs %s",
+                (reference.halted ? "yes" : "no"),
+                (optimized.halted ? "yes" : "no")
+            );
+        }
+        if (reference.input.size() != optimized.input.size()) {
+            return Format(
+                "inputs left %zu vs %zu",
+                reference.input.size(),
+                optimized.input.size()
+            );
+        }
+        const auto outputs = std::min(referenceOutput.size(), optimizedOutput.size());
+        for (size_t i = 0; i < outputs; ++i) {
+            if (referenceOutput[i] != optimizedOutput[i]) {
+                return Format(
+                    "output #%zu %" PRIdMAX " vs %" PRIdMAX,
+                    i + 1,
+                    referenceOutput[i],
+                    optimizedOutput[i]
+                );
+            }
+        }
+        if (referenceOutput.size() != optimizedOutput.size()) {
+            return Format(
+                "output count %zu vs %zu",
+                referenceOutput.size(),
+                optimizedOutput.size()
+            );
+        }
+        const auto cells = std::min(reference.numbers.size(), optimized.numbers.size());
+        for (size_t i = 0; i < cells; ++i) {
+            if (reference.numbers[i] != optimized.numbers[i]) {
+                return Format(
+                    "memory cell %zu %" PRIdMAX " vs %" PRIdMAX,
+                    i,
+                    reference.numbers[i],
+                    optimized.numbers[i]
+                );
+            }
+        }
+        if (reference.numbers.size() != optimized.numbers.size()) {
+            return Format(
+                "memory size %zu vs %zu",
+                reference.numbers.size(),
+                optimized.numbers.size()
+            );
+        }
+        return "";
+    }
+
+    /**
+     * These are the totals gathered over all the programs run.
+     */
+    struct Totals {
+        uint64_t instructions = 0;
+        uint64_t crashed = 0;
+        uint64_t loopsSummarized = 0;
+        uint64_t iterationsSkipped = 0;
+        uint64_t callsSkipped = 0;
+        uint64_t optimized = 0;
+        uint64_t instructionsSaved = 0;
+    };
+
+    /**
+     * This function runs the given program on both machines in
+     * lockstep.  After each step of the optimizing machine, the
+     * reference machine is run until it has executed the same
+     * number of instructions, and then the two are compared.
+     *
+     * @param[in] numbers
+     *     This is the program to run.
+     *
+     * @param[in] input
+     *     These are the values to give the program as input.
+     *
+     * @param[in] budget
+     *     This is the number of instructions after which to give up.
+     *
+     * @param[in] summarizeLoops
+     *     This indicates whether or not to summarize loops.
+     *
+     * @param[in] memoizeCalls
+     *     This indicates whether or not to memoize calls.
+     *
+     * @param[in,out] totals
+     *     This is where to add up statistics.
+     *
+     * @return
+     *     A description of the first difference found between the
+     *     machines is returned, or an empty string if there was none.
+     */
+    std::string RunInLockstep(
+        const std::vector< intmax_t >& numbers,
+        const std::vector< intmax_t >& input,
+        uint64_t budget,
+        bool summarizeLoops,
+        bool memoizeCalls,
+        Totals& totals
+    ) {
+        Machine reference;
+        reference.numbers = numbers;
+        reference.input = input;
+        std::vector< intmax_t > referenceOutput;
+        OptimizingMachine optimized;
+        optimized.numbers = numbers;
+        optimized.input = input;
+        optimized.summarizeLoops = summarizeLoops;
+        optimized.memoizeCalls = memoizeCalls;
+        optimized.warmup = 0;
+        std::vector< intmax_t > optimizedOutput;
+        std::string difference;
+        std::string reason;
+        while (optimized.instructions < budget) {
+            if (!CanStep(optimized, reason)) {
+                ++totals.crashed;
+                break;
+            }
+            const auto stepped = optimized.Step(optimizedOutput);
+            while (reference.instructions < optimized.instructions) {
+                if (!CanStep(reference, reason)) {
+                    difference = Format(
+                        "reference machine crashed after %" PRIu64 " instructions (%s)",
+                        reference.instructions,
+                        reason.c_str()
+                    );
+                    break;
+                }
+                if (!reference.Step(referenceOutput)) {
+                    break;
+                }
+            }
+            if (difference.empty()) {
+                difference = Compare(reference, referenceOutput, optimized, optimizedOutput);
+            }
+            if (!difference.empty()) {
+                difference = Format(
+                    "after %" PRIu64 " instructions: ",
+                    optimized.instructions
+                ) + difference;
+                break;
+            }
+            if (!stepped) {
+                break;
+            }
+        }
+        totals.instructions += optimized.instructions;
+        totals.loopsSummarized += optimized.loops.loopsSummarized;
+        totals.iterationsSkipped += optimized.loops.iterationsSkipped;
+        totals.callsSkipped += optimized.calls.callsSkipped;
+        return difference;
+    }
+
+    /**
+     * This is what a program did when it was run on the reference
+     * machine.
+     */
+    struct Outcome {
+        std::vector< intmax_t > output;
+        uint64_t instructions = 0;
+        bool halted = false;
+        bool crashed = false;
+        bool finished = false;
+        size_t inputsLeft = 0;
+    };
+
+    /**
+     * This function runs the given program on the reference machine,
+     * until it halts, needs input it doesn't have, crashes, or runs
+     * out of budget.
+     *
+     * @param[in] numbers
+     *     This is the program to run.
+     *
+     * @param[in] input
+     *     These are the values to give the program as input.
+     *
+     * @param[in] budget
+     *     This is the number of instructions after which to give up.
+     *
+     * @return
+     *     What the program did is returned.
+     */
+    Outcome RunAlone(
+        const std::vector< intmax_t >& numbers,
+        const std::vector< intmax_t >& input,
+        uint64_t budget
+    ) {
+        Outcome outcome;
+        Machine machine;
+        machine.numbers = numbers;
+        machine.input = input;
+        std::string reason;
+        while (machine.instructions < budget) {
+            if (!CanStep(machine, reason)) {
+                outcome.crashed = true;
+                break;
+            }
+            if (!machine.Step(outcome.output)) {
+                outcome.finished = true;
+                break;
+            }
+        }
+        outcome.instructions = machine.instructions;
+        outcome.halted = machine.halted;
+        outcome.inputsLeft = machine.input.size();
+        return outcome;
+    }
+
+    /**
+     * This function optimizes the given program, and runs it both
+     * before and after on the reference machine, comparing what the two
+     * do.  The optimizer takes out work, so the two runs can't be
+     * compared step by step, or by their memory, which the optimizer
+     * rewrites.  Instead, their outputs are compared, along with whether
+     * or not they halt and how much input they take.  If the original
+     * program runs out of budget, only the outputs it produced are
+     * compared, and if it crashes, nothing is, since the optimizer
+     * is only meant to preserve what valid programs do.
+     *
+     * @param[in] numbers
+     *     This is the program to optimize and run.
+     *
+     * @param[in] input
+     *     These are the values to give the program as input.
+     *
+     * @param[in] budget
+     *     This is the number of instructions after which to give up.
+     *
+     * @param[in] assumeWellBehaved
+     *     This indicates whether or not the optimizer may assume
+     *     the program is well-behaved.
+     *
+     * @param[in,out] totals
+     *     This is where to add up statistics.
+     *
+     * @return
+     *     A description of the first difference found between the
+     *     original and optimized programs is returned, or an empty
+     *     string if there was none.
+     */
+    std::string RunOptimized(
+        const std::vector< intmax_t >& numbers,
+        const std::vector< intmax_t >& input,
+        uint64_t budget,
+        bool assumeWellBehaved,
+        Totals& totals
+    ) {
+        Optimizer::Options options;
+        options.assumeWellBehaved = assumeWellBehaved;
+        Optimizer::Report report;
+        const auto optimizedNumbers = Optimizer::Optimize(numbers, options, report);
+        if (optimizedNumbers != numbers) {
+            ++totals.optimized;
+        }
+        const auto original = RunAlone(numbers, input, budget);
+        totals.instructions += original.instructions;
+        if (original.crashed) {
+            ++totals.crashed;
+            return "";
+        }
+        const auto optimized = RunAlone(optimizedNumbers, input, budget);
+        if (optimized.crashed) {
+            return Format(
+                "optimized program crashed after %" PRIu64 " instructions",
+                optimized.instructions
+            );
+        }
+        const auto outputs = std::min(original.output.size(), optimized.output.size());
+        for (size_t i = 0; i < outputs; ++i) {
+            if (original.output[i] != optimized.output[i]) {
+                return Format(
+                    "output #%zu %" PRIdMAX " vs %" PRIdMAX,
+                    i + 1,
+                    original.output[i],
+                    optimized.output[i]
+                );
+            }
+        }
+        if (!original.finished) {
+            if (original.output.size() > optimized.output.size()) {
+                return Format(
+                    "output count %zu vs %zu",
+                    original.output.size(),
+                    optimized.output.size()
+                );
+            }
+            return "";
+        }
+        if (!optimized.finished) {
+            return "optimized program ran out of budget";
+        }
+        if (original.output.size() != optimized.output.size()) {
+            return Format(
+                "output count %zu vs %zu",
+                original.output.size(),
+                optimized.output.size()
+            );
+        }
+        if (original.halted != optimized.halted) {
+            return Format(
+                "halted %s vs %s",
+                (original.halted ? "yes" : "no"),
+                (optimized.halted ? "yes" : "no")
+            );
+        }
+        if (original.inputsLeft != optimized.inputsLeft) {
+            return Format(
+                "inputs left %zu vs %zu",
+                original.inputsLeft,
+                optimized.inputsLeft
+            );
+        }
+        totals.instructionsSaved += original.instructions - optimized.instructions;
+        return "";
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    //_crtBreakAlloc = 18;
+    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif /* _WIN32 */
+    uint64_t seed = 1;
+    uint64_t runs = 1000;
+    uint64_t budget = 200000;
+    bool summarizeLoops = true;
+    bool memoizeCalls = true;
+    bool dump = false;
+    bool checkOptimizer = false;
+    bool assumeWellBehaved = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (
+            (arg == "--seed")
+            && (i + 1 < argc)
+        ) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (
+            (arg == "--runs")
+            && (i + 1 < argc)
+        ) {
+            runs = strtoull(argv[++i], NULL, 10);
+        } else if (
+            (arg == "--budget")
+            && (i + 1 < argc)
+        ) {
+            budget = strtoull(argv[++i], NULL, 10);
+        } else if (arg == "--no-loops") {
+            summarizeLoops = false;
+        } else if (arg == "--no-calls") {
+            memoizeCalls = false;
+        } else if (arg == "--dump") {
+            dump = true;
+        } else if (arg == "--optimizer") {
+            checkOptimizer = true;
+        } else if (arg == "--well-behaved") {
+            assumeWellBehaved = true;
+        } else {
+            Usage();
+        }
+    }
+    Totals totals;
+    for (uint64_t run = 0; run < runs; ++run) {
+        const auto programSeed = seed + run;
+        ProgramGenerator generator(programSeed);
+        const auto listing = generator.Generate();
+        const auto numbers = Assemble(listing);
+        std::vector< intmax_t > input;
+        const auto inputs = generator.Random(0, 8);
+        for (intmax_t i = 0; i < inputs; ++i) {
+            input.push_back(generator.Random(-10, 100));
+        }
+        if (dump) {
+            printf("; seed %" PRIu64 "\n%s", programSeed, listing.c_str());
+        }
+        const auto difference = (
+            checkOptimizer
+            ? RunOptimized(
+                numbers,
+                input,
+                budget,
+                assumeWellBehaved,
+                totals
+            )
+            : RunInLockstep(
+                numbers,
+                input,
+                budget,
+                summarizeLoops,
+                memoizeCalls,
+                totals
+            )
+        );
+        if (!difference.empty()) {
+            (void)fprintf(
+                stderr,
+                (
+                    "Seed %" PRIu64 ": %s differ %s\n"
+                    "Program: %s\n"
+                    "Input: %s\n"
+                ),
+                programSeed,
+                (checkOptimizer ? "original and optimized programs" : "machines"),
+                difference.c_str(),
+                FormatProgram(numbers).c_str(),
+                FormatProgram(input).c_str()
+            );
+            return EXIT_FAILURE;
+        }
+    }
+    if (checkOptimizer) {
+        printf(
+            (
+                "%" PRIu64 " programs agreed (%" PRIu64 " crashed)\n"
+                "Instructions: %" PRIu64 "\n"
+                "Programs changed by the optimizer: %" PRIu64 "\n"
+                "Instructions saved: %" PRIu64 "\n"
+            ),
+            runs,
+            totals.crashed,
+            totals.instructions,
+            totals.optimized,
+            totals.instructionsSaved
+        );
+        return EXIT_SUCCESS;
+    }
+    printf(
+        (
+            "%" PRIu64 " programs agreed (%" PRIu64 " crashed)\n"
+            "Instructions: %" PRIu64 "\n"
+            "Loops summarized: %" PRIu64 " (%" PRIu64 " iterations skipped)\n"
+            "Calls replayed: %" PRIu64 "\n"
+        ),
+        runs,
+        totals.crashed,
+        totals.instructions,
+        totals.loopsSummarized,
+        totals.iterationsSkipped,
+        totals.callsSkipped
+    );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file run.cpp
+ *
+ * This module holds the main() function of the Intcode runner, which
+ * runs a program with given input on either the reference machine or
+ * the optimizing machine.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "Machine.hpp"
+#include "OptimizingMachine.hpp"
+#include "Program.hpp"
+
+#include <chrono>
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <crtdbg.h>
+#endif /* _WIN32 */
+
+namespace {
+
+    /**
+     * This function prints the usage of the program and exits.
+     */
+    void Usage() {
+        (void)fprintf(
+            stderr,
+            (
+                "Usage: aoc_intcode_run [OPTIONS] [PROGRAM] [INPUTS]\n"
+                "\n"
+                "PROGRAM defaults to input.txt; INPUTS is a comma-separated list.\n"
+                "\n"
+                "Options:\n"
+                "  --reference   run on the reference machine\n"
+                "  --no-loops    don't summarize counted loops\n"
+                "  --no-calls    don't memoize calls to pure functions\n"
+                "  --stats       report statistics on the standard error stream\n"
+            )
+        );
+        exit(1);
+    }
+
+    /**
+     * This function runs the given machine until it halts or needs more
+     * input, and reports what happened.
+     *
+     * @param[in,out] machine
+     *     This is the machine to run.
+     *
+     * @param[in] stats
+     *     This indicates whether or not to report statistics.
+     */
+    template< typename MachineType > void RunMachine(
+        MachineType& machine,
+        bool stats
+    ) {
+        std::vector< intmax_t > output;
+        const auto start = std::chrono::steady_clock::now();
+        machine.Run(output);
+        const auto elapsed = std::chrono::duration_cast< std::chrono::microseconds >(
+            std::chrono::steady_clock::now() - start
+        ).count();
+        printf("%s\n", FormatProgram(output).c_str());
+        if (stats) {
+            (void)fprintf(
+                stderr,
+                (
+                    "State: %s\n"
+                    "Instructions: %" PRIu64 "\n"
+                    "Time: %.3f ms\n"
+                ),
+                machine.halted ? "halted" : "needs input",
+                machine.instructions,
+                (double)elapsed / 1000.0
+            );
+        }
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    //_crtBreakAlloc = 18;
+    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif /* _WIN32 */
+    bool reference = false;
+    bool summarizeLoops = true;
+    bool memoizeCalls = true;
+    bool stats = false;
+    std::vector< std::string > positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--reference") {
+            reference = true;
+        } else if (arg == "--no-loops") {
+            summarizeLoops = false;
+        } else if (arg == "--no-calls") {
+            memoizeCalls = false;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (
+            (arg[0] == '-')
+            && (arg.length() > 1)
+            && !isdigit((unsigned char)arg[1])
+        ) {
+            Usage();
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() > 2) {
+        Usage();
+    }
+    const auto numbers = ReadProgram(positional.empty() ? "input.txt" : positional[0]);
+    std::vector< intmax_t > input;
+    if (positional.size() == 2) {
+        input = ParseProgram(positional[1]);
+    }
+    if (reference) {
+        Machine machine;
+        machine.numbers = numbers;
+        machine.input = input;
+        RunMachine(machine, stats);
+    } else {
+        OptimizingMachine machine;
+        machine.numbers = numbers;
+        machine.input = input;
+        machine.summarizeLoops = summarizeLoops;
+        machine.memoizeCalls = memoizeCalls;
+        RunMachine(machine, stats);
+        if (stats) {
+            (void)fprintf(
+                stderr,
+                (
+                    "Loops summarized: %" PRIu64 "\n"
+                    "Iterations skipped: %" PRIu64 "\n"
+                    "Calls memoized: %" PRIu64 "\n"
+                    "Calls replayed: %" PRIu64 " (%" PRIu64 " instructions skipped)\n"
+                ),
+                machine.loops.loopsSummarized,
+                machine.loops.iterationsSkipped,
+                machine.calls.callsMemoized,
+                machine.calls.callsSkipped,
+                machine.calls.instructionsSkipped
+            );
+        }
+    }
+    return EXIT_SUCCESS;
+}